@@ -0,0 +1,228 @@
+// Copyright 2012, Milan Oberkirch
+// Author: Milan Oberkirch <oberkirm@informatik.uni-freiburg.de>
+
+#include "./AccessLog.h"
+#include <stdint.h>
+#include <time.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <thread>
+
+const size_t AccessLog::maxLength;
+
+// The names of the levels (in the order of AccessLog::Level).
+static char const* const levelNames[] = {"off", "error", "info", "debug"};
+
+// ___________________________________________________________________________
+char const* AccessLog::levelName(Level level) {
+  return levelNames[level];
+}
+
+// ___________________________________________________________________________
+bool AccessLog::parseLevel(string const& name, Level* level) {
+  for (size_t i = 0; i <= DEBUG; ++i) {
+    if (name == levelNames[i]) {
+      *level = static_cast<Level>(i);
+      return true;
+    }
+  }
+  return false;
+}
+
+// ___________________________________________________________________________
+AccessLog::AccessLog(size_t capacity)
+  : _head(0), _tail(0), _dropped(0), _requests(0), _level(OFF),
+    _sampleRate(1), _maxBytes(0), _numberOfFiles(0), _file(NULL),
+    _fileSize(0), _reopen(false), _stop(false) {
+  size_t size = 1;
+  while (size < capacity) size *= 2;
+  _slots.reset(new Slot[size]);
+  _mask = size - 1;
+  for (size_t i = 0; i < size; ++i) _slots[i].sequence = i;
+}
+
+// ___________________________________________________________________________
+AccessLog::~AccessLog() {
+  close();
+}
+
+// ___________________________________________________________________________
+bool AccessLog::open(string const& fileName, Level level, size_t sampleRate,
+    size_t maxBytes, size_t numberOfFiles) {
+  close();
+  _fileName = fileName;
+  _sampleRate = std::max<size_t>(1, sampleRate);
+  _maxBytes = maxBytes;
+  _numberOfFiles = numberOfFiles;
+  if (level == OFF) return true;
+  if (!openFile()) return false;
+  _level = level;
+  _writer = std::thread(&AccessLog::write, this);
+  return true;
+}
+
+// ___________________________________________________________________________
+void AccessLog::close() {
+  _level = OFF;
+  if (_writer.joinable()) {
+    _stop = true;
+    _writer.join();
+    _stop = false;
+  }
+  if (_file && _file != stdout) fclose(_file);
+  _file = NULL;
+}
+
+// ___________________________________________________________________________
+bool AccessLog::sample(Level level) {
+  if (!enabled(level)) return false;
+  return _requests.fetch_add(1, std::memory_order_relaxed) % _sampleRate
+    == 0;
+}
+
+// ___________________________________________________________________________
+bool AccessLog::log(Level level, string_view text) {
+  if (!enabled(level)) return true;
+  int64_t microseconds = std::chrono::duration_cast<
+    std::chrono::microseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+  if (push(level, microseconds, text)) return true;
+  _dropped.fetch_add(1, std::memory_order_relaxed);
+  return false;
+}
+
+// ___________________________________________________________________________
+bool AccessLog::push(Level level, int64_t microseconds, string_view text) {
+  // The slot at position is free when its sequence is position, it has an
+  // entry when it is position + 1 (see pop).
+  size_t position = _head.load(std::memory_order_relaxed);
+  Slot* slot;
+  while (true) {
+    slot = &_slots[position & _mask];
+    size_t sequence = slot->sequence.load(std::memory_order_acquire);
+    if (sequence == position) {
+      if (_head.compare_exchange_weak(position, position + 1,
+            std::memory_order_relaxed)) break;
+    } else if (sequence < position) {
+      // The writer has not taken the entry from the last round yet.
+      return false;
+    } else {
+      position = _head.load(std::memory_order_relaxed);
+    }
+  }
+  slot->microseconds = microseconds;
+  slot->level = level;
+  slot->length = std::min(text.size(), maxLength);
+  memcpy(slot->text, text.data(), slot->length);
+  slot->sequence.store(position + 1, std::memory_order_release);
+  return true;
+}
+
+// ___________________________________________________________________________
+bool AccessLog::pop(Slot* entry) {
+  Slot& slot = _slots[_tail & _mask];
+  if (slot.sequence.load(std::memory_order_acquire) != _tail + 1)
+    return false;
+  entry->microseconds = slot.microseconds;
+  entry->level = slot.level;
+  entry->length = slot.length;
+  memcpy(entry->text, slot.text, slot.length);
+  // Free for the next round.
+  slot.sequence.store(_tail + _mask + 1, std::memory_order_release);
+  ++_tail;
+  return true;
+}
+
+// ___________________________________________________________________________
+void AccessLog::write() {
+  Slot entry;
+  while (true) {
+    // Entries logged before close are still written.
+    bool stop = _stop;
+    size_t written = 0;
+    while (pop(&entry)) {
+      writeEntry(entry);
+      ++written;
+    }
+    if (_reopen.exchange(false)) openFile();
+    if (written && _file) fflush(_file);
+    if (stop) return;
+    // Nothing to do, look again later (the threads logging never wait for
+    // the writer, so they do not wake it up either).
+    if (!written) std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  }
+}
+
+// ___________________________________________________________________________
+void AccessLog::writeEntry(Slot const& entry) {
+  if (!_file) return;
+  time_t seconds = entry.microseconds / 1000000;
+  struct tm time;
+  gmtime_r(&seconds, &time);
+  char timestamp[32];
+  size_t length = strftime(timestamp, sizeof(timestamp), "%Y-%m-%dT%H:%M:%S",
+      &time);
+  snprintf(timestamp + length, sizeof(timestamp) - length, ".%03dZ ",
+      static_cast<int>(entry.microseconds / 1000 % 1000));
+  _line.assign(timestamp);
+  _line.append(levelName(entry.level)).append(" ");
+  _line.append(entry.text, entry.length).append("\n");
+  fwrite(_line.data(), 1, _line.size(), _file);
+  _fileSize += _line.size();
+  if (_maxBytes && _fileSize > _maxBytes && _file != stdout) rotate();
+}
+
+// ___________________________________________________________________________
+bool AccessLog::openFile() {
+  if (_file && _file != stdout) fclose(_file);
+  _fileSize = 0;
+  if (_fileName == "-") {
+    _file = stdout;
+    return true;
+  }
+  _file = fopen(_fileName.c_str(), "a");
+  if (!_file) return false;
+  fseek(_file, 0, SEEK_END);
+  _fileSize = ftell(_file);
+  return true;
+}
+
+// ___________________________________________________________________________
+void AccessLog::rotate() {
+  fclose(_file);
+  _file = NULL;
+  // log.(n - 1) -> log.n, ..., log -> log.1 (the oldest file is replaced).
+  for (size_t i = _numberOfFiles; i > 1; --i) {
+    rename((_fileName + "." + std::to_string(i - 1)).c_str(),
+        (_fileName + "." + std::to_string(i)).c_str());
+  }
+  if (_numberOfFiles) {
+    rename(_fileName.c_str(), (_fileName + ".1").c_str());
+  } else {
+    remove(_fileName.c_str());
+  }
+  openFile();
+}
+
+// ___________________________________________________________________________
+void AccessLog::appendQuoted(string_view text, string* out) {
+  out->push_back('"');
+  for (size_t i = 0; i < text.size(); ++i) {
+    unsigned char c = text[i];
+    if (c == '"' || c == '\\') {
+      out->push_back('\\');
+      out->push_back(c);
+    } else if (c < 0x20 || c == 0x7f) {
+      char escaped[8];
+      snprintf(escaped, sizeof(escaped), "\\x%02x", c);
+      out->append(escaped);
+    } else {
+      out->push_back(c);
+    }
+  }
+  out->push_back('"');
+}
@@ -0,0 +1,127 @@
+// Copyright 2012, Milan Oberkirch
+// Author: Milan Oberkirch <oberkirm@informatik.uni-freiburg.de>
+
+#ifndef ACCESSLOG_H_
+#define ACCESSLOG_H_
+
+#include <gtest/gtest.h>
+#include <stdint.h>
+#include <boost/utility/string_view.hpp>
+#include <atomic>
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <thread>
+
+using boost::string_view;
+using std::string;
+
+// Log of the requests, written without blocking the threads answering
+// them: entries are put into a bounded lock-free ring buffer (see push) and
+// a background thread writes them to the log file, one line per entry:
+//   2012-10-18T09:41:07.123Z info id=12 status=200 us=153 request="GET /"
+// The timestamp is taken when the entry is logged, but formatted by the
+// writer. If the ring buffer is full, entries are dropped (and counted)
+// instead of waiting for the writer. The file is rotated when it gets too
+// large (log -> log.1 -> log.2 ...) and can be reopened after it was moved
+// away (e.g. by logrotate).
+class AccessLog {
+ public:
+  // Entries of a level are written if the level of the log is at least
+  // as high.
+  enum Level {
+    OFF,
+    ERROR,
+    INFO,
+    DEBUG
+  };
+  // The name of a level and the level with a name (false for unknown ones).
+  static char const* levelName(Level level);
+  static bool parseLevel(string const& name, Level* level);
+
+  // A log with room for capacity entries (rounded up to a power of two),
+  // which writes nothing until open.
+  explicit AccessLog(size_t capacity = 4096);
+  // Write the remaining entries and close the file.
+  ~AccessLog();
+
+  // Start writing entries of at most the given level to fileName ("-" for
+  // the standard output). Of the requests only every sampleRate-th is
+  // logged (see sample). When the file has more than maxBytes bytes (0 for
+  // no limit) it is rotated, keeping numberOfFiles old files. Call before
+  // logging from other threads. Returns false if the file cannot be
+  // opened.
+  bool open(string const& fileName, Level level, size_t sampleRate = 1,
+      size_t maxBytes = 0, size_t numberOfFiles = 5);
+  // Write the remaining entries, close the file and stop the writer.
+  void close();
+  // Open the file again (by its name) before writing the next entries.
+  void reopen() { _reopen = true; }
+
+  // Whether entries of the level are written.
+  bool enabled(Level level) const { return level <= _level; }
+  // Whether to log the next request (at the given level): every
+  // sampleRate-th one is.
+  bool sample(Level level);
+  // Log an entry (the text behind the timestamp and the level, longer ones
+  // are cut). Entries of levels not enabled are ignored. Returns false if
+  // the entry was dropped.
+  bool log(Level level, string_view text);
+
+  // The number of entries dropped because the ring buffer was full.
+  size_t dropped() const { return _dropped; }
+
+  // Append text in double quotes, with quotes, backslashes and control
+  // characters escaped (so each entry stays on one line).
+  static void appendQuoted(string_view text, string* out);
+
+ private:
+  // An entry in the ring buffer. sequence tells producers and the writer
+  // whose turn it is (see push and pop).
+  static const size_t maxLength = 500;
+  struct Slot {
+    std::atomic<size_t> sequence;
+    int64_t microseconds;
+    Level level;
+    uint16_t length;
+    char text[maxLength];  // NOLINT(runtime/arrays)
+  };
+
+  // Put an entry into the ring buffer (false if it is full) and take the
+  // oldest one out of it (false if it is empty). A bounded queue of
+  // Dmitry Vyukov: producers reserve a slot with a compare-and-swap on
+  // _head, the writer is the only consumer.
+  FRIEND_TEST(AccessLog, ringBuffer);
+  bool push(Level level, int64_t microseconds, string_view text);
+  bool pop(Slot* entry);
+
+  // Write the entries until the log is closed (in the writer thread).
+  void write();
+  // Append an entry as a line to the file.
+  void writeEntry(Slot const& entry);
+  // Open the file (again, false if that fails) and rotate it.
+  bool openFile();
+  void rotate();
+
+  std::unique_ptr<Slot[]> _slots;
+  size_t _mask;
+  std::atomic<size_t> _head;
+  size_t _tail;
+  std::atomic<size_t> _dropped;
+  std::atomic<size_t> _requests;
+
+  std::atomic<Level> _level;
+  size_t _sampleRate;
+  string _fileName;
+  size_t _maxBytes;
+  size_t _numberOfFiles;
+  FILE* _file;
+  size_t _fileSize;
+  std::atomic<bool> _reopen;
+  std::atomic<bool> _stop;
+  std::thread _writer;
+  // The line of the entry being written.
+  string _line;
+};
+
+#endif  // ACCESSLOG_H_
@@ -0,0 +1,156 @@
+// Copyright 2012, Milan Oberkirch
+// Author: Milan Oberkirch <oberkirm@informatik.uni-freiburg.de>
+
+#include <gtest/gtest.h>
+#include <fstream>  // NOLINT
+#include <string>
+#include <thread>
+#include <vector>
+#include "./AccessLog.h"
+
+using std::string;
+using std::vector;
+
+const char logFileName[] = "AccessLog.test.tmp";
+
+// The lines of a file without their timestamps.
+static vector<string> readEntries(string const& fileName) {
+  std::ifstream file(fileName.c_str());
+  vector<string> entries;
+  string line;
+  while (std::getline(file, line)) entries.push_back(line.substr(25));
+  return entries;
+}
+
+// ___________________________________________________________________________
+TEST(AccessLog, ringBuffer) {
+  AccessLog log(3);
+  AccessLog::Slot entry;
+  EXPECT_FALSE(log.pop(&entry));
+  // Room for 4 entries (the capacity rounded up).
+  EXPECT_TRUE(log.push(AccessLog::INFO, 1, "a"));
+  EXPECT_TRUE(log.push(AccessLog::ERROR, 2, "b"));
+  EXPECT_TRUE(log.push(AccessLog::INFO, 3, "c"));
+  EXPECT_TRUE(log.push(AccessLog::INFO, 4, "d"));
+  EXPECT_FALSE(log.push(AccessLog::INFO, 5, "e"));
+  ASSERT_TRUE(log.pop(&entry));
+  EXPECT_EQ(1, entry.microseconds);
+  EXPECT_EQ(AccessLog::INFO, entry.level);
+  EXPECT_EQ("a", string(entry.text, entry.length));
+  // Its slot is free again.
+  EXPECT_TRUE(log.push(AccessLog::DEBUG, 6, string(1000, 'f')));
+  for (char c = 'b'; c <= 'd'; ++c) {
+    ASSERT_TRUE(log.pop(&entry));
+    EXPECT_EQ(string(1, c), string(entry.text, entry.length));
+  }
+  // Long texts are cut.
+  ASSERT_TRUE(log.pop(&entry));
+  EXPECT_EQ(AccessLog::maxLength, entry.length);
+  EXPECT_FALSE(log.pop(&entry));
+
+  // Several threads at once, each entry arrives once.
+  AccessLog shared(1024);
+  vector<std::thread> threads;
+  for (size_t i = 0; i < 4; ++i) {
+    threads.push_back(std::thread([&shared, i]() {
+      for (size_t j = 0; j < 200; ++j)
+        ASSERT_TRUE(shared.push(AccessLog::INFO, i * 200 + j, "x"));
+    }));
+  }
+  for (size_t i = 0; i < threads.size(); ++i) threads[i].join();
+  vector<bool> seen(800, false);
+  while (shared.pop(&entry)) {
+    ASSERT_LT(entry.microseconds, 800);
+    EXPECT_FALSE(seen[entry.microseconds]);
+    seen[entry.microseconds] = true;
+  }
+  EXPECT_EQ(vector<bool>(800, true), seen);
+}
+
+// ___________________________________________________________________________
+TEST(AccessLog, log) {
+  remove(logFileName);
+  AccessLog log;
+  // Nothing is logged before open.
+  EXPECT_FALSE(log.enabled(AccessLog::ERROR));
+  EXPECT_TRUE(log.log(AccessLog::ERROR, "before"));
+  ASSERT_TRUE(log.open(logFileName, AccessLog::INFO));
+  EXPECT_TRUE(log.enabled(AccessLog::INFO));
+  EXPECT_FALSE(log.enabled(AccessLog::DEBUG));
+  EXPECT_TRUE(log.log(AccessLog::INFO, "id=1 request=\"GET /\""));
+  EXPECT_TRUE(log.log(AccessLog::DEBUG, "id=1 path=\"www/index.html\""));
+  EXPECT_TRUE(log.log(AccessLog::ERROR, "id=2 error=\"404\""));
+  log.close();
+  vector<string> entries = readEntries(logFileName);
+  ASSERT_EQ(2, entries.size());
+  EXPECT_EQ("info id=1 request=\"GET /\"", entries[0]);
+  EXPECT_EQ("error id=2 error=\"404\"", entries[1]);
+  EXPECT_EQ(0, log.dropped());
+
+  // Lines are appended to the file, with a timestamp in UTC.
+  ASSERT_TRUE(log.open(logFileName, AccessLog::DEBUG));
+  log.log(AccessLog::DEBUG, "id=3");
+  log.close();
+  std::ifstream file(logFileName);
+  string line;
+  for (size_t i = 0; i < 3; ++i) std::getline(file, line);
+  ASSERT_EQ(35, line.size());
+  EXPECT_EQ('T', line[10]);
+  EXPECT_EQ(".", line.substr(19, 1));
+  EXPECT_EQ("Z debug id=3", line.substr(23));
+  remove(logFileName);
+
+  EXPECT_FALSE(log.open("no-such-directory/log", AccessLog::INFO));
+}
+
+// ___________________________________________________________________________
+TEST(AccessLog, sample) {
+  AccessLog log;
+  EXPECT_FALSE(log.sample(AccessLog::INFO));
+  ASSERT_TRUE(log.open(logFileName, AccessLog::INFO, 3));
+  size_t sampled = 0;
+  for (size_t i = 0; i < 30; ++i) sampled += log.sample(AccessLog::INFO);
+  EXPECT_EQ(10, sampled);
+  EXPECT_FALSE(log.sample(AccessLog::DEBUG));
+  log.close();
+  remove(logFileName);
+}
+
+// ___________________________________________________________________________
+TEST(AccessLog, rotate) {
+  string first = string(logFileName) + ".1";
+  string second = string(logFileName) + ".2";
+  remove(logFileName);
+  remove(first.c_str());
+  remove(second.c_str());
+  // Each entry has 32 bytes, the file is rotated behind the fourth.
+  AccessLog log;
+  ASSERT_TRUE(log.open(logFileName, AccessLog::INFO, 1, 100, 2));
+  for (size_t i = 0; i < 10; ++i) log.log(AccessLog::INFO, std::to_string(i));
+  log.close();
+  vector<string> entries = readEntries(logFileName);
+  ASSERT_EQ(2, entries.size());
+  EXPECT_EQ("info 8", entries[0]);
+  EXPECT_EQ("info 9", entries[1]);
+  entries = readEntries(first);
+  ASSERT_EQ(4, entries.size());
+  EXPECT_EQ("info 4", entries[0]);
+  entries = readEntries(second);
+  ASSERT_EQ(4, entries.size());
+  EXPECT_EQ("info 0", entries[0]);
+  remove(logFileName);
+  remove(first.c_str());
+  remove(second.c_str());
+}
+
+// ___________________________________________________________________________
+TEST(AccessLog, appendQuoted) {
+  string out = "request=";
+  AccessLog::appendQuoted("GET /?q=\"a\\b\"\n", &out);
+  EXPECT_EQ("request=\"GET /?q=\\\"a\\\\b\\\"\\x0a\"", out);
+  AccessLog::Level level;
+  EXPECT_TRUE(AccessLog::parseLevel("debug", &level));
+  EXPECT_EQ(AccessLog::DEBUG, level);
+  EXPECT_FALSE(AccessLog::parseLevel("verbose", &level));
+  EXPECT_EQ(string("error"), AccessLog::levelName(AccessLog::ERROR));
+}
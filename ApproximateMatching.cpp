@@ -3,13 +3,20 @@
 
 #include "./ApproximateMatching.h"
 #include <boost/bind.hpp>
+#include <stdint.h>
+#include <chrono>
 #include <cstdlib>
 #include <algorithm>
 #include <map>
 #include <string>
 #include <vector>
 #include <utility>
-#include "./InvertedIndex.h"
+#include "./FlatVector.h"
+#include "./IndexFile.h"
+#include "./Metrics.h"
+#include "./SegmentedIndex.h"
+#include "./StringTable.h"
+#include "./TermDictionary.h"
 
 using std::map;
 using std::pair;
@@ -20,7 +27,7 @@ using std::max;
 
 // ............................................................................
 void ApproximateMatching::init(
-    InvertedIndex const& index, unsigned int const& k, char const& dummyChar) {
+    SegmentedIndex const& index, unsigned int const& k, char const& dummyChar) {
   _kGramLength = k;
   _dummyChar = dummyChar;
   buildIndex(index);
@@ -28,21 +35,22 @@ void ApproximateMatching::init(
 
 // ............................................................................
 void ApproximateMatching::
-buildIndex(InvertedIndex const& invertedIndex) {
-  clock_t start = clock();
+buildIndex(SegmentedIndex const& invertedIndex) {
+  std::chrono::steady_clock::time_point start =
+    std::chrono::steady_clock::now();
   // This is expensive but saves some time in more frequently called methods
   vector<pair<size_t, string> >wordFrequencies;
-  for (map<string, vector<Posting> >::const_iterator
-      it = invertedIndex.invertedLists().begin();
-      it != invertedIndex.invertedLists().end(); ++it) {
-    wordFrequencies.push_back(
-        pair<size_t, string>(it->second.size(), it->first));
+  TermDictionary const& vocabulary = invertedIndex.words();
+  for (size_t wordId = 0; wordId < vocabulary.size(); ++wordId) {
+    wordFrequencies.push_back(pair<size_t, string>(
+          invertedIndex.documentFrequency(wordId), vocabulary[wordId]));
   }
   // sort by document frequencies
   std::sort(wordFrequencies.begin(), wordFrequencies.end(),
       boost::bind(&std::pair<size_t, string>::first, _1) >
       boost::bind(&std::pair<size_t, string>::first, _2));
-  // put it into _words and _invertedLists
+  // put it into _words and the k-gram lists
+  map<string, vector<uint32_t> > invertedLists;
   string word;
   unsigned int position;
   size_t wordId = 0;
@@ -53,73 +61,108 @@ buildIndex(InvertedIndex const& invertedIndex) {
     position = 0;
     word = padding + (it->second);
     while (position + _kGramLength -1 < word.size())
-      _invertedLists[word.substr(position++, _kGramLength)].push_back(wordId);
+      invertedLists[word.substr(position++, _kGramLength)].push_back(wordId);
     ++wordId;
   }
-  _indexCreationTime = (clock() - start);
+  _kGrams.clear();
+  _listOffsets.clear();
+  _wordIds.clear();
+  _listOffsets.push_back(0);
+  for (map<string, vector<uint32_t> >::iterator it = invertedLists.begin();
+      it != invertedLists.end(); ++it) {
+    _kGrams.push_back(it->first);
+    _wordIds.append(it->second.begin(), it->second.end());
+    _listOffsets.push_back(_wordIds.size());
+  }
+  _indexCreationTime = std::chrono::duration<double>(
+      std::chrono::steady_clock::now() - start).count();
 }
 
 // ............................................................................
 void ApproximateMatching::
 printInvertedLists() {
-  for (map<string, vector<size_t> >::iterator mapIt = _invertedLists.begin();
-      mapIt != _invertedLists.end(); ++mapIt) {
-    std::cout << mapIt->first << "\t";
-    for (vector<size_t>::iterator vectorIt = mapIt->second.begin();
-        vectorIt != mapIt->second.end(); ++vectorIt)
-      std::cout << *vectorIt << " ";
+  for (size_t kGramId = 0; kGramId < _kGrams.size(); ++kGramId) {
+    std::cout << _kGrams[kGramId] << "\t";
+    for (size_t i = _listOffsets[kGramId]; i < _listOffsets[kGramId + 1]; ++i)
+      std::cout << _wordIds[i] << " ";
     std::cout << std::endl;
   }
 }
 
+// ............................................................................
+void ApproximateMatching::writeToFile(IndexFileWriter* file) const {
+  file->writeValue<uint32_t>(_kGramLength);
+  file->writeValue<char>(_dummyChar);
+  _words.writeToFile(file);
+  _kGrams.writeToFile(file);
+  file->write(_listOffsets);
+  file->write(_wordIds);
+}
+
+// ............................................................................
+void ApproximateMatching::readFromFile(
+    std::shared_ptr<IndexFileReader> const& file) {
+  _indexFile = file;
+  _indexCreationTime = 0;
+  _kGramLength = file->readValue<uint32_t>();
+  _dummyChar = file->readValue<char>();
+  _words.readFromFile(file.get());
+  _kGrams.readFromFile(file.get());
+  file->read(&_listOffsets);
+  file->read(&_wordIds);
+  if (_listOffsets.size() != _kGrams.size() + 1
+      || _listOffsets.back() != _wordIds.size())
+    throw IndexFileError("Index file contains inconsistent k-gram lists.");
+}
+
 // ............................................................................
 vector<string> ApproximateMatching::
 computeApproximateMatches(string const& word,
     unsigned int const& maxEditDistance, const int& numberOfResults) const {
-  vector<size_t> candidates;
-  vector<size_t> newCandidates;
-  size_t id;
   vector<string> result;
 
   // If the Edit-Distance is allowed to be bigger than the input-length,
   // the whole vocabulary matches
   if (word.size() < maxEditDistance + (_kGramLength - 1)) {
-    for (vector<string>::const_iterator it = _words.begin();
-        it < min(_words.end(), _words.begin() + numberOfResults); ++it)
-      result.push_back(*it);
+    for (size_t id = 0;
+        id < min<size_t>(_words.size(), numberOfResults); ++id)
+      result.push_back(_words[id].to_string());
     return result;
   }
 
-  // merge lists of the k-grams of word
+  // the lists of the k-grams of word
+  Metrics::Timer candidatesTimer(_metrics, Metrics::FUZZY);
   string padding(_kGramLength - 1, _dummyChar);
   string paddedWord = padding + word;
-  vector< vector<size_t> > lists;
+  vector<IdRange> lists;
 
+  size_t kGramId;
   for (unsigned int pos = 0; pos + _kGramLength - 1 < paddedWord.size(); ++pos)
-    if (_invertedLists.find(
-          paddedWord.substr(pos, _kGramLength)) != _invertedLists.end())
-      lists.push_back(_invertedLists.at(paddedWord.substr(pos, _kGramLength)));
-  candidates = mergeInvertedLists(lists);
-
-  // Find all candidates for which the edit distance is at most the
-  // maxEditDistance.
-  int sub = _kGramLength * maxEditDistance;
-  for (vector<size_t>::iterator it = candidates.begin();
-      it < candidates.end() && it >= candidates.begin(); ++it) {
-    id = *it;
-    int jump = max<int>(0, word.size() - sub);
-    if ((it + jump < candidates.end() && *(it + jump) == id) &&
-        (newCandidates.empty() || newCandidates.back() != id))
-      newCandidates.push_back(id);
-  }
+    if (_kGrams.find(string_view(paddedWord).substr(pos, _kGramLength),
+          &kGramId))
+      lists.push_back(IdRange(_wordIds.begin() + _listOffsets[kGramId],
+            _wordIds.begin() + _listOffsets[kGramId + 1]));
+
+  // Each edit operation changes at most k of the |word| k-grams of the
+  // padded word, so the candidates have to share at least
+  // |word| - k * maxEditDistance of them.
+  size_t changedKGrams = _kGramLength * maxEditDistance;
+  size_t minCount = word.size() > changedKGrams
+    ? word.size() - changedKGrams : 1;
+  vector<size_t> candidates;
+  filterCandidates(lists, minCount, max(numberOfResults, 0), &candidates);
+  candidatesTimer.stop();
 
-  // Pusch all remaining newCandidates with
-  // Edit-Distance < maxEditDistance into result
-  for (vector<size_t>::iterator it = newCandidates.begin();
-      it < min(newCandidates.end(), newCandidates.begin() + numberOfResults);
-      ++it)
-    if (computeEditDistance(word, _words[*it], true) < maxEditDistance + 1)
-      result.push_back(_words[*it]);
+  // Pusch all candidates with
+  // Edit-Distance <= maxEditDistance into result
+  Metrics::Timer editDistanceTimer(_metrics, Metrics::EDIT_DISTANCE);
+  for (vector<size_t>::iterator it = candidates.begin();
+      it < candidates.end(); ++it)
+    if (computeEditDistance(word, _words[*it], true, maxEditDistance)
+        <= maxEditDistance)
+      result.push_back(_words[*it].to_string());
+  editDistanceTimer.stop();
+  if (_metrics) _metrics->record(Metrics::FUZZY_MATCHES, result.size());
   /* for debugging:
      std::cout << "candidates are: { ";
      for (vector<size_t>::iterator it = candidates.begin();
@@ -127,12 +170,6 @@ computeApproximateMatches(string const& word,
      std::cout << *it << " ";
      std::cout << "}\n";
 
-     std::cout << "newCandidates are: { ";
-     for (vector<size_t>::iterator it = newCandidates.begin();
-     it < newCandidates.end(); ++it)
-     std::cout << *it << " ";
-     std::cout << "}\n";
-
      std::cout << "results are: { ";
      for (vector<string>::iterator it = result.begin();
      it < result.end(); ++it)
@@ -145,84 +182,132 @@ computeApproximateMatches(string const& word,
 
 // ............................................................................
 unsigned int ApproximateMatching::computeEditDistance(
-    string const& word1, string const& word2, bool prefix) const {
-  size_t ped = -1;
-  size_t m[word1.length() + 1][word2.length() + 1];
-  for (size_t i = 0; i < word1.length() + 1; ++i) {
-    m[i][0] = i;
-  }
-  for (size_t j = 0; j < word2.length() + 1; ++j) {
-    m[0][j] = j;
-  }
-  for (size_t i = 1; i < word1.length() + 1; ++i) {
-    for (size_t j = 1; j < word2.length() + 1; ++j) {
-      m[i][j] =
-        min(
-            min(
-              m[i - 1][j - 1]
-              + (word1[i - 1] == word2
-                [j - 1] ? 0 : 1), m[i - 1][j] + 1),
-            m[i][j - 1] + 1);
-      ped = min(ped, m[word1.length()][j]);
-    }
-  }
-  return prefix ? ped : m[word1.length()][word2.length()];
+    string_view word1, string_view word2, bool prefix,
+    unsigned int maxEditDistance) const {
+  if (word1.size() <= 64)
+    return bitParallelEditDistance(word1, word2, prefix, maxEditDistance);
+  return bandedEditDistance(word1, word2, prefix, maxEditDistance);
 }
 
 // ............................................................................
-vector<size_t> ApproximateMatching::mergeInvertedLists(
-    vector< vector<size_t> > invertedLists) const {
-  vector<size_t> result;
+size_t ApproximateMatching::bitParallelEditDistance(string_view word1,
+    string_view word2, bool prefix, size_t maxEditDistance) {
+  size_t m = word1.size();
+  size_t n = word2.size();
+  size_t tooFar = maxEditDistance + 1;
+  if (m == 0) return min(prefix ? 0 : n, tooFar);
+  // The distance to word2 (to its prefixes of length j) is at least
+  // |m - n| (j - m).
+  if (!prefix && max(m, n) - min(m, n) >= tooFar) return tooFar;
+  if (prefix) n = min(n, m + maxEditDistance);
 
-  if (invertedLists.empty())
-    return result;
+  // Bit i of match[c] is set if word1[i] == c. Only the entries of the chars
+  // of word1 are set, and they are reset at the end.
+  static thread_local uint64_t match[256];
+  for (size_t i = 0; i < m; ++i)
+    match[static_cast<unsigned char>(word1[i])] |= uint64_t(1) << i;
 
-  if (invertedLists.size() == 2) {
-    result.resize(invertedLists[0].size() +  invertedLists[1].size());
-    std::merge(invertedLists[0].begin(), invertedLists[0].end(),
-        invertedLists[1].begin(), invertedLists[1].end(), result.begin());
-    return result;
+  // Bit i of the vertical deltas positive / negative is set if the cell of
+  // row i + 1 of the current column is one larger / smaller than the cell
+  // above. In column 0 all cells are one larger.
+  uint64_t lastRow = uint64_t(1) << (m - 1);
+  uint64_t positive = m == 64 ? ~uint64_t(0) : (lastRow << 1) - 1;
+  uint64_t negative = 0;
+  size_t distance = m;
+  size_t best = m;
+  for (size_t j = 0; j < n; ++j) {
+    uint64_t equal = match[static_cast<unsigned char>(word2[j])];
+    uint64_t vertical = equal | negative;
+    uint64_t horizontal = (((equal & positive) + positive) ^ positive) | equal;
+    // The horizontal deltas (of the cell to its left).
+    uint64_t horizontalPositive = negative | ~(horizontal | positive);
+    uint64_t horizontalNegative = positive & horizontal;
+    if (horizontalPositive & lastRow) ++distance;
+    else if (horizontalNegative & lastRow) --distance;
+    best = min(best, distance);
+    // Row 0 is j + 1, one larger than its left neighbour.
+    horizontalPositive = (horizontalPositive << 1) | 1;
+    horizontalNegative <<= 1;
+    positive = horizontalNegative | ~(vertical | horizontalPositive);
+    negative = horizontalPositive & vertical;
+    // The distance decreases by at most one per column.
+    if (prefix && best == 0) break;
+    if (!prefix && distance >= tooFar + (n - j - 1)) break;
   }
 
-  vector<size_t> list1 = invertedLists.back();
-  invertedLists.pop_back();
-  vector<size_t> list2 = mergeInvertedLists(invertedLists);
-  result.resize(list1.size() + list2.size());
+  for (size_t i = 0; i < m; ++i)
+    match[static_cast<unsigned char>(word1[i])] = 0;
+  return min(prefix ? best : distance, tooFar);
+}
 
-  std::merge(
-      list1.begin(), list1.end(), list2.begin(), list2.end(), result.begin());
+// ............................................................................
+size_t ApproximateMatching::bandedEditDistance(string_view word1,
+    string_view word2, bool prefix, size_t maxEditDistance) {
+  size_t m = word1.size();
+  size_t n = word2.size();
+  size_t tooFar = maxEditDistance + 1;
+  if (!prefix && max(m, n) - min(m, n) >= tooFar) return tooFar;
+  if (prefix) n = min(n, m + maxEditDistance);
 
-  return result;
+  // Two rows of the matrix. Cell (i, j) is at least |i - j|, so only the
+  // cells with |i - j| <= maxEditDistance are computed, the cells next to
+  // them are set to tooFar.
+  vector<size_t> row(n + 1);
+  vector<size_t> nextRow(n + 1);
+  for (size_t j = 0; j <= n; ++j) row[j] = min(j, tooFar);
+  for (size_t i = 1; i <= m; ++i) {
+    size_t first = i > maxEditDistance ? i - maxEditDistance : 0;
+    size_t last = min(n, i + maxEditDistance);
+    if (first > 0) nextRow[first - 1] = tooFar;
+    if (last < n) nextRow[last + 1] = tooFar;
+    size_t rowMinimum = tooFar;
+    for (size_t j = first; j <= last; ++j) {
+      if (j == 0) {
+        nextRow[0] = min(i, tooFar);
+      } else {
+        size_t replace = row[j - 1] + (word1[i - 1] == word2[j - 1] ? 0 : 1);
+        nextRow[j] = min(min(replace, min(row[j], nextRow[j - 1]) + 1),
+            tooFar);
+      }
+      rowMinimum = min(rowMinimum, nextRow[j]);
+    }
+    // The minimum of a row never decreases with the rows.
+    if (rowMinimum == tooFar) return tooFar;
+    row.swap(nextRow);
+  }
+
+  if (!prefix) return row[n];
+  size_t first = m > maxEditDistance ? m - maxEditDistance : 0;
+  return *std::min_element(row.begin() + first, row.end());
 }
 
-/* It sayed "union(!)" (yes, with the '!') :(
-   vector< vector<size_t> >::iterator invertedListsIt = invertedLists.begin();
-   vector<size_t> result(*invertedListsIt++);
-
-   for (;invertedListsIt < invertedLists.end(); ++invertedListsIt) {
-   vector<size_t>::iterator i = result.begin();
-   vector<size_t>::iterator j = (*invertedListsIt).begin();
-   vector<size_t> newResult;
-   while (i < result.end() && j < (*invertedListsIt).end()) {
-   while (j < (*invertedListsIt).end() && *i > *j) newResult.push_back(*j++);
-   if (j == (*invertedListsIt).end()) {
-   for (;i < result.end(); ++i)
-   newResult.push_back(*i);
-   break;
-   }
-   while (i < result.end() && *j > *i) newResult.push_back(*i++);
-   if (i == (*invertedListsIt).end()) break;
-   if (i == result.end()) {
-   for (;j < (*invertedListsIt).end(); ++j)
-   newResult.push_back(*j);
-   break;
-   }
-   if (*i == *j) {
-   newResult.push_back(*i++);
-   ++j;
-   }
-   }
-   result = newResult;
-   }
-   return result;
-   } */
+// ............................................................................
+void ApproximateMatching::filterCandidates(vector<IdRange> const& lists,
+    size_t minCount, size_t maxCandidates, vector<size_t>* ids) {
+  // ScanCount: count the occurrences of each id in an array indexed by id,
+  // which is all zero between calls. An id is a candidate when its count
+  // reaches minCount.
+  static thread_local vector<uint32_t> counts;
+  for (size_t i = 0; i < lists.size(); ++i) {
+    // The lists are sorted, the last id is the largest.
+    if (lists[i].first != lists[i].second
+        && lists[i].second[-1] >= counts.size())
+      counts.resize(lists[i].second[-1] + 1);
+  }
+  size_t begin = ids->size();
+  for (size_t i = 0; i < lists.size(); ++i) {
+    for (uint32_t const* id = lists[i].first; id != lists[i].second; ++id)
+      if (++counts[*id] == minCount) ids->push_back(*id);
+  }
+  for (size_t i = 0; i < lists.size(); ++i) {
+    for (uint32_t const* id = lists[i].first; id != lists[i].second; ++id)
+      counts[*id] = 0;
+  }
+  // The candidates with the smallest ids.
+  if (ids->size() - begin > maxCandidates) {
+    std::nth_element(ids->begin() + begin, ids->begin() + begin + maxCandidates,
+        ids->end());
+    ids->resize(begin + maxCandidates);
+  }
+  std::sort(ids->begin() + begin, ids->end());
+}
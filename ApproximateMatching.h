@@ -5,11 +5,18 @@
 #define APPROXIMATEMATCHING_H_
 
 #include <gtest/gtest.h>
+#include <limits.h>
+#include <stdint.h>
 #include <map>
+#include <memory>
 #include <string>
 #include <vector>
 #include <utility>
-#include "./InvertedIndex.h"
+#include "./IndexFile.h"
+#include "./Metrics.h"
+#include "./SegmentedIndex.h"
+#include "./StringTable.h"
+#include "./TermDictionary.h"
 
 using std::map;
 using std::string;
@@ -20,36 +27,48 @@ class ApproximateMatching {
   // See http://en.wikipedia.org/wiki/n-gram (with  n == k)
   unsigned int _kGramLength;
   // Stores words by implicitly mapping them to ids (as positions)
-  vector<string> _words;
-  // Maps k-grams to their word-ids.
-  map<string, vector<size_t> > _invertedLists;
+  StringTable _words;
+  // The k-grams (with their ids) and the ids of the words containing them.
+  // The list of k-gram i is _wordIds[_listOffsets[i].._listOffsets[i + 1]).
+  TermDictionary _kGrams;
+  FlatVector<uint64_t> _listOffsets;
+  FlatVector<uint32_t> _wordIds;
   // The char used to fill up length of grams whichi would have less then k
   // chars.
   char _dummyChar;
 
-  // Mechurements
-  clock_t _indexCreationTime;
-  vector<clock_t> _editDistanceTimes;
-  vector<clock_t> _queryComputationTimes;
-  vector<size_t> _matchesCounts;
+  // Mechurements: the seconds building the index took (0 if it was read)
+  // and the metrics the times and results of queries are recorded in (see
+  // setMetrics).
+  double _indexCreationTime;
+  Metrics* _metrics;
+
+  // The mapped file the index was read from (if any).
+  std::shared_ptr<IndexFileReader> _indexFile;
 
  public:
+  // A sorted list of word ids, as range in _wordIds.
+  typedef pair<uint32_t const*, uint32_t const*> IdRange;
+
   // Getter to previously described members.
   /** EVIL!
   const char *dummyChar = &_dummyChar;
   const unsigned int *k = &_kGramLength;
-  const vector<string> *words = &_words;
-  const map<string, vector<size_t> > *invertedLists = &_invertedLists;
+  const StringTable *words = &_words;
   */
   const char& dummyChar() const { return _dummyChar; }
   const unsigned int k() const { return _kGramLength; }
-  const vector<string>& words() const { return _words; }
-  const map<string, vector<size_t> >& invertedLists() const {
-    return _invertedLists;
-  }
+  const StringTable& words() const { return _words; }
+  double indexCreationTime() const { return _indexCreationTime; }
+
+  ApproximateMatching() : _indexCreationTime(0), _metrics(NULL) {}
+  // Record the time finding candidates (Metrics::FUZZY) and computing their
+  // edit distances takes and the number of matches of each query in
+  // metrics (none by default).
+  void setMetrics(Metrics* metrics) { _metrics = metrics; }
 
   // Set the member-variables, needed for buildIndex
-  void init(InvertedIndex const& index, unsigned int const& k,
+  void init(SegmentedIndex const& index, unsigned int const& k,
       char const& dummyChar = '+');
 
   // Returns all words within the given maxEditDistance from the proviously
@@ -61,21 +80,42 @@ class ApproximateMatching {
   // Prints the invertedLists
   void printInvertedLists();
 
+  // Append the k-gram index to a binary index file.
+  void writeToFile(IndexFileWriter* file) const;
+  // Read a k-gram index written by writeToFile (instead of init). The words
+  // are used directly from the mapped file.
+  void readFromFile(std::shared_ptr<IndexFileReader> const& file);
+
  private:
   bool pairsAreInRightOrder(
     pair<size_t, string> const& p1, pair<size_t, string> const& p2);
   // Build a k-gram index for the vocabluary.
-  void buildIndex(InvertedIndex const& invertedIndex);
-  // See http://en.wikipedia.org/wiki/Edit_distance.
-  // Needs O(|word1| * |word2|).
+  void buildIndex(SegmentedIndex const& invertedIndex);
+  // See http://en.wikipedia.org/wiki/Edit_distance. With prefix, the
+  // smallest edit distance of word1 and a prefix of word2. Distances larger
+  // than maxEditDistance are not computed exactly: for them some value larger
+  // than maxEditDistance is returned, which allows to stop early.
   FRIEND_TEST(ApproximateMatching, computeEditDistance);
   unsigned int computeEditDistance(
-      string const& word1, string const& word2, bool prefix = false) const;
+      string_view word1, string_view word2, bool prefix = false,
+      unsigned int maxEditDistance = UINT_MAX) const;
+  // The kernels of computeEditDistance. Both return the distance, or
+  // maxEditDistance + 1 if it is larger. bitParallelEditDistance computes
+  // all rows of a column at once in the bits of a word (Myers/Hyyrö, see
+  // http://dx.doi.org/10.1145/316542.316550) and needs |word1| <= 64.
+  // bandedEditDistance only computes the cells within maxEditDistance of the
+  // diagonal (Ukkonen).
+  FRIEND_TEST(ApproximateMatching, editDistanceKernels);
+  static size_t bitParallelEditDistance(string_view word1,
+      string_view word2, bool prefix, size_t maxEditDistance);
+  static size_t bandedEditDistance(string_view word1, string_view word2,
+      bool prefix, size_t maxEditDistance);
 
-  // Returns the ids of the union of invertedLists.
-  FRIEND_TEST(ApproximateMatching, mergeInvertedLists);
-  vector<size_t> mergeInvertedLists(
-      vector< vector<size_t> > invertedLists) const;
+  // Append the ids contained at least minCount times in the lists to ids (in
+  // increasing order), at most the maxCandidates smallest of them.
+  FRIEND_TEST(ApproximateMatching, filterCandidates);
+  static void filterCandidates(vector<IdRange> const& lists, size_t minCount,
+      size_t maxCandidates, vector<size_t>* ids);
 };
 
 #endif  // APPROXIMATEMATCHING_H_
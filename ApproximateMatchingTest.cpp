@@ -2,16 +2,19 @@
 // Author: Milan Oberkirch <oberkirm@informatik.uni-freiburg.de>
 
 #include <gtest/gtest.h>
+#include <stdlib.h>
+#include <algorithm>
 #include <fstream>  // NOLINT
 #include <vector>
 #include <string>
 #include "./ApproximateMatching.h"
 
 using std::string;
+using std::vector;
 
 const char mockupFileName[] = "ApproximateMatching.test.tmp";
 ApproximateMatching approximateMatching;
-InvertedIndex ii;
+SegmentedIndex ii;
 
 // ___________________________________________________________________________
 TEST(ApproximateMatching, createMockup) {
@@ -34,29 +37,32 @@ TEST(ApproximateMatching, init) {
 }
 
 // ___________________________________________________________________________
-TEST(ApproximateMatching, mergeInvertedLists) {
-  ApproximateMatching approximateMatching;
-  vector< vector<size_t> > input = { {1, 3, 4, 6, 9, 11}, {2, 5, 7, 8, 10} };
+TEST(ApproximateMatching, filterCandidates) {
+  vector< vector<uint32_t> > input = { {1, 3, 4, 6, 9, 11}, {2, 5, 7, 8, 10} };
+  vector<ApproximateMatching::IdRange> lists;
+  for (size_t i = 0; i < input.size(); ++i)
+    lists.push_back(ApproximateMatching::IdRange(
+          input[i].data(), input[i].data() + input[i].size()));
   vector<size_t> expected = {1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11};
-  vector<size_t> result = approximateMatching.mergeInvertedLists(input);
-
-  // When I do an assert here, it is legit to only check one iterator in the
-  // following loop
-  ASSERT_EQ(expected.size(), result.size());
-  vector<size_t>::iterator itExpected = expected.begin();
-  vector<size_t>::iterator itResult = result.begin();
-  for (; itExpected < expected.end(); ++itExpected, ++itResult)
-    EXPECT_EQ(*itExpected, *itResult);
-
-  // More then two lists, with dublicats
-  input = { {1, 2, 3, 10}, {2, 3, 4}, {1, 4, 6, 8}, {5, 7, 9} };
-  expected = {1, 1, 2, 2, 3, 3, 4, 4, 5, 6, 7, 8, 9, 10};
-  result = approximateMatching.mergeInvertedLists(input);
-  ASSERT_EQ(expected.size(), result.size());
-  itExpected = expected.begin();
-  itResult = result.begin();
-  for (; itExpected < expected.end(); ++itExpected, ++itResult)
-    EXPECT_EQ(*itExpected, *itResult);
+  vector<size_t> result;
+  ApproximateMatching::filterCandidates(lists, 1, 100, &result);
+  EXPECT_EQ(expected, result);
+
+  // More then two lists, with dublicats (also within a list) and an empty
+  // list. Only ids contained twice, only the first three of them.
+  input = { {1, 2, 3, 10}, {2, 3, 4}, {}, {1, 4, 6, 8}, {5, 7, 7, 9} };
+  lists.clear();
+  for (size_t i = 0; i < input.size(); ++i)
+    lists.push_back(ApproximateMatching::IdRange(
+          input[i].data(), input[i].data() + input[i].size()));
+  expected = {1, 2, 3, 4, 7};
+  result.clear();
+  ApproximateMatching::filterCandidates(lists, 2, 100, &result);
+  EXPECT_EQ(expected, result);
+  expected = {1, 2, 3};
+  result.clear();
+  ApproximateMatching::filterCandidates(lists, 2, 3, &result);
+  EXPECT_EQ(expected, result);
 }
 
 // ___________________________________________________________________________
@@ -85,6 +91,48 @@ TEST(ApproximateMatching, computeEditDistance) {
   EXPECT_EQ(expected, result);
 }
 
+// The (prefix) edit distance by the full matrix.
+size_t editDistance(string const& word1, string const& word2, bool prefix) {
+  vector<vector<size_t> > m(word1.size() + 1,
+      vector<size_t>(word2.size() + 1));
+  for (size_t i = 0; i <= word1.size(); ++i) m[i][0] = i;
+  for (size_t j = 0; j <= word2.size(); ++j) m[0][j] = j;
+  for (size_t i = 1; i <= word1.size(); ++i)
+    for (size_t j = 1; j <= word2.size(); ++j)
+      m[i][j] = std::min(m[i - 1][j - 1] + (word1[i - 1] != word2[j - 1]),
+          std::min(m[i - 1][j], m[i][j - 1]) + 1);
+  vector<size_t> const& lastRow = m.back();
+  return prefix ? *std::min_element(lastRow.begin(), lastRow.end())
+    : lastRow.back();
+}
+
+// ___________________________________________________________________________
+TEST(ApproximateMatching, editDistanceKernels) {
+  srand(42);
+  for (int test = 0; test < 2000; ++test) {
+    // Words over few chars, so they have long common parts.
+    string word1(rand() % 80, 'a');  // NOLINT
+    string word2(rand() % 80, 'a');  // NOLINT
+    for (size_t i = 0; i < word1.size(); ++i) word1[i] += rand() % 3;  // NOLINT
+    for (size_t i = 0; i < word2.size(); ++i) word2[i] += rand() % 3;  // NOLINT
+    size_t maxEditDistance = test % 2 ? rand() % 10 : 1000;  // NOLINT
+    for (int prefix = 0; prefix < 2; ++prefix) {
+      size_t expected = std::min(editDistance(word1, word2, prefix),
+          maxEditDistance + 1);
+      EXPECT_EQ(expected, ApproximateMatching::bandedEditDistance(
+            word1, word2, prefix, maxEditDistance));
+      if (word1.size() <= 64) {
+        EXPECT_EQ(expected, ApproximateMatching::bitParallelEditDistance(
+              word1, word2, prefix, maxEditDistance));
+      }
+    }
+  }
+  EXPECT_EQ(0, ApproximateMatching::bitParallelEditDistance(
+        string(64, 'x'), string(70, 'x'), true, 0));
+  EXPECT_EQ(1, ApproximateMatching::bitParallelEditDistance(
+        string(64, 'x'), string(63, 'x'), false, 3));
+}
+
 // ___________________________________________________________________________
 TEST(ApproximateMatching, computeApproximateMatches) {
   string input;
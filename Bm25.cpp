@@ -0,0 +1,86 @@
+// Copyright 2012, Milan Oberkirch
+// Author: Milan Oberkirch <oberkirm@informatik.uni-freiburg.de>
+
+#include "./Bm25.h"
+#include <stdint.h>
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#define BM25_SSE2
+#endif
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+// ___________________________________________________________________________
+Bm25::Parameters::Parameters() : _k(0), _b(0) {
+  std::fill(_lengthNorms, _lengthNorms + 256, 0.0f);
+}
+
+// ___________________________________________________________________________
+Bm25::Parameters::Parameters(float k, float b, float averageLength) {
+  _k = std::max(0.0f, k);
+  _b = std::max(0.0f, std::min(1.0f, b));
+  float base = _k * (1 - _b);
+  float lengthWeight = averageLength > 0 ? _k * _b / averageLength : 0;
+  for (size_t i = 0; i < 256; ++i)
+    _lengthNorms[i] = base + lengthWeight * dequantizeLength(i);
+}
+
+// ___________________________________________________________________________
+Bm25::Bm25() : _weight(0), _documentLengths(NULL) {
+  std::fill(_lengthNorms, _lengthNorms + 256, 0.0f);
+}
+
+// ___________________________________________________________________________
+Bm25::Bm25(Parameters const& parameters, size_t numberOfDocuments,
+    size_t documentFrequency, uint8_t const* documentLengths)
+  : _documentLengths(documentLengths) {
+  std::copy(parameters.lengthNorms(), parameters.lengthNorms() + 256,
+      _lengthNorms);
+  float idf = documentFrequency && numberOfDocuments > documentFrequency
+    ? log2(static_cast<float>(numberOfDocuments) / documentFrequency) : 0;
+  _weight = idf * (parameters.k() + 1);
+}
+
+// ___________________________________________________________________________
+void Bm25::scores(uint32_t const* documentIds, uint8_t const* tfs, size_t n,
+    float* scores) const {
+  // The lookups cannot be vectorized (without gathers), the rest can.
+  for (size_t i = 0; i < n; ++i)
+    scores[i] = _lengthNorms[_documentLengths[documentIds[i]]];
+  size_t i = 0;
+#ifdef BM25_SSE2
+  __m128 weight = _mm_set1_ps(_weight);
+  __m128i zero = _mm_setzero_si128();
+  for (; i + 4 <= n; i += 4) {
+    // Four term frequencies widened to floats.
+    int32_t bytes;
+    memcpy(&bytes, tfs + i, sizeof(bytes));
+    __m128i tf32 = _mm_unpacklo_epi16(
+        _mm_unpacklo_epi8(_mm_cvtsi32_si128(bytes), zero), zero);
+    __m128 tf = _mm_cvtepi32_ps(tf32);
+    __m128 lengthNorm = _mm_loadu_ps(scores + i);
+    _mm_storeu_ps(scores + i, _mm_div_ps(_mm_mul_ps(weight, tf),
+          _mm_add_ps(lengthNorm, tf)));
+  }
+#endif
+  for (; i < n; ++i) scores[i] = _weight * tfs[i] / (scores[i] + tfs[i]);
+}
+
+// ___________________________________________________________________________
+uint8_t Bm25::quantizeLength(uint32_t length) {
+  if (length < 32) return length;
+  // 16 values for each power of two from 2^5 on: the 4 bits behind the
+  // leading one.
+  int exponent = 31 - __builtin_clz(length);
+  uint32_t quantized = 32 + (exponent - 5) * 16
+    + ((length >> (exponent - 4)) & 15);
+  return std::min<uint32_t>(quantized, 255);
+}
+
+// ___________________________________________________________________________
+uint32_t Bm25::dequantizeLength(uint8_t length) {
+  if (length < 32) return length;
+  int exponent = (length - 32) / 16 + 5;
+  return (16 + (length - 32) % 16) << (exponent - 4);
+}
@@ -0,0 +1,74 @@
+// Copyright 2012, Milan Oberkirch
+// Author: Milan Oberkirch <oberkirm@informatik.uni-freiburg.de>
+
+#ifndef BM25_H_
+#define BM25_H_
+
+#include <stdint.h>
+#include <cstddef>
+
+// Okapi BM25 scores (http://en.wikipedia.org/wiki/Okapi_BM25) of the
+// postings of one word, computed at query time from the term frequency tf
+// of the word in a document and the length dl of the document:
+//   idf * tf * (k + 1) / (k * (1 - b + b * dl / avdl) + tf),
+// with idf = log2(N / df) for N documents of average length avdl, df of
+// which contain the word. Document lengths are quantized to one byte (see
+// quantizeLength).
+class Bm25 {
+ public:
+  // The parameters k and b for documents of average length avdl, with the
+  // length normalization k * (1 - b + b * dl / avdl) of each quantized
+  // length dl. They are the same for all words of a query, so they are
+  // computed once for it. k is at least 0 and b is clamped to [0, 1], so
+  // scores grow with tf and shrink with dl (the bounds of PostingList rely
+  // on this).
+  class Parameters {
+   public:
+    // k = b = 0.
+    Parameters();
+    Parameters(float k, float b, float averageLength);
+    float k() const { return _k; }
+    float b() const { return _b; }
+    float const* lengthNorms() const { return _lengthNorms; }
+
+   private:
+    float _k;
+    float _b;
+    float _lengthNorms[256];
+  };
+
+  // Scores all postings with 0.
+  Bm25();
+  // The scores of a word contained in documentFrequency of
+  // numberOfDocuments documents. documentLengths are the quantized lengths
+  // of the documents the postings refer to. Copies the length
+  // normalizations of the parameters (so they may be a temporary).
+  Bm25(Parameters const& parameters, size_t numberOfDocuments,
+      size_t documentFrequency, uint8_t const* documentLengths);
+
+  // The score for term frequency tf in a document of the given quantized
+  // length.
+  float score(uint32_t tf, uint8_t documentLength) const {
+    return _weight * tf / (_lengthNorms[documentLength] + tf);
+  }
+  // The scores of n postings with the term frequencies tfs in the
+  // documents with the given ids. The length normalizations are looked up
+  // first, then the scores are computed four at a time (with SSE2).
+  void scores(uint32_t const* documentIds, uint8_t const* tfs, size_t n,
+      float* scores) const;
+
+  // Document lengths in one byte: up to 31 exactly, larger ones with their
+  // 4 most significant bits (rounded down, so less than 6.25% too short).
+  // The largest lengths (of more than 500000 words) are all 255.
+  static uint8_t quantizeLength(uint32_t length);
+  // The smallest length quantized to the given value.
+  static uint32_t dequantizeLength(uint8_t length);
+
+ private:
+  // idf * (k + 1).
+  float _weight;
+  float _lengthNorms[256];
+  uint8_t const* _documentLengths;
+};
+
+#endif  // BM25_H_
@@ -0,0 +1,78 @@
+// Copyright 2012, Milan Oberkirch
+// Author: Milan Oberkirch <oberkirm@informatik.uni-freiburg.de>
+
+#include <gtest/gtest.h>
+#include <stdint.h>
+#include <cmath>
+#include "./Bm25.h"
+
+// ___________________________________________________________________________
+TEST(Bm25, score) {
+  uint8_t lengths[] = {10, 20, 5};
+  Bm25::Parameters parameters(1.75, 0.75, 10);
+  Bm25 bm25(parameters, 8, 2, lengths);
+  // idf = log2(8 / 2) = 2, for dl = avdl the length does not matter.
+  EXPECT_NEAR(2 * 2.75 / (1.75 + 1), bm25.score(1, 10), 1e-5);
+  EXPECT_NEAR(2 * 3 * 2.75 / (1.75 * (0.25 + 1.5) + 3), bm25.score(3, 20),
+      1e-5);
+  // Scores grow with tf and shrink with dl.
+  EXPECT_LT(bm25.score(1, 10), bm25.score(2, 10));
+  EXPECT_GT(bm25.score(1, 10), bm25.score(1, 11));
+
+  // Words in all documents and the default score 0.
+  EXPECT_EQ(0, Bm25(parameters, 8, 8, lengths).score(3, 5));
+  EXPECT_EQ(0, Bm25().score(3, 5));
+  // b is clamped to 1, so the length still lowers the score.
+  Bm25::Parameters clamped(1.75, 5, 10);
+  EXPECT_EQ(1, clamped.b());
+  EXPECT_NEAR(2 * 2.75 / (1.75 * 0.5 + 1),
+      Bm25(clamped, 8, 2, lengths).score(1, 5), 1e-5);
+}
+
+// ___________________________________________________________________________
+TEST(Bm25, scores) {
+  // More scores than fit into one vector, in documents of all lengths.
+  uint32_t documentIds[11];
+  uint8_t tfs[11];
+  uint8_t lengths[256];
+  for (size_t i = 0; i < 256; ++i) lengths[i] = 255 - i;
+  for (size_t i = 0; i < 11; ++i) {
+    documentIds[i] = i * 23;
+    tfs[i] = 1 + i * 25;
+  }
+  Bm25 bm25(Bm25::Parameters(1.2, 0.5, 40), 1000, 10, lengths);
+  float scores[11];
+  for (size_t n = 0; n <= 11; ++n) {
+    bm25.scores(documentIds, tfs, n, scores);
+    for (size_t i = 0; i < n; ++i)
+      EXPECT_FLOAT_EQ(bm25.score(tfs[i], lengths[documentIds[i]]), scores[i]);
+  }
+}
+
+// ___________________________________________________________________________
+TEST(Bm25, quantizeLength) {
+  // Short lengths are exact.
+  for (uint32_t length = 0; length < 32; ++length)
+    EXPECT_EQ(length, Bm25::quantizeLength(length));
+  // Longer ones are rounded down to 4 significant bits.
+  EXPECT_EQ(32, Bm25::dequantizeLength(Bm25::quantizeLength(33)));
+  EXPECT_EQ(34, Bm25::dequantizeLength(Bm25::quantizeLength(35)));
+  EXPECT_EQ(992, Bm25::dequantizeLength(Bm25::quantizeLength(1000)));
+  EXPECT_EQ(255, Bm25::quantizeLength(UINT32_MAX));
+  // Monotone and dequantized lengths are quantized to themselves.
+  for (uint32_t length = 1; length < 100000; ++length) {
+    ASSERT_LE(Bm25::quantizeLength(length - 1), Bm25::quantizeLength(length));
+    uint32_t dequantized = Bm25::dequantizeLength(
+        Bm25::quantizeLength(length));
+    ASSERT_LE(dequantized, length);
+    ASSERT_GT(dequantized, length * 0.93);
+  }
+  for (size_t i = 0; i < 256; ++i)
+    EXPECT_EQ(i, Bm25::quantizeLength(Bm25::dequantizeLength(i)));
+
+  // The length normalization of each quantized length.
+  Bm25::Parameters parameters(1.5, 0.5, 100);
+  EXPECT_FLOAT_EQ(0.75, parameters.lengthNorms()[0]);
+  EXPECT_FLOAT_EQ(0.75 + 0.0075 * 992,
+      parameters.lengthNorms()[Bm25::quantizeLength(1000)]);
+}
@@ -0,0 +1,121 @@
+// Copyright 2012, Milan Oberkirch
+// Author: Milan Oberkirch <oberkirm@informatik.uni-freiburg.de>
+
+#ifndef FLATVECTOR_H_
+#define FLATVECTOR_H_
+
+#include <algorithm>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+using std::vector;
+
+// A contiguous array of plain values, which either owns its elements (while
+// an index is built) or refers to the elements in a memory mapped index file
+// (after the index was read with IndexFileReader). A mapped array is copied
+// into owned memory as soon as it is modified.
+template <class T>
+class FlatVector {
+  static_assert(std::is_trivially_copyable<T>::value,
+      "FlatVector can only hold plain values.");
+
+ public:
+  typedef T const* const_iterator;
+
+  FlatVector() : _data(NULL), _size(0) {}
+  FlatVector(FlatVector const& other) { *this = other; }
+  FlatVector(FlatVector&& other) : _data(NULL), _size(0) { swap(&other); }
+  FlatVector& operator=(FlatVector&& other) {
+    FlatVector moved(std::move(other));
+    swap(&moved);
+    return *this;
+  }
+  FlatVector& operator=(FlatVector const& other) {
+    if (this == &other) return *this;
+    _owned = other._owned;
+    if (other.isMapped()) {
+      _data = other._data;
+      _size = other._size;
+    } else {
+      sync();
+    }
+    return *this;
+  }
+
+  size_t size() const { return _size; }
+  bool empty() const { return _size == 0; }
+  T const* data() const { return _data; }
+  const_iterator begin() const { return _data; }
+  const_iterator end() const { return _data + _size; }
+  T const& operator[](size_t i) const { return _data[i]; }
+  T const& back() const { return _data[_size - 1]; }
+  T const& at(size_t i) const {
+    if (i >= _size) throw std::out_of_range("FlatVector::at");
+    return _data[i];
+  }
+  // Whether the elements are in a mapped file.
+  bool isMapped() const { return _size && _data != _owned.data(); }
+
+  // Modifiers (these copy mapped elements into owned memory first).
+  T& operator[](size_t i) {
+    makeOwned();
+    return _owned[i];
+  }
+  void push_back(T const& value) {
+    makeOwned();
+    _owned.push_back(value);
+    sync();
+  }
+  void resize(size_t size, T const& value = T()) {
+    makeOwned();
+    _owned.resize(size, value);
+    sync();
+  }
+  void reserve(size_t size) {
+    makeOwned();
+    _owned.reserve(size);
+    sync();
+  }
+  void clear() {
+    vector<T>().swap(_owned);
+    sync();
+  }
+  template <class Iterator>
+  void append(Iterator first, Iterator last) {
+    makeOwned();
+    _owned.insert(_owned.end(), first, last);
+    sync();
+  }
+
+  void swap(FlatVector* other) {
+    _owned.swap(other->_owned);
+    std::swap(_data, other->_data);
+    std::swap(_size, other->_size);
+  }
+
+  // Refer to size elements at data (which must outlive this object).
+  void map(T const* data, size_t size) {
+    vector<T>().swap(_owned);
+    _data = data;
+    _size = size;
+  }
+
+ private:
+  void sync() {
+    _data = _owned.data();
+    _size = _owned.size();
+  }
+  void makeOwned() {
+    if (!isMapped()) return;
+    _owned.assign(_data, _data + _size);
+    sync();
+  }
+
+  vector<T> _owned;
+  T const* _data;
+  size_t _size;
+};
+
+#endif  // FLATVECTOR_H_
@@ -0,0 +1,184 @@
+// Copyright 2012, Milan Oberkirch
+// Author: Milan Oberkirch <oberkirm@informatik.uni-freiburg.de>
+
+#include "./HttpConnection.h"
+#include <boost/asio.hpp>
+#include <boost/bind/bind.hpp>
+#include <algorithm>
+#include <iostream>  // NOLINT
+#include <string>
+#include <vector>
+#include "./HttpRequest.h"
+
+using std::string;
+using std::vector;
+
+// Initial and maximal number of bytes of a request (header and content).
+const size_t initialRequestBufferSize = 4096;
+const size_t maxRequestLength = 65536;
+
+// Answers to requests which cannot be passed to the request handler.
+const char badRequestAnswer[] =
+  "HTTP/1.1 400 Bad Request\r\n"
+  "Content-Length: 0\r\n"
+  "Connection: close\r\n"
+  "\r\n";
+const char requestTooLargeAnswer[] =
+  "HTTP/1.1 413 Request Entity Too Large\r\n"
+  "Content-Length: 0\r\n"
+  "Connection: close\r\n"
+  "\r\n";
+
+// ___________________________________________________________________________
+HttpConnection::HttpConnection(boost::asio::io_service* ioService,
+    RequestHandler const& requestHandler, size_t idleTimeoutSeconds)
+  : _socket(*ioService),
+    _strand(*ioService),
+    _idleTimer(*ioService),
+    _idleTimeoutSeconds(idleTimeoutSeconds),
+    _requestHandler(requestHandler),
+    _requestBuffer(initialRequestBufferSize),
+    _bufferedBytes(0),
+    _request(maxRequestLength),
+    _numberOfAnswers(0),
+    _closeAfterWrite(false) {
+}
+
+// ___________________________________________________________________________
+void HttpConnection::start() {
+  startRead();
+}
+
+// ___________________________________________________________________________
+void HttpConnection::startRead() {
+  if (_bufferedBytes == _requestBuffer.size())
+    _requestBuffer.resize(std::min(2 * _requestBuffer.size(),
+          maxRequestLength));
+  startIdleTimer();
+  _socket.async_read_some(boost::asio::buffer(&_requestBuffer[_bufferedBytes],
+        _requestBuffer.size() - _bufferedBytes),
+      _strand.wrap(boost::bind(&HttpConnection::handleRead,
+          shared_from_this(),
+          boost::asio::placeholders::error,
+          boost::asio::placeholders::bytes_transferred)));
+}
+
+// ___________________________________________________________________________
+void HttpConnection::startIdleTimer() {
+  _idleTimer.expires_from_now(boost::posix_time::seconds(_idleTimeoutSeconds));
+  _idleTimer.async_wait(_strand.wrap(boost::bind(
+          &HttpConnection::handleTimeout, shared_from_this(),
+          boost::asio::placeholders::error)));
+}
+
+// ___________________________________________________________________________
+void HttpConnection::handleRead(boost::system::error_code const& error,
+    size_t bytesTransferred) {
+  boost::system::error_code ignored;
+  _idleTimer.cancel(ignored);
+  if (error) {
+    close();
+    return;
+  }
+  _bufferedBytes += bytesTransferred;
+  processRequests();
+}
+
+// ___________________________________________________________________________
+void HttpConnection::processRequests() {
+  // The answers are reused (with the memory of their heads).
+  _numberOfAnswers = 0;
+  _closeAfterWrite = false;
+  while (!_closeAfterWrite) {
+    HttpRequest::State state =
+      _request.parse(&_requestBuffer[0], _bufferedBytes);
+    if (state == HttpRequest::INCOMPLETE) break;
+    if (_numberOfAnswers == _answers.size()) _answers.push_back(Answer());
+    Answer* answer = &_answers[_numberOfAnswers++];
+    answer->head.clear();
+    answer->body.reset();
+    if (state == HttpRequest::INVALID || state == HttpRequest::TOO_LARGE) {
+      answer->head = state == HttpRequest::INVALID
+        ? badRequestAnswer : requestTooLargeAnswer;
+      _closeAfterWrite = true;
+      break;
+    }
+
+    _closeAfterWrite = !_request.keepAlive();
+    try {
+      _requestHandler(_request, answer);
+    } catch(const std::exception& e) {
+      std::cerr << "\x1b[31m" << e.what() << "\x1b[0m" << std::endl;
+      close();
+      return;
+    }
+    // Answers to HEAD have the headers (and Content-Length) of GET but no
+    // content, whichever handler computed them.
+    if (_request.method() == "HEAD") {
+      size_t end = answer->head.find("\r\n\r\n");
+      if (end != string::npos) answer->head.resize(end + 4);
+      answer->body.reset();
+    }
+
+    // Move pipelined requests to the beginning of the buffer.
+    size_t length = _request.length();
+    std::copy(_requestBuffer.begin() + length,
+        _requestBuffer.begin() + _bufferedBytes, _requestBuffer.begin());
+    _bufferedBytes -= length;
+    _request.reset();
+  }
+
+  if (_numberOfAnswers == 0) {
+    // Incomplete request: wait for the rest unless it is too large.
+    if (_bufferedBytes < maxRequestLength) {
+      startRead();
+      return;
+    }
+    if (_answers.empty()) _answers.push_back(Answer());
+    _answers[0].head = requestTooLargeAnswer;
+    _answers[0].body.reset();
+    _numberOfAnswers = 1;
+    _closeAfterWrite = true;
+  }
+
+  // Write all answers at once (scatter-gather).
+  vector<boost::asio::const_buffer> buffers;
+  for (size_t i = 0; i < _numberOfAnswers; ++i) {
+    buffers.push_back(boost::asio::buffer(_answers[i].head));
+    if (_answers[i].body)
+      buffers.push_back(boost::asio::buffer(*_answers[i].body));
+  }
+  // Clients which do not read their answers lose the connection, too.
+  startIdleTimer();
+  boost::asio::async_write(_socket, buffers,
+      _strand.wrap(boost::bind(&HttpConnection::handleWrite,
+          shared_from_this(),
+          boost::asio::placeholders::error)));
+}
+
+// ___________________________________________________________________________
+void HttpConnection::handleWrite(boost::system::error_code const& error) {
+  boost::system::error_code ignored;
+  _idleTimer.cancel(ignored);
+  if (error || _closeAfterWrite)
+    close();
+  else
+    processRequests();
+}
+
+// ___________________________________________________________________________
+void HttpConnection::handleTimeout(boost::system::error_code const& error) {
+  // The timer was canceled or restarted.
+  if (error == boost::asio::error::operation_aborted) return;
+  typedef boost::asio::deadline_timer::traits_type Clock;
+  if (_idleTimer.expires_at() <= Clock::now())
+    close();
+}
+
+// ___________________________________________________________________________
+void HttpConnection::close() {
+  boost::system::error_code ignored;
+  _idleTimer.cancel(ignored);
+  _socket.shutdown(tcp::socket::shutdown_both, ignored);
+  _socket.close(ignored);
+}
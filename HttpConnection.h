@@ -0,0 +1,82 @@
+// Copyright 2012, Milan Oberkirch
+// Author: Milan Oberkirch <oberkirm@informatik.uni-freiburg.de>
+
+#ifndef HTTPCONNECTION_H_
+#define HTTPCONNECTION_H_
+
+#include <boost/asio.hpp>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+#include "./HttpRequest.h"
+
+using boost::asio::ip::tcp;
+using std::string;
+using std::vector;
+
+// One persistent (HTTP/1.1) client connection of the SearchServer. All
+// operations on a connection are asynchronous and serialized by a strand, so
+// any number of threads may run the io_service the connection was created
+// with. Pipelined requests are answered in the order they arrived.
+class HttpConnection : public std::enable_shared_from_this<HttpConnection> {
+ public:
+  // The answer to a request: the headers (and content) in head, followed by
+  // the optional body. A body can be shared between answers (e.g. a cached
+  // file), it is sent without copying it.
+  struct Answer {
+    string head;
+    std::shared_ptr<string const> body;
+  };
+  // Computes the complete answer (headers and content) to a request.
+  typedef std::function<void(HttpRequest const&, Answer*)> RequestHandler;
+
+  HttpConnection(boost::asio::io_service* ioService,
+      RequestHandler const& requestHandler, size_t idleTimeoutSeconds = 15);
+
+  // The socket the acceptor should accept the connection on.
+  tcp::socket& socket() { return _socket; }
+
+  // Start reading the request (call after the connection was accepted).
+  void start();
+
+ private:
+  // Read more data from the socket and (re-)start the idle timer.
+  void startRead();
+  // Close the connection if the pending read or write has not finished
+  // within the idle timeout.
+  void startIdleTimer();
+  // Called when (a part of) a request was read.
+  void handleRead(boost::system::error_code const& error,
+      size_t bytesTransferred);
+  // Answer all complete requests in the buffer and send the answers.
+  void processRequests();
+  // Called when the answers were written completely.
+  void handleWrite(boost::system::error_code const& error);
+  // Called when the connection was idle (or the client did not read the
+  // answers) for too long.
+  void handleTimeout(boost::system::error_code const& error);
+  // Shut down and close the socket.
+  void close();
+
+  tcp::socket _socket;
+  boost::asio::io_service::strand _strand;
+  boost::asio::deadline_timer _idleTimer;
+  size_t _idleTimeoutSeconds;
+  RequestHandler _requestHandler;
+  // Received bytes not yet answered are _requestBuffer[0.._bufferedBytes).
+  // The buffer grows up to a maximal request length and is then reused for
+  // all requests of the connection.
+  vector<char> _requestBuffer;
+  size_t _bufferedBytes;
+  // Parser of the request at the beginning of _requestBuffer.
+  HttpRequest _request;
+  // The answers to the requests processed last. They must stay alive until
+  // the asynchronous write has finished.
+  vector<Answer> _answers;
+  size_t _numberOfAnswers;
+  // Close the connection after _answers were written.
+  bool _closeAfterWrite;
+};
+
+#endif  // HTTPCONNECTION_H_
@@ -0,0 +1,86 @@
+// Copyright 2012, Milan Oberkirch
+// Author: Milan Oberkirch <oberkirm@informatik.uni-freiburg.de>
+
+#include <gtest/gtest.h>
+#include <boost/asio.hpp>
+#include <memory>
+#include <string>
+#include <thread>
+#include "./HttpConnection.h"
+#include "./HttpRequest.h"
+
+using boost::asio::ip::tcp;
+using std::string;
+
+// Answers with the path as content, in the head (like the dynamic pages of
+// the SearchServer) or, for /file, as shared body (like static files).
+void answerPath(HttpRequest const& request, HttpConnection::Answer* answer) {
+  string content = request.path().to_string();
+  answer->head = "HTTP/1.1 200 OK\r\nContent-Length: "
+    + std::to_string(content.size()) + "\r\n\r\n";
+  if (request.path() == "/file")
+    answer->body = std::make_shared<string const>(content);
+  else
+    answer->head += content;
+}
+
+// Send the requests over one connection and read the answers until the
+// server closes it.
+string exchange(string const& requests) {
+  boost::asio::io_service ioService;
+  tcp::acceptor acceptor(ioService,
+      tcp::endpoint(boost::asio::ip::address_v4::loopback(), 0));
+  std::shared_ptr<HttpConnection> connection(
+      new HttpConnection(&ioService, answerPath));
+  acceptor.async_accept(connection->socket(),
+      [connection](boost::system::error_code const& error) {
+        if (!error) connection->start();
+      });
+  connection.reset();
+  std::thread server([&ioService]() { ioService.run(); });
+
+  boost::asio::io_service clientService;
+  tcp::socket client(clientService);
+  client.connect(acceptor.local_endpoint());
+  boost::asio::write(client, boost::asio::buffer(requests));
+  string answers;
+  char buffer[1024];
+  boost::system::error_code error;
+  while (!error) {
+    size_t size = client.read_some(boost::asio::buffer(buffer), error);
+    answers.append(buffer, size);
+  }
+  server.join();
+  return answers;
+}
+
+// ___________________________________________________________________________
+TEST(HttpConnection, pipelined) {
+  EXPECT_EQ("HTTP/1.1 200 OK\r\nContent-Length: 2\r\n\r\n/a"
+      "HTTP/1.1 200 OK\r\nContent-Length: 5\r\n\r\n/file",
+      exchange("GET /a HTTP/1.1\r\n\r\n"
+        "GET /file HTTP/1.1\r\nConnection: close\r\n\r\n"));
+}
+
+// ___________________________________________________________________________
+TEST(HttpConnection, head) {
+  // Only the headers, with the Content-Length of GET, so the next answer
+  // is read as such.
+  EXPECT_EQ("HTTP/1.1 200 OK\r\nContent-Length: 2\r\n\r\n"
+      "HTTP/1.1 200 OK\r\nContent-Length: 5\r\n\r\n"
+      "HTTP/1.1 200 OK\r\nContent-Length: 2\r\n\r\n/b",
+      exchange("HEAD /a HTTP/1.1\r\n\r\n"
+        "HEAD /file HTTP/1.1\r\n\r\n"
+        "GET /b HTTP/1.1\r\nConnection: close\r\n\r\n"));
+}
+
+// ___________________________________________________________________________
+TEST(HttpConnection, transferEncoding) {
+  // The chunks are not answered as requests, the connection is closed.
+  string answers = exchange("GET /a HTTP/1.1\r\n\r\n"
+      "POST /b HTTP/1.1\r\nTransfer-Encoding: chunked\r\n\r\n"
+      "17\r\nGET /c HTTP/1.1\r\n\r\n\r\n0\r\n\r\n");
+  EXPECT_EQ(0, answers.find("HTTP/1.1 200 OK\r\nContent-Length: 2\r\n\r\n/a"
+        "HTTP/1.1 400 Bad Request\r\n"));
+  EXPECT_EQ(string::npos, answers.find("/c"));
+}
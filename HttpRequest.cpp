@@ -0,0 +1,201 @@
+// Copyright 2012, Milan Oberkirch
+// Author: Milan Oberkirch <oberkirm@informatik.uni-freiburg.de>
+
+#include "./HttpRequest.h"
+#include <boost/utility/string_view.hpp>
+#include <cctype>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <utility>
+#include <vector>
+
+using std::string;
+using std::vector;
+
+// Compare text case-insensitively to a lower case word.
+static bool equalsLowerCase(string_view text, string_view lowerCaseWord) {
+  if (text.size() != lowerCaseWord.size()) return false;
+  for (size_t i = 0; i < text.size(); ++i)
+    if (tolower(static_cast<unsigned char>(text[i])) != lowerCaseWord[i])
+      return false;
+  return true;
+}
+
+// The character classes of bytes (the functions of <cctype> are undefined
+// for the negative chars of bytes >= 0x80).
+static bool isBlank(char c) {
+  return isblank(static_cast<unsigned char>(c));
+}
+static bool isHexDigit(char c) {
+  return isxdigit(static_cast<unsigned char>(c));
+}
+
+// Value of a hexadecimal digit.
+static char hexValue(char digit) {
+  unsigned char c = digit;
+  return isdigit(c) ? c - '0' : tolower(c) - 'a' + 10;
+}
+
+// ___________________________________________________________________________
+HttpRequest::HttpRequest(size_t maxLength) : _maxLength(maxLength) {
+  reset();
+}
+
+// ___________________________________________________________________________
+void HttpRequest::reset() {
+  _buffer = "";
+  _state = INCOMPLETE;
+  _scanned = 0;
+  _lineBegin = 0;
+  _headerLength = 0;
+  _contentLength = 0;
+  _requestLine = _method = _path = _query = _version = Slice(0, 0);
+  _headers.clear();
+}
+
+// ___________________________________________________________________________
+HttpRequest::State HttpRequest::parse(char const* buffer, size_t size) {
+  _buffer = buffer;
+  // Header lines up to the empty line.
+  while (!_headerLength && _state == INCOMPLETE && _scanned < size) {
+    char const* newline = static_cast<char const*>(
+        memchr(buffer + _scanned, '\n', size - _scanned));
+    if (!newline) {
+      _scanned = size;
+      break;
+    }
+    _scanned = newline - buffer + 1;
+    size_t lineEnd = _scanned - 1;
+    if (lineEnd > _lineBegin && buffer[lineEnd - 1] == '\r') --lineEnd;
+
+    if (lineEnd == _lineBegin) {
+      // Empty lines before the request line are ignored.
+      if (_requestLine.second) _headerLength = _scanned;
+    } else if (!_requestLine.second) {
+      if (!parseRequestLine(_lineBegin, lineEnd)) _state = INVALID;
+    } else {
+      if (!parseHeaderLine(_lineBegin, lineEnd)) _state = INVALID;
+    }
+    _lineBegin = _scanned;
+
+    if (_headerLength) _state = parseContentLength();
+  }
+  if (_state == INCOMPLETE && _headerLength && size >= length())
+    _state = COMPLETE;
+  return _state;
+}
+
+// ___________________________________________________________________________
+bool HttpRequest::parseRequestLine(size_t begin, size_t end) {
+  _requestLine = Slice(begin, end - begin);
+  string_view line = slice(_requestLine);
+  size_t space1 = line.find(' ');
+  size_t space2 = line.rfind(' ');
+  if (space1 == string_view::npos || space1 == space2) return false;
+  _method = Slice(begin, space1);
+  _version = Slice(begin + space2 + 1, line.size() - space2 - 1);
+  string_view target = line.substr(space1 + 1, space2 - space1 - 1);
+  size_t question = target.find('?');
+  if (question == string_view::npos) {
+    _path = Slice(begin + space1 + 1, target.size());
+  } else {
+    _path = Slice(begin + space1 + 1, question);
+    _query = Slice(begin + space1 + 2 + question,
+        target.size() - question - 1);
+  }
+  return !slice(_path).empty() && slice(_version).starts_with("HTTP/");
+}
+
+// ___________________________________________________________________________
+bool HttpRequest::parseHeaderLine(size_t begin, size_t end) {
+  string_view line(_buffer + begin, end - begin);
+  size_t colon = line.find(':');
+  if (colon == string_view::npos || colon == 0) return false;
+  size_t valueBegin = colon + 1;
+  while (valueBegin < line.size() && isBlank(line[valueBegin]))
+    ++valueBegin;
+  size_t valueEnd = line.size();
+  while (valueEnd > valueBegin && isBlank(line[valueEnd - 1])) --valueEnd;
+  _headers.push_back(std::make_pair(Slice(begin, colon),
+        Slice(begin + valueBegin, valueEnd - valueBegin)));
+  return true;
+}
+
+// ___________________________________________________________________________
+HttpRequest::State HttpRequest::parseContentLength() {
+  _contentLength = 0;
+  // Bodies in chunks (or other transfer codings) are not decoded. Framing
+  // such a request by its Content-Length would parse its body as the next
+  // request.
+  if (!header("transfer-encoding").empty()) return INVALID;
+  string_view length = header("content-length");
+  for (size_t i = 0; i < length.size(); ++i) {
+    if (length[i] < '0' || length[i] > '9') return INVALID;
+    size_t digit = length[i] - '0';
+    // Stop before the number overflows.
+    if (_contentLength > (SIZE_MAX - digit) / 10) return TOO_LARGE;
+    _contentLength = _contentLength * 10 + digit;
+  }
+  if (_contentLength > _maxLength
+      || _headerLength > _maxLength - _contentLength)
+    return TOO_LARGE;
+  return INCOMPLETE;
+}
+
+// ___________________________________________________________________________
+string_view HttpRequest::header(string_view name) const {
+  for (size_t i = 0; i < _headers.size(); ++i)
+    if (equalsLowerCase(slice(_headers[i].first), name))
+      return slice(_headers[i].second);
+  return string_view();
+}
+
+// ___________________________________________________________________________
+bool HttpRequest::keepAlive() const {
+  // HTTP/1.1 connections are persistent by default, HTTP/1.0 ones are not.
+  bool persistent = version() == "HTTP/1.1";
+  string_view connection = header("connection");
+  if (equalsLowerCase(connection, "close"))
+    persistent = false;
+  else if (equalsLowerCase(connection, "keep-alive"))
+    persistent = true;
+  return persistent;
+}
+
+// ___________________________________________________________________________
+bool HttpRequest::parameter(string_view name, string* value) const {
+  string_view query = this->query();
+  while (!query.empty()) {
+    size_t ampersand = query.find('&');
+    string_view pair = query.substr(0, ampersand);
+    query = ampersand == string_view::npos ?
+      string_view() : query.substr(ampersand + 1);
+    if (pair.size() > name.size() && pair[name.size()] == '=' &&
+        pair.starts_with(name)) {
+      urlDecode(pair.substr(name.size() + 1), value);
+      return true;
+    }
+  }
+  return false;
+}
+
+// ___________________________________________________________________________
+void HttpRequest::urlDecode(string_view encoded, string* decoded,
+    bool plusIsSpace) {
+  decoded->clear();
+  decoded->reserve(encoded.size());
+  for (size_t i = 0; i < encoded.size(); ++i) {
+    char c = encoded[i];
+    if (c == '%' && i + 2 < encoded.size() &&
+        isHexDigit(encoded[i + 1]) && isHexDigit(encoded[i + 2])) {
+      decoded->push_back(
+          (hexValue(encoded[i + 1]) << 4) | hexValue(encoded[i + 2]));
+      i += 2;
+    } else if (c == '+' && plusIsSpace) {
+      decoded->push_back(' ');
+    } else {
+      decoded->push_back(c);
+    }
+  }
+}
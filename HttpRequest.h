@@ -0,0 +1,100 @@
+// Copyright 2012, Milan Oberkirch
+// Author: Milan Oberkirch <oberkirm@informatik.uni-freiburg.de>
+
+#ifndef HTTPREQUEST_H_
+#define HTTPREQUEST_H_
+
+#include <gtest/gtest.h>
+#include <stdint.h>
+#include <boost/utility/string_view.hpp>
+#include <string>
+#include <utility>
+#include <vector>
+
+using boost::string_view;
+using std::pair;
+using std::string;
+using std::vector;
+
+// Incremental parser for HTTP-requests and a view on the parsed request. The
+// request is not copied: all parts are slices of the buffer given to parse,
+// which must stay unchanged while the request is used. One object is meant
+// to be reused for all requests of a connection (call reset in between), so
+// parsing does not allocate memory once the header table has grown.
+class HttpRequest {
+ public:
+  // TOO_LARGE: the request (header and content) has more than maxLength
+  // bytes.
+  enum State { INCOMPLETE, COMPLETE, INVALID, TOO_LARGE };
+
+  explicit HttpRequest(size_t maxLength = SIZE_MAX);
+
+  // Continue parsing the request at the beginning of buffer[0..size). The
+  // buffer must start with the bytes passed to previous calls (since the
+  // last reset) but may have moved in memory. Only the new bytes are
+  // scanned.
+  State parse(char const* buffer, size_t size);
+  // Forget the current request to parse the next one.
+  void reset();
+
+  // Number of bytes of the complete request (header and content).
+  size_t length() const { return _headerLength + _contentLength; }
+
+  string_view requestLine() const { return slice(_requestLine); }
+  string_view method() const { return slice(_method); }
+  // Path and query as in the request (not decoded).
+  string_view path() const { return slice(_path); }
+  string_view query() const { return slice(_query); }
+  string_view version() const { return slice(_version); }
+  string_view content() const {
+    return string_view(_buffer + _headerLength, _contentLength);
+  }
+  // Value of the header field with the given (lower case) name or an empty
+  // view if there is no such field.
+  string_view header(string_view name) const;
+  // Whether the connection should be kept open after the answer.
+  bool keepAlive() const;
+
+  // Decoded value of the query parameter name. Returns false (and leaves
+  // value unchanged) if the parameter is not part of the query.
+  bool parameter(string_view name, string* value) const;
+
+  // Decode percent-escapes (and '+' as space if plusIsSpace) in one pass.
+  static void urlDecode(string_view encoded, string* decoded,
+      bool plusIsSpace = true);
+
+ private:
+  // Position of a part of the request in the buffer.
+  typedef pair<size_t, size_t> Slice;
+  string_view slice(Slice const& s) const {
+    return string_view(_buffer + s.first, s.second);
+  }
+  // Split the request line into method, path, query and version.
+  FRIEND_TEST(HttpRequest, parseRequestLine);
+  bool parseRequestLine(size_t begin, size_t end);
+  // Split a header line into name and value.
+  bool parseHeaderLine(size_t begin, size_t end);
+  // Set _contentLength from the Content-Length header (0 without one).
+  // Returns INVALID if it is not a decimal number or the request has a
+  // Transfer-Encoding header, and TOO_LARGE if the request would be longer
+  // than _maxLength.
+  State parseContentLength();
+
+  size_t _maxLength;
+  char const* _buffer;
+  State _state;
+  // Bytes of the buffer scanned so far and start of the current line.
+  size_t _scanned;
+  size_t _lineBegin;
+  size_t _headerLength;
+  size_t _contentLength;
+
+  Slice _requestLine;
+  Slice _method;
+  Slice _path;
+  Slice _query;
+  Slice _version;
+  vector<pair<Slice, Slice> > _headers;
+};
+
+#endif  // HTTPREQUEST_H_
@@ -0,0 +1,157 @@
+// Copyright 2012, Milan Oberkirch
+// Author: Milan Oberkirch <oberkirm@informatik.uni-freiburg.de>
+
+#include <gtest/gtest.h>
+#include <string>
+#include "./HttpRequest.h"
+
+using std::string;
+
+// ___________________________________________________________________________
+TEST(HttpRequest, parse) {
+  HttpRequest request;
+  string buffer = "GET /?q=a HTTP/1.1\r\nHost: x\r\n\r\n";
+  // Incomplete header, then the rest of it.
+  EXPECT_EQ(HttpRequest::INCOMPLETE, request.parse(buffer.c_str(), 20));
+  EXPECT_EQ(HttpRequest::COMPLETE,
+      request.parse(buffer.c_str(), buffer.size()));
+  EXPECT_EQ(buffer.size(), request.length());
+  EXPECT_EQ("GET", request.method());
+  EXPECT_EQ("/", request.path());
+  EXPECT_EQ("q=a", request.query());
+  EXPECT_EQ("x", request.header("host"));
+  EXPECT_EQ("", request.header("connection"));
+
+  // Two pipelined requests: only the first one counts.
+  request.reset();
+  string pipelined = buffer + "GET / HTTP/1.1\r\n\r\n";
+  EXPECT_EQ(HttpRequest::COMPLETE,
+      request.parse(pipelined.c_str(), pipelined.size()));
+  EXPECT_EQ(buffer.size(), request.length());
+
+  // Bare newlines.
+  request.reset();
+  EXPECT_EQ(HttpRequest::COMPLETE, request.parse("GET / HTTP/1.0\n\n", 16));
+  EXPECT_EQ(16, request.length());
+
+  // Content is part of the request.
+  request.reset();
+  string post = "POST /a HTTP/1.1\r\nContent-Length: 5\r\n\r\nabcde";
+  EXPECT_EQ(HttpRequest::INCOMPLETE,
+      request.parse(post.c_str(), post.size() - 1));
+  EXPECT_EQ(HttpRequest::COMPLETE, request.parse(post.c_str(), post.size()));
+  EXPECT_EQ(post.size(), request.length());
+  EXPECT_EQ("abcde", request.content());
+
+  // Content-Length has to be a decimal number.
+  const char* invalidLengths[] = {"-1", "abc", "1 2", "+5", "0x10"};
+  for (size_t i = 0; i < 5; ++i) {
+    request.reset();
+    string invalid = string("POST / HTTP/1.1\r\nContent-Length: ")
+      + invalidLengths[i] + "\r\n\r\n";
+    EXPECT_EQ(HttpRequest::INVALID,
+        request.parse(invalid.c_str(), invalid.size())) << invalidLengths[i];
+  }
+  // Transfer codings are not supported, the content would be taken for the
+  // next request.
+  request.reset();
+  string chunked = "POST / HTTP/1.1\r\nTransfer-Encoding: chunked\r\n\r\n"
+    "5\r\nabcde\r\n0\r\n\r\n";
+  EXPECT_EQ(HttpRequest::INVALID, request.parse(chunked.c_str(),
+        chunked.size()));
+  request.reset();
+  chunked = "POST / HTTP/1.1\r\nContent-Length: 5\r\n"
+    "transfer-encoding: gzip\r\n\r\nabcde";
+  EXPECT_EQ(HttpRequest::INVALID, request.parse(chunked.c_str(),
+        chunked.size()));
+  // Requests longer than the maximal length (also if the number would
+  // overflow).
+  HttpRequest limited(100);
+  string large = "POST / HTTP/1.1\r\nContent-Length: 80\r\n\r\n";
+  EXPECT_EQ(HttpRequest::TOO_LARGE, limited.parse(large.c_str(),
+        large.size()));
+  limited.reset();
+  large = "POST / HTTP/1.1\r\nContent-Length: 99999999999999999999999\r\n"
+    "\r\n";
+  EXPECT_EQ(HttpRequest::TOO_LARGE, limited.parse(large.c_str(),
+        large.size()));
+  limited.reset();
+  string small = "POST / HTTP/1.1\r\nContent-Length: 20\r\n\r\n";
+  small += string(20, 'x');
+  EXPECT_EQ(HttpRequest::COMPLETE, limited.parse(small.c_str(),
+        small.size()));
+
+  request.reset();
+  EXPECT_EQ(HttpRequest::INVALID, request.parse("no request\r\n", 12));
+  request.reset();
+  EXPECT_EQ(HttpRequest::INVALID,
+      request.parse("GET / HTTP/1.1\r\nno header\r\n", 27));
+}
+
+// ___________________________________________________________________________
+TEST(HttpRequest, parseRequestLine) {
+  HttpRequest request;
+  string line = "GET /css/a.css HTTP/1.0";
+  request._buffer = line.c_str();
+  ASSERT_TRUE(request.parseRequestLine(0, line.size()));
+  EXPECT_EQ("/css/a.css", request.path());
+  EXPECT_EQ("", request.query());
+  EXPECT_EQ("HTTP/1.0", request.version());
+  EXPECT_EQ(line, request.requestLine());
+  line = "GET /index.html";
+  request._buffer = line.c_str();
+  EXPECT_FALSE(request.parseRequestLine(0, line.size()));
+}
+
+// ___________________________________________________________________________
+TEST(HttpRequest, keepAlive) {
+  HttpRequest request;
+  request.parse("GET / HTTP/1.1\r\nHost: x\r\n\r\n", 27);
+  EXPECT_TRUE(request.keepAlive());
+  request.reset();
+  request.parse("GET / HTTP/1.1\r\nConnection: close\r\n\r\n", 37);
+  EXPECT_FALSE(request.keepAlive());
+  request.reset();
+  request.parse("GET / HTTP/1.0\r\n\r\n", 18);
+  EXPECT_FALSE(request.keepAlive());
+  request.reset();
+  request.parse("GET / HTTP/1.0\r\nConnection: Keep-Alive\r\n\r\n", 42);
+  EXPECT_TRUE(request.keepAlive());
+  // Header values with bytes >= 0x80.
+  request.reset();
+  string header = "GET / HTTP/1.1\r\nConnection: \xA0\xC3" "close\xA0\r\n"
+    "\r\n";
+  request.parse(header.c_str(), header.size());
+  EXPECT_EQ("\xA0\xC3" "close\xA0", request.header("connection"));
+  EXPECT_TRUE(request.keepAlive());
+}
+
+// ___________________________________________________________________________
+TEST(HttpRequest, parameter) {
+  HttpRequest request;
+  string buffer =
+    "GET /?searchQuery=albert+einstein&number=10 HTTP/1.1\r\n\r\n";
+  request.parse(buffer.c_str(), buffer.size());
+  string value;
+  EXPECT_TRUE(request.parameter("searchQuery", &value));
+  EXPECT_EQ("albert einstein", value);
+  EXPECT_TRUE(request.parameter("number", &value));
+  EXPECT_EQ("10", value);
+  EXPECT_FALSE(request.parameter("vocabularyLookup", &value));
+  EXPECT_FALSE(request.parameter("search", &value));
+  EXPECT_EQ("10", value);
+}
+
+// ___________________________________________________________________________
+TEST(HttpRequest, urlDecode) {
+  string decoded;
+  HttpRequest::urlDecode("%22m%C3%BCller%22+%7e", &decoded);
+  EXPECT_EQ("\"m\xC3\xBCller\" ~", decoded);
+  HttpRequest::urlDecode("a+b%2", &decoded, false);
+  EXPECT_EQ("a+b%2", decoded);
+  HttpRequest::urlDecode("100%", &decoded);
+  EXPECT_EQ("100%", decoded);
+  // Bytes >= 0x80 are kept as they are.
+  HttpRequest::urlDecode("\xE4%\xE4\xE4", &decoded);
+  EXPECT_EQ("\xE4%\xE4\xE4", decoded);
+}
@@ -0,0 +1,110 @@
+// Copyright 2012, Milan Oberkirch
+// Author: Milan Oberkirch <oberkirm@informatik.uni-freiburg.de>
+
+#include "./IndexFile.h"
+#include <fcntl.h>
+#include <stdint.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <cstdio>
+#include <cstring>
+#include <string>
+
+using std::string;
+
+// Sections start at multiples of this.
+const size_t sectionAlignment = 8;
+
+// ___________________________________________________________________________
+IndexFileWriter::IndexFileWriter(string const& fileName)
+  : _fileName(fileName),
+    _file((fileName + ".tmp").c_str(), std::ios::binary | std::ios::trunc) {
+  if (!_file.is_open())
+    throw IndexFileError("Cannot write index file " + fileName + ".tmp");
+  _file.write(indexFileMagic, sizeof(indexFileMagic));
+  uint64_t version = indexFileVersion;
+  _file.write(reinterpret_cast<char const*>(&version), sizeof(version));
+}
+
+// ___________________________________________________________________________
+IndexFileWriter::~IndexFileWriter() {
+  // Not closed: the temporary file is incomplete.
+  if (_file.is_open()) {
+    _file.close();
+    remove((_fileName + ".tmp").c_str());
+  }
+}
+
+// ___________________________________________________________________________
+void IndexFileWriter::writeSection(void const* data, size_t size) {
+  uint64_t size64 = size;
+  _file.write(reinterpret_cast<char const*>(&size64), sizeof(size64));
+  if (size) _file.write(static_cast<char const*>(data), size);
+  char const padding[sectionAlignment] = {0};
+  _file.write(padding, (sectionAlignment - size % sectionAlignment) %
+      sectionAlignment);
+  if (!_file)
+    throw IndexFileError("Error writing index file " + _fileName);
+}
+
+// ___________________________________________________________________________
+void IndexFileWriter::close() {
+  _file.close();
+  if (!_file ||
+      rename((_fileName + ".tmp").c_str(), _fileName.c_str()) != 0)
+    throw IndexFileError("Error writing index file " + _fileName);
+}
+
+// ___________________________________________________________________________
+IndexFileReader::IndexFileReader(string const& fileName)
+  : _data(NULL), _size(0), _position(0) {
+  int file = open(fileName.c_str(), O_RDONLY);
+  if (file < 0)
+    throw IndexFileError("Cannot open index file " + fileName);
+  struct stat status;
+  if (fstat(file, &status) == 0 && status.st_size > 0) {
+    void* data = mmap(NULL, status.st_size, PROT_READ, MAP_SHARED, file, 0);
+    if (data != MAP_FAILED) {
+      _data = static_cast<char const*>(data);
+      _size = status.st_size;
+    }
+  }
+  ::close(file);
+  if (!_data)
+    throw IndexFileError("Cannot map index file " + fileName);
+
+  uint64_t version;
+  if (_size < sizeof(indexFileMagic) + sizeof(version) ||
+      memcmp(_data, indexFileMagic, sizeof(indexFileMagic)) != 0) {
+    munmap(const_cast<char*>(_data), _size);
+    throw IndexFileError(fileName + " is not an index file.");
+  }
+  memcpy(&version, _data + sizeof(indexFileMagic), sizeof(version));
+  if (version != indexFileVersion) {
+    munmap(const_cast<char*>(_data), _size);
+    throw IndexFileError(fileName + " was written by an other version.");
+  }
+  _position = sizeof(indexFileMagic) + sizeof(version);
+}
+
+// ___________________________________________________________________________
+IndexFileReader::~IndexFileReader() {
+  munmap(const_cast<char*>(_data), _size);
+}
+
+// ___________________________________________________________________________
+void const* IndexFileReader::nextSection(size_t* size) {
+  uint64_t size64;
+  if (_position + sizeof(size64) > _size)
+    throw IndexFileError("Index file is truncated.");
+  memcpy(&size64, _data + _position, sizeof(size64));
+  _position += sizeof(size64);
+  if (size64 > _size - _position)
+    throw IndexFileError("Index file is truncated.");
+  void const* data = _data + _position;
+  *size = size64;
+  _position += size64 + (sectionAlignment - size64 % sectionAlignment) %
+    sectionAlignment;
+  return data;
+}
@@ -0,0 +1,90 @@
+// Copyright 2012, Milan Oberkirch
+// Author: Milan Oberkirch <oberkirm@informatik.uni-freiburg.de>
+
+#ifndef INDEXFILE_H_
+#define INDEXFILE_H_
+
+#include <stdint.h>
+#include <fstream>  // NOLINT
+#include <stdexcept>
+#include <string>
+#include "./FlatVector.h"
+
+using std::string;
+
+// Binary index files consist of a header (magic bytes and format version)
+// followed by sections. Each section is a 64 bit byte count followed by the
+// bytes, padded to a multiple of 8 bytes, so every section is aligned for
+// all value types when the file is mapped into memory.
+const char indexFileMagic[8] = {'S', 'S', 'I', 'N', 'D', 'E', 'X', '\0'};
+// Increment whenever the order or content of the sections changes.
+const uint32_t indexFileVersion = 8;
+
+// Error while reading or writing an index file.
+class IndexFileError : public std::runtime_error {
+ public:
+  explicit IndexFileError(string const& message)
+    : std::runtime_error(message) {}
+};
+
+// Writes the sections of an index file. The file is written under a
+// temporary name and renamed by close, so processes never map a half
+// written index.
+class IndexFileWriter {
+ public:
+  explicit IndexFileWriter(string const& fileName);
+  ~IndexFileWriter();
+
+  // Append a section with size bytes at data.
+  void writeSection(void const* data, size_t size);
+  template <class T>
+  void write(FlatVector<T> const& values) {
+    writeSection(values.data(), values.size() * sizeof(T));
+  }
+  template <class T>
+  void writeValue(T const& value) { writeSection(&value, sizeof(T)); }
+
+  // Finish the file and move it to its final name.
+  void close();
+
+ private:
+  string _fileName;
+  std::ofstream _file;
+};
+
+// Maps an index file into memory (read-only and shared with other processes
+// reading the same file) and hands out its sections in the order in which
+// they were written. The mapping lives as long as the reader, so objects
+// referring to the sections keep a shared pointer to it.
+class IndexFileReader {
+ public:
+  explicit IndexFileReader(string const& fileName);
+  ~IndexFileReader();
+
+  // The next section as array of values (without copying them).
+  template <class T>
+  void read(FlatVector<T>* values) {
+    size_t size;
+    T const* data = static_cast<T const*>(nextSection(&size));
+    if (size % sizeof(T))
+      throw IndexFileError("Index file section has wrong size.");
+    values->map(data, size / sizeof(T));
+  }
+  template <class T>
+  T readValue() {
+    size_t size;
+    T const* data = static_cast<T const*>(nextSection(&size));
+    if (size != sizeof(T))
+      throw IndexFileError("Index file section has wrong size.");
+    return *data;
+  }
+
+ private:
+  void const* nextSection(size_t* size);
+
+  char const* _data;
+  size_t _size;
+  size_t _position;
+};
+
+#endif  // INDEXFILE_H_
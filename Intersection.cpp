@@ -0,0 +1,232 @@
+// Copyright 2012, Milan Oberkirch
+// Author: Milan Oberkirch <oberkirm@informatik.uni-freiburg.de>
+
+#include "./Intersection.h"
+#include <stdint.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define INTERSECTION_X86
+#endif
+#include <algorithm>
+
+// Use galloping if one list is at least this many times longer.
+const size_t gallopingRatio = 16;
+
+// ___________________________________________________________________________
+size_t Intersection::intersect(uint32_t const* list1, size_t size1,
+    uint32_t const* list2, size_t size2,
+    uint32_t* positions1, uint32_t* positions2, Kernel kernel) {
+  // The kernels expect the shorter list first.
+  if (size1 > size2) {
+    std::swap(list1, list2);
+    std::swap(size1, size2);
+    std::swap(positions1, positions2);
+  }
+  if (kernel == AUTOMATIC || !supported(kernel))
+    kernel = chooseKernel(size1, size2);
+  switch (kernel) {
+    case GALLOPING:
+      return galloping(list1, size1, list2, size2, positions1, positions2);
+    case SSE:
+      return sse(list1, size1, list2, size2, positions1, positions2);
+    case AVX2:
+      return avx2(list1, size1, list2, size2, positions1, positions2);
+    default:
+      return scalar(list1, size1, list2, size2, positions1, positions2);
+  }
+}
+
+// ___________________________________________________________________________
+bool Intersection::supported(Kernel kernel) {
+#ifdef INTERSECTION_X86
+  // Checked once, the CPU does not change.
+  static bool const hasAvx2 = __builtin_cpu_supports("avx2");
+  if (kernel == AVX2) return hasAvx2;
+  return true;
+#else
+  return kernel != SSE && kernel != AVX2;
+#endif
+}
+
+// ___________________________________________________________________________
+Intersection::Kernel Intersection::chooseKernel(size_t size1, size_t size2) {
+  if (size1 * gallopingRatio <= size2) return GALLOPING;
+  if (size1 >= 8 && supported(AVX2)) return AVX2;
+  if (size1 >= 4 && supported(SSE)) return SSE;
+  return SCALAR;
+}
+
+// ___________________________________________________________________________
+size_t Intersection::scalar(uint32_t const* list1, size_t size1,
+    uint32_t const* list2, size_t size2,
+    uint32_t* positions1, uint32_t* positions2) {
+  size_t count = 0;
+  size_t i = 0;
+  size_t j = 0;
+  while (i < size1 && j < size2) {
+    if (list1[i] < list2[j]) {
+      ++i;
+    } else if (list2[j] < list1[i]) {
+      ++j;
+    } else {
+      positions1[count] = i++;
+      positions2[count++] = j++;
+    }
+  }
+  return count;
+}
+
+// ___________________________________________________________________________
+size_t Intersection::galloping(uint32_t const* list1, size_t size1,
+    uint32_t const* list2, size_t size2,
+    uint32_t* positions1, uint32_t* positions2) {
+  size_t count = 0;
+  size_t j = 0;
+  for (size_t i = 0; i < size1 && j < size2; ++i) {
+    // Double the step until list2[j + step] >= list1[i], then search
+    // between the last two steps.
+    size_t step = 1;
+    while (j + step < size2 && list2[j + step] < list1[i]) {
+      j += step;
+      step *= 2;
+    }
+    if (list2[j] < list1[i]) {
+      j = std::lower_bound(list2 + j + 1, list2 + std::min(j + step, size2),
+          list1[i]) - list2;
+      if (j == size2) break;
+    }
+    if (list2[j] == list1[i]) {
+      positions1[count] = i;
+      positions2[count++] = j++;
+    }
+  }
+  return count;
+}
+
+// ___________________________________________________________________________
+size_t Intersection::scalarRest(uint32_t const* list1, size_t size1,
+    size_t i, uint32_t const* list2, size_t size2, size_t j,
+    uint32_t* positions1, uint32_t* positions2, size_t count) {
+  size_t rest = scalar(list1 + i, size1 - i, list2 + j, size2 - j,
+      positions1 + count, positions2 + count);
+  for (size_t c = count; c < count + rest; ++c) {
+    positions1[c] += i;
+    positions2[c] += j;
+  }
+  return count + rest;
+}
+
+// Append the positions of the matches in a pair of compared blocks. Values
+// are distinct and sorted in both blocks, so the n-th match in the block of
+// list1 is the n-th match in the block of list2.
+static size_t appendMatches(unsigned int mask1, unsigned int mask2,
+    size_t i, size_t j, uint32_t* positions1, uint32_t* positions2,
+    size_t count) {
+  while (mask1) {
+    positions1[count] = i + __builtin_ctz(mask1);
+    positions2[count++] = j + __builtin_ctz(mask2);
+    mask1 &= mask1 - 1;
+    mask2 &= mask2 - 1;
+  }
+  return count;
+}
+
+#ifdef INTERSECTION_X86
+// ___________________________________________________________________________
+size_t Intersection::sse(uint32_t const* list1, size_t size1,
+    uint32_t const* list2, size_t size2,
+    uint32_t* positions1, uint32_t* positions2) {
+  size_t count = 0;
+  size_t i = 0;
+  size_t j = 0;
+  while (i + 4 <= size1 && j + 4 <= size2) {
+    __m128i block1 =
+      _mm_loadu_si128(reinterpret_cast<__m128i const*>(list1 + i));
+    __m128i block2 =
+      _mm_loadu_si128(reinterpret_cast<__m128i const*>(list2 + j));
+    // Compare block1 with all rotations of block2. equalN[l] says whether
+    // block1[l] == block2[(l + N) % 4], rotating it back by N gives the
+    // matches in block2.
+    __m128i equal0 = _mm_cmpeq_epi32(block1, block2);
+    __m128i equal1 = _mm_cmpeq_epi32(block1,
+        _mm_shuffle_epi32(block2, _MM_SHUFFLE(0, 3, 2, 1)));
+    __m128i equal2 = _mm_cmpeq_epi32(block1,
+        _mm_shuffle_epi32(block2, _MM_SHUFFLE(1, 0, 3, 2)));
+    __m128i equal3 = _mm_cmpeq_epi32(block1,
+        _mm_shuffle_epi32(block2, _MM_SHUFFLE(2, 1, 0, 3)));
+    __m128i matches1 = _mm_or_si128(_mm_or_si128(equal0, equal1),
+        _mm_or_si128(equal2, equal3));
+    __m128i matches2 = _mm_or_si128(
+        _mm_or_si128(equal0,
+          _mm_shuffle_epi32(equal1, _MM_SHUFFLE(2, 1, 0, 3))),
+        _mm_or_si128(_mm_shuffle_epi32(equal2, _MM_SHUFFLE(1, 0, 3, 2)),
+          _mm_shuffle_epi32(equal3, _MM_SHUFFLE(0, 3, 2, 1))));
+    count = appendMatches(_mm_movemask_ps(_mm_castsi128_ps(matches1)),
+        _mm_movemask_ps(_mm_castsi128_ps(matches2)), i, j,
+        positions1, positions2, count);
+    // Advance the block(s) ending first.
+    uint32_t last1 = list1[i + 3];
+    uint32_t last2 = list2[j + 3];
+    if (last1 <= last2) i += 4;
+    if (last2 <= last1) j += 4;
+  }
+  return scalarRest(list1, size1, i, list2, size2, j,
+      positions1, positions2, count);
+}
+
+// ___________________________________________________________________________
+__attribute__((target("avx2")))
+size_t Intersection::avx2(uint32_t const* list1, size_t size1,
+    uint32_t const* list2, size_t size2,
+    uint32_t* positions1, uint32_t* positions2) {
+  size_t count = 0;
+  size_t i = 0;
+  size_t j = 0;
+  while (i + 8 <= size1 && j + 8 <= size2) {
+    __m256i block1 =
+      _mm256_loadu_si256(reinterpret_cast<__m256i const*>(list1 + i));
+    __m256i block2 =
+      _mm256_loadu_si256(reinterpret_cast<__m256i const*>(list2 + j));
+    // Like in sse, with the rotations of the 8 values of block2.
+    __m256i matches1 = _mm256_cmpeq_epi32(block1, block2);
+    __m256i matches2 = matches1;
+    __m256i lanes = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+    __m256i seven = _mm256_set1_epi32(7);
+    for (int n = 1; n < 8; ++n) {
+      // Lane l of the rotations is lane (l + n) % 8 and (l - n) % 8.
+      __m256i forward =
+        _mm256_and_si256(_mm256_add_epi32(lanes, _mm256_set1_epi32(n)), seven);
+      __m256i backward = _mm256_and_si256(
+          _mm256_add_epi32(lanes, _mm256_set1_epi32(8 - n)), seven);
+      __m256i equal = _mm256_cmpeq_epi32(block1,
+          _mm256_permutevar8x32_epi32(block2, forward));
+      matches1 = _mm256_or_si256(matches1, equal);
+      matches2 = _mm256_or_si256(matches2,
+          _mm256_permutevar8x32_epi32(equal, backward));
+    }
+    count = appendMatches(_mm256_movemask_ps(_mm256_castsi256_ps(matches1)),
+        _mm256_movemask_ps(_mm256_castsi256_ps(matches2)), i, j,
+        positions1, positions2, count);
+    uint32_t last1 = list1[i + 7];
+    uint32_t last2 = list2[j + 7];
+    if (last1 <= last2) i += 8;
+    if (last2 <= last1) j += 8;
+  }
+  return scalarRest(list1, size1, i, list2, size2, j,
+      positions1, positions2, count);
+}
+#else
+// ___________________________________________________________________________
+size_t Intersection::sse(uint32_t const* list1, size_t size1,
+    uint32_t const* list2, size_t size2,
+    uint32_t* positions1, uint32_t* positions2) {
+  return scalar(list1, size1, list2, size2, positions1, positions2);
+}
+
+// ___________________________________________________________________________
+size_t Intersection::avx2(uint32_t const* list1, size_t size1,
+    uint32_t const* list2, size_t size2,
+    uint32_t* positions1, uint32_t* positions2) {
+  return scalar(list1, size1, list2, size2, positions1, positions2);
+}
+#endif
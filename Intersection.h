@@ -0,0 +1,59 @@
+// Copyright 2012, Milan Oberkirch
+// Author: Milan Oberkirch <oberkirm@informatik.uni-freiburg.de>
+
+#ifndef INTERSECTION_H_
+#define INTERSECTION_H_
+
+#include <gtest/gtest.h>
+#include <stdint.h>
+
+// Intersection of sorted arrays of distinct document ids. There are several
+// kernels: a scalar merge, galloping (exponential search in the longer list,
+// for lists of very different sizes) and block-compare kernels using SSE2 and
+// AVX2, which compare all values of a block of 4 (8) values of each list at
+// once. By default the kernel is chosen by the sizes of the lists and the
+// instruction sets supported by the CPU at runtime.
+class Intersection {
+ public:
+  enum Kernel { AUTOMATIC, SCALAR, GALLOPING, SSE, AVX2 };
+
+  // Intersect list1 and list2. For the i-th common value, positions1[i] and
+  // positions2[i] are set to its positions in list1 and list2 (both need
+  // space for min(size1, size2) positions). Returns the number of common
+  // values.
+  static size_t intersect(uint32_t const* list1, size_t size1,
+      uint32_t const* list2, size_t size2,
+      uint32_t* positions1, uint32_t* positions2,
+      Kernel kernel = AUTOMATIC);
+
+  // Whether the kernel can be used on this CPU.
+  static bool supported(Kernel kernel);
+
+ private:
+  FRIEND_TEST(Intersection, chooseKernel);
+  // The kernel used for lists of the given sizes (size1 <= size2).
+  static Kernel chooseKernel(size_t size1, size_t size2);
+
+  // The kernels (list1 is the shorter list). The SIMD kernels handle the
+  // values behind the last full block with the scalar kernel.
+  static size_t scalar(uint32_t const* list1, size_t size1,
+      uint32_t const* list2, size_t size2,
+      uint32_t* positions1, uint32_t* positions2);
+  static size_t galloping(uint32_t const* list1, size_t size1,
+      uint32_t const* list2, size_t size2,
+      uint32_t* positions1, uint32_t* positions2);
+  static size_t sse(uint32_t const* list1, size_t size1,
+      uint32_t const* list2, size_t size2,
+      uint32_t* positions1, uint32_t* positions2);
+  static size_t avx2(uint32_t const* list1, size_t size1,
+      uint32_t const* list2, size_t size2,
+      uint32_t* positions1, uint32_t* positions2);
+  // The scalar kernel for the values from position i of list1 and j of
+  // list2 on. The positions are appended behind the first count positions.
+  // Returns the new count.
+  static size_t scalarRest(uint32_t const* list1, size_t size1, size_t i,
+      uint32_t const* list2, size_t size2, size_t j,
+      uint32_t* positions1, uint32_t* positions2, size_t count);
+};
+
+#endif  // INTERSECTION_H_
@@ -0,0 +1,73 @@
+// Copyright 2012, Milan Oberkirch
+// Author: Milan Oberkirch <oberkirm@informatik.uni-freiburg.de>
+
+#include <gtest/gtest.h>
+#include <stdint.h>
+#include <algorithm>
+#include <cstdlib>
+#include <vector>
+#include "./Intersection.h"
+
+using std::vector;
+
+// Sorted distinct random values below range.
+vector<uint32_t> randomList(size_t size, uint32_t range) {
+  vector<uint32_t> list;
+  for (size_t i = 0; i < size; ++i) list.push_back(rand() % range);  // NOLINT
+  std::sort(list.begin(), list.end());
+  list.erase(std::unique(list.begin(), list.end()), list.end());
+  return list;
+}
+
+// ___________________________________________________________________________
+TEST(Intersection, intersect) {
+  srand(42);
+  Intersection::Kernel kernels[] = {Intersection::AUTOMATIC,
+    Intersection::SCALAR, Intersection::GALLOPING, Intersection::SSE,
+    Intersection::AVX2};
+  size_t sizes[] = {0, 1, 3, 4, 7, 8, 9, 31, 128, 1000};
+  for (size_t s1 = 0; s1 < 10; ++s1) {
+    for (size_t s2 = 0; s2 < 10; ++s2) {
+      vector<uint32_t> list1 = randomList(sizes[s1], 2 * sizes[s2] + 10);
+      vector<uint32_t> list2 = randomList(sizes[s2], 2 * sizes[s2] + 10);
+      vector<uint32_t> expected;
+      std::set_intersection(list1.begin(), list1.end(),
+          list2.begin(), list2.end(), std::back_inserter(expected));
+      for (size_t k = 0; k < 5; ++k) {
+        vector<uint32_t> positions1(std::min(list1.size(), list2.size()));
+        vector<uint32_t> positions2(positions1.size());
+        size_t count = Intersection::intersect(list1.data(), list1.size(),
+            list2.data(), list2.size(), positions1.data(), positions2.data(),
+            kernels[k]);
+        ASSERT_EQ(expected.size(), count);
+        for (size_t i = 0; i < count; ++i) {
+          EXPECT_EQ(expected[i], list1[positions1[i]]);
+          EXPECT_EQ(expected[i], list2[positions2[i]]);
+        }
+      }
+    }
+  }
+  // Unsigned values above 2^31 compare correctly.
+  uint32_t large1[] = {1, 2, 3, 2147483648u, 4000000000u, 4000000001u,
+    4000000002u, 4294967295u};
+  uint32_t large2[] = {0, 2, 2147483648u, 3000000000u, 4000000000u,
+    4000000003u, 4100000000u, 4294967295u};
+  uint32_t positions1[8];
+  uint32_t positions2[8];
+  for (size_t k = 0; k < 5; ++k) {
+    ASSERT_EQ(4, Intersection::intersect(large1, 8, large2, 8,
+          positions1, positions2, kernels[k]));
+    EXPECT_EQ(7, positions1[3]);
+    EXPECT_EQ(7, positions2[3]);
+  }
+}
+
+// ___________________________________________________________________________
+TEST(Intersection, chooseKernel) {
+  EXPECT_EQ(Intersection::GALLOPING, Intersection::chooseKernel(2, 128));
+  EXPECT_EQ(Intersection::SCALAR, Intersection::chooseKernel(3, 5));
+  Intersection::Kernel kernel = Intersection::chooseKernel(100, 128);
+  EXPECT_EQ(Intersection::supported(Intersection::AVX2)
+      ? Intersection::AVX2 : Intersection::SSE, kernel);
+  EXPECT_TRUE(Intersection::supported(Intersection::SCALAR));
+}
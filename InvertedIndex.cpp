@@ -5,50 +5,194 @@
 
 #include "./InvertedIndex.h"
 #include <assert.h>
-#include <cmath>
+#include <stdint.h>
+#include <boost/utility/string_view.hpp>
 #include <fstream>  // NOLINT
+#include <future>
+#include <iterator>
 #include <map>
 #include <string>
 #include <vector>
 #include <stdexcept>
 #include <algorithm>
+#include "./Bm25.h"
+#include "./FlatVector.h"
+#include "./IndexFile.h"
+#include "./PositionList.h"
 #include "./Posting.h"
+#include "./PostingList.h"
+#include "./StringTable.h"
 
 using std::ifstream;
 using std::map;
 using std::string;
 using std::vector;
 
-const size_t minWordLength = 2;
+const size_t InvertedIndex::minWordLength;
 // Randomly choosen upper bound to ensure termination.
 const size_t maxRecordLength = 100000;
 // Maximum URL-Length for Sitemap-Protocol.
 const size_t maxUrlLength = 2047;
 
 // _____________________________________________________________________________
-InvertedIndex::InvertedIndex() {
+InvertedIndex::InvertedIndex()
+  : _storePositions(false), _nextPosition(0), _totalLength(0),
+    _precomputeScores(false), _precomputedK(0), _precomputedB(0) {
 }
 
 // _____________________________________________________________________________
 void InvertedIndex::clear() {
-  _invertedLists.clear();
+  _words.clear();
+  _listOffsets.clear();
+  _postingData.clear();
+  _uncompressedLists.clear();
+  _positionOffsets.clear();
+  _positionData.clear();
+  _uncompressedPositions.clear();
   _records.clear();
   _urls.clear();
   _documentLengthInWords.clear();
+  _documentLengths.clear();
+  _totalLength = 0;
+  _indexFile.reset();
 }
 
 // _____________________________________________________________________________
-void InvertedIndex::buildFromCsvFile(string const& fileName,
-    float const& bm25k, float const& bm25b) {
+size_t InvertedIndex::buildFromCsvFile(string const& fileName,
+    unsigned int numberOfThreads, bool storePositions, size_t offset) {
   clear();
-  ifstream file(fileName.c_str());
-  string line;
+  _storePositions = storePositions;
+  ifstream file(fileName.c_str(), std::ios::binary);
+  file.seekg(offset);
+  string content((std::istreambuf_iterator<char>(file)),
+      std::istreambuf_iterator<char>());
+  char const* begin = content.data();
+  char const* end = begin + content.size();
+
+  // Build partial indexes of line ranges in parallel and append them in
+  // order, so document ids are the same as when reading line by line.
+  vector<char const*> bounds = splitLines(begin, end, numberOfThreads);
+  vector<InvertedIndex> parts(bounds.size() - 1);
+  vector<std::future<void> > results;
+  for (size_t i = 0; i < parts.size(); ++i) {
+    parts[i]._storePositions = storePositions;
+    results.push_back(std::async(std::launch::async, &InvertedIndex::parseLines,
+          &parts[i], bounds[i], bounds[i + 1]));
+  }
+  // Rethrows exceptions of the threads.
+  for (size_t i = 0; i < results.size(); ++i) results[i].get();
+  for (size_t i = 0; i < parts.size(); ++i) {
+    appendIndex(&parts[i]);
+    parts[i].clear();
+  }
+
+  compressInvertedLists();
+  // Lines without newline at the end are not indexed.
+  size_t lastLineEnd = content.rfind('\n');
+  return offset + (lastLineEnd == string::npos ? 0 : lastLineEnd + 1);
+}
+
+// _____________________________________________________________________________
+void InvertedIndex::merge(vector<InvertedIndex const*> const& indexes) {
+  clear();
+  // Indexes without words have no positions either.
+  _storePositions = false;
+  for (size_t i = 0; i < indexes.size(); ++i)
+    _storePositions = _storePositions || indexes[i]->hasPositions();
+  vector<uint32_t> positions;
+  for (size_t i = 0; i < indexes.size(); ++i) {
+    InvertedIndex const& index = *indexes[i];
+    // The uncompressed lists of index, appended like the parts of
+    // buildFromCsvFile (before the documents, so their ids are shifted).
+    InvertedIndex part;
+    for (size_t wordId = 0; wordId < index._words.size(); ++wordId) {
+      string word = index._words[wordId];
+      part._uncompressedLists.emplace_hint(part._uncompressedLists.end(),
+          word, index.postingList(wordId).decode());
+      if (!_storePositions) continue;
+      PositionList list = index.positionList(wordId);
+      vector<uint32_t>* wordPositions = &part._uncompressedPositions[word];
+      for (size_t j = 0; j < list.size(); ++j) {
+        list.positions(j, &positions);
+        wordPositions->push_back(positions.size());
+        wordPositions->insert(wordPositions->end(), positions.begin(),
+            positions.end());
+      }
+    }
+    appendIndex(&part);
+    for (size_t documentId = 0; documentId < index._urls.size();
+        ++documentId) {
+      _urls.push_back(index._urls[documentId]);
+      _records.push_back(index._records[documentId]);
+      // Quantized again to the same value.
+      _documentLengthInWords.push_back(
+          Bm25::dequantizeLength(index._documentLengths[documentId]));
+    }
+    _totalLength += index._totalLength;
+  }
+  compressInvertedLists();
+}
+
+// _____________________________________________________________________________
+void InvertedIndex::precomputeScores(float k, float b) {
+  // Clamped like for queries.
+  Bm25::Parameters parameters(k, b, 0);
+  _precomputeScores = true;
+  _precomputedK = parameters.k();
+  _precomputedB = parameters.b();
+}
+
+// _____________________________________________________________________________
+bool InvertedIndex::hasPrecomputedScores(
+    Bm25::Parameters const& parameters) const {
+  return _precomputeScores && parameters.k() == _precomputedK
+    && parameters.b() == _precomputedB;
+}
+
+// _____________________________________________________________________________
+vector<char const*> InvertedIndex::splitLines(char const* begin,
+    char const* end, size_t numberOfParts) {
+  vector<char const*> bounds(1, begin);
+  for (size_t i = 1; i < numberOfParts; ++i) {
+    char const* bound = std::max(bounds.back(),
+        begin + (end - begin) * i / numberOfParts);
+    if (bound == bounds.back()) continue;
+    // Move to the start of a line.
+    if (bound[-1] != '\n') {
+      bound = std::find(bound, end, '\n');
+      if (bound == end) break;
+      ++bound;
+    }
+    // Lines with the same URL are one document, keep them together.
+    while (bound < end) {
+      char const* previous = bound - 1;
+      while (previous > begin && previous[-1] != '\n') --previous;
+      char const* next = std::find(bound, end, '\n');
+      if (next == end) break;
+      string_view previousUrl(previous,
+          std::find(previous, bound, '\t') - previous);
+      string_view url(bound, std::find(bound, next, '\t') - bound);
+      if (url != previousUrl) break;
+      bound = next + 1;
+    }
+    if (bound == end) break;
+    if (bound > bounds.back()) bounds.push_back(bound);
+  }
+  bounds.push_back(end);
+  return bounds;
+}
+
+// _____________________________________________________________________________
+void InvertedIndex::parseLines(char const* begin, char const* end) {
   size_t pos = 0;
   size_t documentId;
 
   while (true) {
-    getline(file, line);
-    if (file.eof()) break;
+    // Only lines ending with a newline are parsed.
+    char const* lineEnd = std::find(begin, end, '\n');
+    if (lineEnd == end) break;
+    string line(begin, lineEnd);
+    begin = lineEnd + 1;
     // Extract record and url from line
     pos = line.find('\t', 0);
     if (pos > maxUrlLength) {
@@ -61,25 +205,59 @@ void InvertedIndex::buildFromCsvFile(string const& fileName,
     std::transform(record.begin(), record.end(), record.begin(), ::tolower);
     parseRecord(documentId, record);
   }
+}
 
-  calculateScores(bm25k, bm25b);
+// _____________________________________________________________________________
+void InvertedIndex::appendIndex(InvertedIndex* other) {
+  size_t offset = _urls.size();
+  for (size_t i = 0; i < other->_urls.size(); ++i) {
+    _urls.push_back(other->_urls[i]);
+    _records.push_back(other->_records[i]);
+    _documentLengthInWords.push_back(other->_documentLengthInWords[i]);
+  }
+  _totalLength += other->_totalLength;
+  for (map<string, vector<Posting> >::iterator it =
+      other->_uncompressedLists.begin();
+      it != other->_uncompressedLists.end(); ++it) {
+    vector<Posting>* postings = &_uncompressedLists[it->first];
+    size_t size = postings->size();
+    if (postings->empty())
+      postings->swap(it->second);
+    else
+      postings->insert(postings->end(), it->second.begin(), it->second.end());
+    for (size_t i = size; i < postings->size(); ++i)
+      (*postings)[i].documentId += offset;
+  }
+  // The positions do not contain document ids.
+  for (map<string, vector<uint32_t> >::iterator it =
+      other->_uncompressedPositions.begin();
+      it != other->_uncompressedPositions.end(); ++it) {
+    vector<uint32_t>* positions = &_uncompressedPositions[it->first];
+    if (positions->empty())
+      positions->swap(it->second);
+    else
+      positions->insert(positions->end(), it->second.begin(),
+          it->second.end());
+  }
 }
 
 // _____________________________________________________________________________
 int InvertedIndex::setIdAndSaveUrlAndRecord(
     string const& url, string const& record) {
   size_t documentId;
-  if (_urls.empty() || url.compare(_urls.back()) != 0) {
+  if (_urls.empty() || url != _urls.back()) {
     _records.push_back(record);
     _urls.push_back(url);
     _documentLengthInWords.push_back(0);
     documentId = _urls.size() - 1;
+    _nextPosition = 0;
   } else {
     documentId = _urls.size() - 1;
     // -1 as size_t is the largest value possible for size_t
     assert(static_cast<size_t>(-1) > documentId);
     assert(_records.size() > documentId);
-    _records[documentId] = _records[documentId] + " " + record;
+    _records.appendToBack(" ");
+    _records.appendToBack(record);
   }
   return documentId;
 }
@@ -93,28 +271,42 @@ void InvertedIndex::parseRecord(
 
   assert(documentId == _urls.size() - 1);
   while (pos < line.size()) {
-    while (pos < line.size() && !isalpha(line[pos])) pos++;
+    while (pos < line.size() && !isLetter(line[pos])) pos++;
     size_t wordStart = pos;
-    while (pos < line.size() && isalpha(line[pos])) pos++;
+    while (pos < line.size() && isLetter(line[pos])) pos++;
     size_t wordEnd = pos;
     assert(wordEnd <= line.size());
     assert(wordStart >= 0);
+    if (wordEnd == wordStart) continue;
+    uint32_t position = _nextPosition++;
 
     if (wordEnd > wordStart + minWordLength) {
       assert(_documentLengthInWords.size() > documentId);
       _documentLengthInWords[documentId]++;
+      _totalLength++;
       assert(wordEnd - wordStart > 0);
       word = line.substr(wordStart, wordEnd - wordStart);
       assert(word.size() > 0);
-      vector<Posting>* current = &_invertedLists[word];
-      vector<Posting>::iterator itPosting =
-        std::find(current->begin(), current->end(), documentId);
-      if (itPosting == current->end()) {
-        current->resize(current->size() + 1);
-        current->at(current->size() - 1) = Posting(documentId, 1);
-      } else {
-        itPosting->score = itPosting->score + 1;
+      // Documents are parsed in order, so the posting of the document can
+      // only be the last one.
+      vector<Posting>* current = &_uncompressedLists[word];
+      bool isNew = current->empty()
+        || current->back().documentId != documentId;
+      if (_storePositions) {
+        vector<uint32_t>* positions = &_uncompressedPositions[word];
+        // The count of the document is in front of its positions.
+        if (isNew)
+          positions->push_back(0);
+        else
+          assert(positions->size() > current->back().score);
+        ++(*positions)[positions->size() - 1
+          - (isNew ? 0 : static_cast<size_t>(current->back().score))];
+        positions->push_back(position);
       }
+      if (isNew)
+        current->push_back(Posting(documentId, 1));
+      else
+        current->back().score += 1;
     }
   }
 }
@@ -122,11 +314,9 @@ void InvertedIndex::parseRecord(
 // _____________________________________________________________________________
 void InvertedIndex::printInvertedIndex() const {
   // Print Index
-  for (map<string, vector<Posting> >::
-      const_iterator it = _invertedLists.begin();
-      it != _invertedLists.end(); ++it) {
-    std::cout << it->first << "\t";
-    vector<Posting> postings = it->second;
+  for (size_t wordId = 0; wordId < _words.size(); ++wordId) {
+    std::cout << _words[wordId] << "\t";
+    vector<Posting> postings = postingList(wordId).decode();
     if (!postings.empty())
       std::cout << postings[0].toString() << ";";
     for (size_t i = 1; i < postings.size(); ++i) {
@@ -142,52 +332,137 @@ void InvertedIndex::printInvertedIndex() const {
 }
 
 // _____________________________________________________________________________
-void InvertedIndex::calculateScores(
-    float const& bm25k = 1.75, float const& bm25b = 0.75) {
-  size_t avdl = 0;
-  for (size_t count = 1; count <= _documentLengthInWords.size(); ++count) {
-    avdl = ((count * avdl) + _documentLengthInWords[count - 1]) / (count + 1);
+void InvertedIndex::compressInvertedLists() {
+  _documentLengths.clear();
+  for (size_t i = 0; i < _documentLengthInWords.size(); ++i)
+    _documentLengths.push_back(
+        Bm25::quantizeLength(_documentLengthInWords[i]));
+  _documentLengthInWords.clear();
+  Bm25::Parameters parameters(_precomputedK, _precomputedB,
+      numberOfDocuments() ? static_cast<float>(_totalLength)
+      / numberOfDocuments() : 0);
+
+  _words.clear();
+  _listOffsets.clear();
+  _postingData.clear();
+  for (map<string, vector<Posting> >::iterator it =
+      _uncompressedLists.begin(); it != _uncompressedLists.end(); ++it) {
+    _words.push_back(it->first);
+    Bm25 bm25(parameters, numberOfDocuments(), it->second.size(),
+        _documentLengths.data());
+    _listOffsets.push_back(PostingList::encode(it->second, &_postingData,
+          _documentLengths.data(), _precomputeScores ? &bm25 : NULL));
+    vector<Posting>().swap(it->second);
   }
-  for (map<string, vector<Posting> >::iterator it = _invertedLists.begin();
-      it != _invertedLists.end(); ++it) {
-    vector<Posting> *postings = &(it->second);
-    size_t df = postings->size();
-    for (size_t i = 0; i < postings->size(); ++i) {
-      size_t tf = postings->at(i).score;
-      size_t dl = _documentLengthInWords[postings->at(i).documentId];
-      float tfStar = tf * (bm25k + 1) /
-        (bm25k * (1 - bm25b + ((bm25b * dl) / avdl)) + tf);
-      float bm25score = tfStar * log2(static_cast<float>(_urls.size()) / df);
-      postings->at(i).score = bm25score;
-    }
+  _uncompressedLists.clear();
+
+  _positionOffsets.clear();
+  _positionData.clear();
+  if (!_storePositions) return;
+  // The positions of each word in _words (all words have positions).
+  for (map<string, vector<uint32_t> >::iterator it =
+      _uncompressedPositions.begin(); it != _uncompressedPositions.end();
+      ++it) {
+    _positionOffsets.push_back(PositionList::encode(it->second,
+          &_positionData));
+    vector<uint32_t>().swap(it->second);
   }
+  _uncompressedPositions.clear();
 }
 
 // _____________________________________________________________________________
 size_t  InvertedIndex::countOfDocumentsContainingWord(
-    string const& word) const {
-  try {
-    return _invertedLists.at(word).size();
-  } catch(const std::out_of_range &e) {
-    return 0;
-  }
+    string_view word) const {
+  return postingList(word).size();
 }
 
 // _____________________________________________________________________________
-vector<Posting> InvertedIndex::getPostingsFromWord(string const& word) const {
-  try {
-    return _invertedLists.at(word);
-  } catch(const std::out_of_range &e) {
-    return vector<Posting>();
-  }
+PostingList InvertedIndex::postingList(string_view word) const {
+  size_t wordId;
+  if (!_words.find(word, &wordId))
+    return PostingList();
+  return postingList(wordId);
+}
+
+// _____________________________________________________________________________
+PostingList InvertedIndex::postingList(size_t wordId,
+    PostingList::Scoring scoring) const {
+  return PostingList(_postingData.data() + _listOffsets[wordId], scoring);
+}
+
+// _____________________________________________________________________________
+PostingList InvertedIndex::postingList(size_t wordId,
+    Bm25 const& bm25) const {
+  return PostingList(_postingData.data() + _listOffsets[wordId], bm25);
+}
+
+// _____________________________________________________________________________
+PositionList InvertedIndex::positionList(size_t wordId) const {
+  if (!hasPositions()) return PositionList();
+  return PositionList(_positionData.data() + _positionOffsets[wordId]);
 }
 
 // _____________________________________________________________________________
 string InvertedIndex::getUrlFromId(int const& id) const {
-  return _urls.at(id);
+  return _urls.at(id).to_string();
 }
 
 // _____________________________________________________________________________
 string InvertedIndex::getRecordFromId(int const& id) const {
-  return _records.at(id);
+  return _records.at(id).to_string();
+}
+
+// _____________________________________________________________________________
+void InvertedIndex::writeToFile(IndexFileWriter* file) const {
+  _urls.writeToFile(file);
+  _records.writeToFile(file);
+  file->write(_documentLengths);
+  file->writeValue<uint64_t>(_totalLength);
+
+  // The inverted lists as the dictionary of words, the offsets of their
+  // lists and the compressed lists.
+  _words.writeToFile(file);
+  file->write(_listOffsets);
+  file->write(_postingData);
+  // The positions (empty if the index has none).
+  file->write(_positionOffsets);
+  file->write(_positionData);
+  file->writeValue<uint8_t>(_precomputeScores);
+  file->writeValue<float>(_precomputedK);
+  file->writeValue<float>(_precomputedB);
+}
+
+// _____________________________________________________________________________
+void InvertedIndex::readFromFile(
+    std::shared_ptr<IndexFileReader> const& file) {
+  clear();
+  _indexFile = file;
+  _urls.readFromFile(file.get());
+  _records.readFromFile(file.get());
+  file->read(&_documentLengths);
+  _totalLength = file->readValue<uint64_t>();
+  if (_records.size() != _urls.size() ||
+      _documentLengths.size() != _urls.size())
+    throw IndexFileError("Index file contains inconsistent documents.");
+
+  _words.readFromFile(file.get());
+  file->read(&_listOffsets);
+  file->read(&_postingData);
+  if (_listOffsets.size() != _words.size())
+    throw IndexFileError("Index file contains inconsistent inverted lists.");
+  for (size_t i = 0; i < _listOffsets.size(); ++i) {
+    if (_listOffsets[i] >= _postingData.size())
+      throw IndexFileError("Index file contains inconsistent inverted lists.");
+  }
+  file->read(&_positionOffsets);
+  file->read(&_positionData);
+  if (!_positionOffsets.empty() && _positionOffsets.size() != _words.size())
+    throw IndexFileError("Index file contains inconsistent positions.");
+  for (size_t i = 0; i < _positionOffsets.size(); ++i) {
+    if (_positionOffsets[i] >= _positionData.size())
+      throw IndexFileError("Index file contains inconsistent positions.");
+  }
+  _precomputeScores = file->readValue<uint8_t>();
+  _precomputedK = file->readValue<float>();
+  _precomputedB = file->readValue<float>();
 }
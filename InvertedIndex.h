@@ -5,48 +5,143 @@
 #define INVERTEDINDEX_H_
 
 #include <gtest/gtest.h>
+#include <ctype.h>
+#include <stdint.h>
+#include <boost/utility/string_view.hpp>
 #include <map>
+#include <memory>
 #include <string>
 #include <vector>
+#include "./Bm25.h"
+#include "./FlatVector.h"
+#include "./IndexFile.h"
+#include "./PositionList.h"
 #include "./Posting.h"
+#include "./PostingList.h"
+#include "./StringTable.h"
+#include "./TermDictionary.h"
 
+using boost::string_view;
 using std::map;
 using std::string;
 using std::vector;
 
-// Class implementing an inverted index (INV).
+// Class implementing an inverted index (INV) of a collection of documents.
+// The postings hold the term frequencies of the words in the documents (and
+// optionally precomputed BM25 scores), the lengths of the documents are
+// quantized to one byte (see Bm25). Once
+// built (or read), the index does not change, so a SegmentedIndex can use it
+// as one of its segments.
 class InvertedIndex {
-  // list of record ids for each word in the collection.
-  map<string, vector<Posting> > _invertedLists;
-  vector<string> _records;
-  vector<string> _urls;
-  vector<size_t> _documentLengthInWords;
+  // The words in the collection (with their ids).
+  TermDictionary _words;
+  // Offset of the inverted list of each word in _postingData.
+  FlatVector<uint64_t> _listOffsets;
+  // All inverted lists compressed (see PostingList) back to back.
+  FlatVector<uint8_t> _postingData;
+  // The inverted lists while the index is built (before compression).
+  map<string, vector<Posting> > _uncompressedLists;
+  // The positions of the words in the documents (see PositionList), only
+  // if the index was built with positions. Offset of the positions of each
+  // word in _positionData.
+  FlatVector<uint64_t> _positionOffsets;
+  FlatVector<uint8_t> _positionData;
+  // The positions while the index is built: for each posting of the word
+  // the number of its positions followed by the positions.
+  map<string, vector<uint32_t> > _uncompressedPositions;
+  bool _storePositions;
+  // The position of the next word in the current document (counting all
+  // words, also those too short to be indexed).
+  uint32_t _nextPosition;
+  StringTable _records;
+  StringTable _urls;
+  // The lengths of the documents (in indexed words) while the index is
+  // built, their quantized form (see Bm25::quantizeLength) and their sum.
+  FlatVector<uint32_t> _documentLengthInWords;
+  FlatVector<uint8_t> _documentLengths;
+  uint64_t _totalLength;
+  // Whether the inverted lists have precomputed BM25 scores (or get them
+  // when the index is built), and their parameters k and b.
+  bool _precomputeScores;
+  float _precomputedK;
+  float _precomputedB;
+  // The mapped file the index was read from (if any).
+  std::shared_ptr<IndexFileReader> _indexFile;
   // Tests:
   FRIEND_TEST(InvertedIndex, buildFromCsvFile);
+  FRIEND_TEST(InvertedIndex, buildFromCsvFileInParallel);
   FRIEND_TEST(InvertedIndex, clear);
-  FRIEND_TEST(InvertedIndex, getPostingsFromWord);
+  FRIEND_TEST(InvertedIndex, postingList);
   FRIEND_TEST(InvertedIndex, getUrlFromId);
+  FRIEND_TEST(InvertedIndex, writeToFileAndReadFromFile);
+  FRIEND_TEST(InvertedIndex, positionList);
+  FRIEND_TEST(InvertedIndex, merge);
 
  public:
-  InvertedIndex();
-  // Getter for the  _invertedLists-map
-  /** EVIL
-  map<string, vector<Posting> >* invertedLists = &_invertedLists;
-  */
-  const map<string, vector<Posting> >& invertedLists() const {
-    return _invertedLists;
+  // Words with at most this many letters are not indexed.
+  static const size_t minWordLength = 2;
+  // Whether c is part of a word (the bytes of UTF-8 characters are not).
+  // Records, queries and snippets are split into words by it alike.
+  static bool isLetter(char c) {
+    return isalpha(static_cast<unsigned char>(c));
   }
+
+  InvertedIndex();
+  // The vocabulary, the id of a word is its position.
+  const TermDictionary& words() const { return _words; }
   // Create index from a text collection in CSV format (one record per line,
-  // two columns, column 1 = URL, column 2 = text).
-  void buildFromCsvFile(
-      string const& fileName,
-      float const& bm25k = 0.75, float const& bm25b = 1.75);
+  // two columns, column 1 = URL, column 2 = text). The file is split into
+  // ranges of lines which are indexed in parallel by numberOfThreads
+  // threads. With storePositions, the positions of the words in the
+  // documents are stored as well (for phrase queries). Only the lines
+  // behind the first offset bytes of the file are indexed. Returns the
+  // offset behind the last complete line indexed.
+  size_t buildFromCsvFile(string const& fileName,
+      unsigned int numberOfThreads = 1, bool storePositions = false,
+      size_t offset = 0);
+  // Create the index of the documents of the given indexes, one after the
+  // other (they must all have positions or none).
+  void merge(vector<InvertedIndex const*> const& indexes);
+  // Store the BM25 scores with the parameters k and b (and the statistics
+  // of this index) in the inverted lists, too, when the index is built or
+  // merged next (see PostingList::encode). Queries with these parameters on
+  // this index alone can use them instead of computing the scores.
+  void precomputeScores(float k, float b);
+  // Whether the inverted lists have scores precomputed with the given
+  // parameters.
+  bool hasPrecomputedScores(Bm25::Parameters const& parameters) const;
+
+  // The number of documents, their quantized lengths (see Bm25) and the sum
+  // of their lengths (in indexed words).
+  size_t numberOfDocuments() const { return _urls.size(); }
+  uint8_t const* documentLengths() const { return _documentLengths.data(); }
+  uint64_t totalLength() const { return _totalLength; }
 
   // Write inverted index to file
   void printInvertedIndex() const;
 
-  // Get a list of Record-Ids containing a given word.
-  vector<Posting> getPostingsFromWord(string const& word) const;
+  // Append the index to a binary index file.
+  void writeToFile(IndexFileWriter* file) const;
+  // Read an index written by writeToFile. URLs, records and document lengths
+  // are used directly from the mapped file. Whether the lists have
+  // precomputed scores is read as well.
+  void readFromFile(std::shared_ptr<IndexFileReader> const& file);
+
+  // The compressed inverted list of a word (empty for unknown words). It
+  // refers to the storage of the index, nothing is copied.
+  PostingList postingList(string_view word) const;
+  PostingList postingList(size_t wordId,
+      PostingList::Scoring scoring = PostingList::VALUES) const;
+  // The inverted list of a word scored by bm25.
+  PostingList postingList(size_t wordId, Bm25 const& bm25) const;
+  // Whether the index has the positions of the words.
+  bool hasPositions() const { return !_positionOffsets.empty(); }
+  // The size of the compressed inverted lists and positions (in bytes).
+  size_t postingBytes() const { return _postingData.size(); }
+  size_t positionBytes() const { return _positionData.size(); }
+  // The positions of a word for the postings of its inverted list (empty if
+  // the index has no positions).
+  PositionList positionList(size_t wordId) const;
 
   // Get URL to a given Record-Id
   string getUrlFromId(int const& id) const;
@@ -54,7 +149,24 @@ class InvertedIndex {
   // Get Record-Text to a given Record-Id
   string getRecordFromId(int const& id) const;
 
+  // The URL and the text of a record without copying them (they refer to
+  // the storage of the index).
+  string_view url(size_t id) const { return _urls.at(id); }
+  string_view record(size_t id) const { return _records.at(id); }
+
  private:
+  // Split the text [begin, end) into at most numberOfParts ranges of whole
+  // lines of about the same size. Consecutive lines with the same URL stay
+  // in one range. Returns the bounds of the ranges (including begin and
+  // end).
+  FRIEND_TEST(InvertedIndex, splitLines);
+  static vector<char const*> splitLines(char const* begin, char const* end,
+      size_t numberOfParts);
+  // Add the records on the lines in [begin, end) to the index.
+  void parseLines(char const* begin, char const* end);
+  // Append the documents and (uncompressed) inverted lists of other to this
+  // index, other's lists are moved if possible.
+  void appendIndex(InvertedIndex* other);
   // Parse a record and add each word to the respective index list.
   void parseRecord(
       size_t const& documentId, string const& record);
@@ -64,9 +176,10 @@ class InvertedIndex {
   // Clear inverted list
   void clear();
   // Count of Documents containing a word
-  size_t countOfDocumentsContainingWord(string const& word) const;
-  // Calculate and set scores in the Postings in _invertedLists
-  void calculateScores(float const& bm25k, float const& bm25b);
+  size_t countOfDocumentsContainingWord(string_view word) const;
+  // Move the _uncompressedLists into _words, _listOffsets and _postingData
+  // (and the document lengths into _documentLengths).
+  void compressInvertedLists();
 };
 
 #endif  // INVERTEDINDEX_H_
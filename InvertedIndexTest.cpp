@@ -5,11 +5,15 @@
 #include <fstream>  // NOLINT
 #include <vector>
 #include <string>
+#include "./IndexFile.h"
+#include "./Bm25.h"
 #include "./InvertedIndex.h"
 #include "./Posting.h"
+#include "./PostingList.h"
 
 const char mockupFileName[] = "InvertedIndexMockup.test.tmp";
 const char mockup2FileName[] = "InvertedIndexMockup2.test.tmp";
+const char indexFileName[] = "InvertedIndex.index.test.tmp";
 InvertedIndex ii;
 
 // ___________________________________________________________________________
@@ -42,13 +46,23 @@ TEST(InvertedIndex, createMockup) {
 
 // ___________________________________________________________________________
 TEST(InvertedIndex, buildFromCsvFile) {
-  ii.buildFromCsvFile(mockupFileName);
+  // The whole file is indexed (it has 114 bytes).
+  EXPECT_EQ(114, ii.buildFromCsvFile(mockupFileName));
   EXPECT_EQ(2, ii._urls.size());
   EXPECT_EQ(2, ii._records.size());
-  EXPECT_EQ(6, ii._invertedLists.size());
-  EXPECT_EQ(4, ii._documentLengthInWords.at(0));
-  EXPECT_EQ(2, ii._invertedLists.at("about").size());
+  EXPECT_EQ(6, ii._words.size());
+  EXPECT_EQ(4, ii._documentLengths.at(0));
+  EXPECT_EQ(10, ii.totalLength());
+  EXPECT_EQ(2, ii.postingList("about").size());
   EXPECT_EQ("this is About anything this is About anything", ii._records.at(1));
+  // The postings hold the term frequencies.
+  EXPECT_EQ(2, ii.postingList("about").decode().at(1).score);
+
+  // Only the lines behind the first one.
+  InvertedIndex rest;
+  EXPECT_EQ(114, rest.buildFromCsvFile(mockupFileName, 1, false, 36));
+  ASSERT_EQ(1, rest._urls.size());
+  EXPECT_EQ("www.example.com", rest._urls.at(0));
 }
 
 // ___________________________________________________________________________
@@ -62,21 +76,116 @@ TEST(InvertedIndex, buildFromCsvFileLastCharIsSpecial) {
   ii.buildFromCsvFile(mockup2FileName);
 }
 
+// ___________________________________________________________________________
+TEST(InvertedIndex, utf8) {
+  EXPECT_TRUE(InvertedIndex::isLetter('a'));
+  EXPECT_FALSE(InvertedIndex::isLetter('-'));
+  // The bytes of UTF-8 characters separate words.
+  EXPECT_FALSE(InvertedIndex::isLetter('\xC3'));
+  EXPECT_FALSE(InvertedIndex::isLetter('\xBC'));
+  string fileName = string(mockupFileName) + ".utf8";
+  std::ofstream file(fileName.c_str());
+  file << "url\tM\xC3\xBC" "ller and G\xC3\xB6" "del in a caf\xC3\xA9\n";
+  file.close();
+  InvertedIndex index;
+  index.buildFromCsvFile(fileName);
+  EXPECT_EQ(1, index.postingList("ller").size());
+  EXPECT_EQ(1, index.postingList("del").size());
+  EXPECT_EQ(1, index.postingList("caf").size());
+  EXPECT_EQ(4, index.totalLength());
+  remove(fileName.c_str());
+}
+
+// ___________________________________________________________________________
+TEST(InvertedIndex, splitLines) {
+  string text = "a\tx\nb\ty\nb\tz\nc\tw\n";
+  char const* begin = text.data();
+  char const* end = begin + text.size();
+  vector<char const*> bounds = InvertedIndex::splitLines(begin, end, 4);
+  // The lines of b stay together.
+  ASSERT_EQ(4, bounds.size());
+  EXPECT_EQ(begin, bounds[0]);
+  EXPECT_EQ(begin + 4, bounds[1]);
+  EXPECT_EQ(begin + 12, bounds[2]);
+  EXPECT_EQ(end, bounds[3]);
+  // Not more parts than documents.
+  EXPECT_EQ(4, InvertedIndex::splitLines(begin, end, 100).size());
+  EXPECT_EQ(2, InvertedIndex::splitLines(begin, end, 1).size());
+}
+
+// ___________________________________________________________________________
+TEST(InvertedIndex, buildFromCsvFileInParallel) {
+  InvertedIndex sequential;
+  sequential.buildFromCsvFile(mockup2FileName);
+  for (unsigned int threads = 2; threads < 8; ++threads) {
+    InvertedIndex parallel;
+    parallel.buildFromCsvFile(mockup2FileName, threads);
+    ASSERT_EQ(sequential._urls.size(), parallel._urls.size());
+    for (size_t i = 0; i < sequential._urls.size(); ++i) {
+      EXPECT_EQ(sequential._urls[i], parallel._urls[i]);
+      EXPECT_EQ(sequential._records[i], parallel._records[i]);
+      EXPECT_EQ(sequential._documentLengths[i],
+          parallel._documentLengths[i]);
+    }
+    ASSERT_EQ(sequential._words.size(), parallel._words.size());
+    for (size_t wordId = 0; wordId < sequential._words.size(); ++wordId) {
+      EXPECT_EQ(sequential._words[wordId], parallel._words[wordId]);
+      vector<Posting> expected = sequential.postingList(wordId).decode();
+      vector<Posting> postings = parallel.postingList(wordId).decode();
+      ASSERT_EQ(expected.size(), postings.size());
+      for (size_t i = 0; i < expected.size(); ++i) {
+        EXPECT_EQ(expected[i].documentId, postings[i].documentId);
+        EXPECT_EQ(expected[i].score, postings[i].score);
+      }
+    }
+  }
+}
+
 // ___________________________________________________________________________
 TEST(InvertedIndex, clear) {
   ii.clear();
   EXPECT_TRUE(ii._urls.empty());
   EXPECT_TRUE(ii._records.empty());
-  EXPECT_TRUE(ii._invertedLists.empty());
-  EXPECT_TRUE(ii._documentLengthInWords.empty());
+  EXPECT_TRUE(ii._words.empty());
+  EXPECT_TRUE(ii._documentLengths.empty());
+  EXPECT_EQ(0, ii.totalLength());
 }
 
 // ___________________________________________________________________________
-TEST(InvertedIndex, getPostingsFromWord) {
+TEST(InvertedIndex, postingList) {
   ii.clear();
-  ii._invertedLists["test"].push_back(Posting(5, 0.1));
-  EXPECT_EQ(5, ii.getPostingsFromWord("test").at(0).documentId);
-  EXPECT_NEAR(0.1, ii.getPostingsFromWord("test").at(0).score, 1e-5);
+  for (size_t i = 0; i < 6; ++i) ii._documentLengthInWords.push_back(4 + i);
+  ii._uncompressedLists["test"].push_back(Posting(5, 3));
+  ii.compressInvertedLists();
+  EXPECT_EQ(5, ii.postingList("test").decode().at(0).documentId);
+  EXPECT_EQ(3, ii.postingList("test").decode().at(0).score);
+  EXPECT_TRUE(ii.postingList("unknown").empty());
+  // Scored at query time.
+  Bm25::Parameters parameters(1.75, 0.75, 6);
+  Bm25 bm25(parameters, 6, 1, ii.documentLengths());
+  PostingList list = ii.postingList(0, bm25);
+  EXPECT_FLOAT_EQ(bm25.score(3, 9), list.decode().at(0).score);
+  EXPECT_FLOAT_EQ(bm25.score(3, 9), list.maxScore());
+  EXPECT_FALSE(list.hasPrecomputedScores());
+
+  // With precomputed scores (the same, up to quantization).
+  InvertedIndex precomputed;
+  for (size_t i = 0; i < 6; ++i) {
+    precomputed._urls.push_back("url");
+    precomputed._documentLengthInWords.push_back(4 + i);
+  }
+  precomputed._totalLength = 39;
+  precomputed._uncompressedLists["test"].push_back(Posting(5, 3));
+  precomputed.precomputeScores(1.75, 0.75);
+  precomputed.compressInvertedLists();
+  EXPECT_TRUE(precomputed.hasPrecomputedScores(parameters));
+  EXPECT_FALSE(precomputed.hasPrecomputedScores(
+        Bm25::Parameters(1.2, 0.75, 6)));
+  list = precomputed.postingList(0, PostingList::PRECOMPUTED_SCORES);
+  bm25 = Bm25(Bm25::Parameters(1.75, 0.75, 6.5), 6, 1,
+      precomputed.documentLengths());
+  EXPECT_NEAR(bm25.score(3, 9), list.decode().at(0).score, 1e-5);
+  EXPECT_EQ(3, precomputed.postingList(0).decode().at(0).score);
 }
 
 // ___________________________________________________________________________
@@ -86,3 +195,100 @@ TEST(InvertedIndex, getUrlFromId) {
   EXPECT_EQ("first_url", ii.getUrlFromId(0));
 }
 
+// ___________________________________________________________________________
+TEST(InvertedIndex, writeToFileAndReadFromFile) {
+  ii.buildFromCsvFile(mockupFileName);
+  IndexFileWriter writer(indexFileName);
+  ii.writeToFile(&writer);
+  writer.close();
+
+  InvertedIndex read;
+  read.readFromFile(std::make_shared<IndexFileReader>(indexFileName));
+  EXPECT_TRUE(read._urls.at(0).data() != ii._urls.at(0).data());
+  EXPECT_EQ(2, read._urls.size());
+  EXPECT_EQ("www.example.com", read.getUrlFromId(1));
+  EXPECT_EQ("this is About anything this is About anything",
+      read.getRecordFromId(1));
+  EXPECT_EQ(4, read._documentLengths.at(0));
+  EXPECT_EQ(ii.totalLength(), read.totalLength());
+  EXPECT_FALSE(read.hasPrecomputedScores(Bm25::Parameters(1.75, 0.75, 5)));
+  ASSERT_EQ(ii._words.size(), read._words.size());
+  ASSERT_EQ(2, read.postingList("about").decode().size());
+  EXPECT_EQ(1, read.postingList("about").decode().at(1).documentId);
+  EXPECT_FLOAT_EQ(ii.postingList("about").decode().at(1).score,
+      read.postingList("about").decode().at(1).score);
+
+  // Files which are no index files are rejected.
+  EXPECT_THROW(IndexFileReader reader(mockupFileName), IndexFileError);
+}
+
+// ___________________________________________________________________________
+TEST(InvertedIndex, positionList) {
+  ii.buildFromCsvFile(mockupFileName);
+  EXPECT_FALSE(ii.hasPositions());
+  size_t wordId;
+  ASSERT_TRUE(ii._words.find("about", &wordId));
+  EXPECT_TRUE(ii.positionList(wordId).empty());
+
+  // Positions count all words (also "is") and continue on the second line
+  // of a document.
+  vector<uint32_t> positions;
+  for (unsigned int threads = 1; threads <= 2; ++threads) {
+    ii.buildFromCsvFile(mockupFileName, threads, true);
+    ASSERT_TRUE(ii.hasPositions());
+    ASSERT_TRUE(ii._words.find("about", &wordId));
+    PositionList list = ii.positionList(wordId);
+    ASSERT_EQ(2, list.size());
+    list.positions(0, &positions);
+    EXPECT_EQ(vector<uint32_t>({2}), positions);
+    list.positions(1, &positions);
+    EXPECT_EQ(vector<uint32_t>({2, 6}), positions);
+    EXPECT_EQ(4, ii._documentLengths.at(0));
+  }
+
+  IndexFileWriter writer(indexFileName);
+  ii.writeToFile(&writer);
+  writer.close();
+  InvertedIndex read;
+  read.readFromFile(std::make_shared<IndexFileReader>(indexFileName));
+  ASSERT_TRUE(read.hasPositions());
+  ASSERT_TRUE(read._words.find("anything", &wordId));
+  read.positionList(wordId).positions(0, &positions);
+  EXPECT_EQ(vector<uint32_t>({3, 7}), positions);
+}
+
+// ___________________________________________________________________________
+TEST(InvertedIndex, merge) {
+  InvertedIndex first;
+  InvertedIndex second;
+  first.buildFromCsvFile(mockupFileName, 1, true);
+  second.buildFromCsvFile(mockup2FileName, 1, true);
+  InvertedIndex merged;
+  merged.merge({&first, &second});
+  ASSERT_EQ(2 + second._urls.size(), merged._urls.size());
+  EXPECT_EQ("www.example.com", merged.getUrlFromId(1));
+  EXPECT_EQ(second.getUrlFromId(0), merged.getUrlFromId(2));
+  EXPECT_EQ(second.getRecordFromId(1), merged.getRecordFromId(3));
+  EXPECT_EQ(second.totalLength() + first.totalLength(),
+      merged.totalLength());
+  EXPECT_EQ(second._documentLengths[1], merged._documentLengths[3]);
+
+  // The lists of words in both indexes are concatenated.
+  vector<Posting> postings = merged.postingList("about").decode();
+  ASSERT_EQ(2, postings.size());
+  postings = merged.postingList("macpherson").decode();
+  vector<Posting> expected = second.postingList("macpherson").decode();
+  ASSERT_EQ(expected.size(), postings.size());
+  for (size_t i = 0; i < expected.size(); ++i) {
+    EXPECT_EQ(expected[i].documentId + 2, postings[i].documentId);
+    EXPECT_EQ(expected[i].score, postings[i].score);
+  }
+  size_t wordId;
+  vector<uint32_t> positions;
+  ASSERT_TRUE(merged._words.find("anything", &wordId));
+  merged.positionList(wordId).positions(0, &positions);
+  EXPECT_EQ(vector<uint32_t>({3, 7}), positions);
+  ASSERT_TRUE(merged._words.find("rathgen", &wordId));
+  merged.positionList(wordId).positions(0, &positions);
+  EXPECT_EQ(vector<uint32_t>({1}), positions);
+}
@@ -0,0 +1,98 @@
+// Copyright 2012, Milan Oberkirch
+// Author: Milan Oberkirch <oberkirm@informatik.uni-freiburg.de>
+
+#include "./JsonWriter.h"
+#include <stdint.h>
+#include <boost/utility/string_view.hpp>
+#include <cmath>
+#include <cstdio>
+#include <string>
+
+// ___________________________________________________________________________
+void JsonWriter::key(string_view name) {
+  beginValue();
+  _output->push_back('"');
+  appendEscaped(name, _output);
+  _output->append("\":", 2);
+  _afterKey = true;
+}
+
+// ___________________________________________________________________________
+void JsonWriter::value(string_view text) {
+  beginValue();
+  _output->push_back('"');
+  appendEscaped(text, _output);
+  _output->push_back('"');
+}
+
+// ___________________________________________________________________________
+void JsonWriter::value(uint64_t number) {
+  beginValue();
+  char digits[20];
+  size_t length = 0;
+  do {
+    digits[length++] = '0' + number % 10;
+    number /= 10;
+  } while (number);
+  while (length) _output->push_back(digits[--length]);
+}
+
+// ___________________________________________________________________________
+void JsonWriter::value(double number) {
+  if (!std::isfinite(number)) {
+    null();
+    return;
+  }
+  beginValue();
+  char buffer[32];
+  int length = snprintf(buffer, sizeof(buffer), "%.7g", number);
+  _output->append(buffer, length);
+}
+
+// ___________________________________________________________________________
+void JsonWriter::value(bool truth) {
+  beginValue();
+  _output->append(truth ? "true" : "false");
+}
+
+// ___________________________________________________________________________
+void JsonWriter::null() {
+  beginValue();
+  _output->append("null", 4);
+}
+
+// ___________________________________________________________________________
+void JsonWriter::appendEscaped(string_view text, string* output) {
+  static char const hexDigits[] = "0123456789abcdef";
+  size_t plain = 0;
+  for (size_t i = 0; i < text.size(); ++i) {
+    unsigned char c = text[i];
+    if (c >= 0x20 && c != '"' && c != '\\') continue;
+    // Append the characters not needing an escape at once.
+    output->append(text.data() + plain, i - plain);
+    plain = i + 1;
+    switch (c) {
+      case '"': output->append("\\\"", 2); break;
+      case '\\': output->append("\\\\", 2); break;
+      case '\n': output->append("\\n", 2); break;
+      case '\r': output->append("\\r", 2); break;
+      case '\t': output->append("\\t", 2); break;
+      default:
+        output->append("\\u00", 4);
+        output->push_back(hexDigits[c >> 4]);
+        output->push_back(hexDigits[c & 0xF]);
+    }
+  }
+  output->append(text.data() + plain, text.size() - plain);
+}
+
+// ___________________________________________________________________________
+void JsonWriter::beginValue() {
+  if (_afterKey) {
+    _afterKey = false;
+    return;
+  }
+  if (_isFirst.empty()) return;
+  if (!_isFirst.back()) _output->push_back(',');
+  _isFirst.back() = false;
+}
@@ -0,0 +1,62 @@
+// Copyright 2012, Milan Oberkirch
+// Author: Milan Oberkirch <oberkirm@informatik.uni-freiburg.de>
+
+#ifndef JSONWRITER_H_
+#define JSONWRITER_H_
+
+#include <gtest/gtest.h>
+#include <stdint.h>
+#include <boost/utility/string_view.hpp>
+#include <string>
+#include <vector>
+
+using boost::string_view;
+using std::string;
+using std::vector;
+
+// Appends JSON to a string (e.g. the buffer of an answer), without
+// temporary strings or streams. Strings are escaped. Commas and colons are
+// inserted automatically:
+//   writer.beginObject();
+//   writer.key("matches");
+//   writer.beginArray();
+//   writer.value("a\"b");
+//   writer.endArray();
+//   writer.endObject();
+// appends {"matches":["a\"b"]}.
+class JsonWriter {
+ public:
+  explicit JsonWriter(string* output) : _output(output), _afterKey(false) {}
+
+  void beginObject() { beginValue(); _output->push_back('{'); open(); }
+  void endObject() { _output->push_back('}'); _isFirst.pop_back(); }
+  void beginArray() { beginValue(); _output->push_back('['); open(); }
+  void endArray() { _output->push_back(']'); _isFirst.pop_back(); }
+  // The key of the next value of an object.
+  void key(string_view name);
+
+  void value(string_view text);
+  void value(char const* text) { value(string_view(text)); }
+  void value(uint64_t number);
+  // Not finite numbers are written as null.
+  void value(double number);
+  void value(bool truth);
+  void null();
+
+  // Append text escaped as content of a JSON-string (without the quotes).
+  FRIEND_TEST(JsonWriter, appendEscaped);
+  static void appendEscaped(string_view text, string* output);
+
+ private:
+  // Append the comma separating the value from the previous one.
+  void beginValue();
+  void open() { _isFirst.push_back(true); }
+
+  string* _output;
+  // For each open object and array, whether no value was written yet.
+  vector<bool> _isFirst;
+  // Whether the next value follows a key.
+  bool _afterKey;
+};
+
+#endif  // JSONWRITER_H_
@@ -0,0 +1,56 @@
+// Copyright 2012, Milan Oberkirch
+// Author: Milan Oberkirch <oberkirm@informatik.uni-freiburg.de>
+
+#include <gtest/gtest.h>
+#include <cmath>
+#include <string>
+#include "./JsonWriter.h"
+
+using std::string;
+
+// ___________________________________________________________________________
+TEST(JsonWriter, appendEscaped) {
+  string output = "x";
+  JsonWriter::appendEscaped("a\"b\\c\nd\te\x01\x1f\xc3\xa4/", &output);
+  EXPECT_EQ("xa\\\"b\\\\c\\nd\\te\\u0001\\u001f\xc3\xa4/", output);
+  output.clear();
+  JsonWriter::appendEscaped("", &output);
+  EXPECT_EQ("", output);
+}
+
+// ___________________________________________________________________________
+TEST(JsonWriter, write) {
+  string output = "callback(";
+  JsonWriter writer(&output);
+  writer.beginObject();
+  writer.key("hits");
+  writer.beginArray();
+  for (uint64_t id = 0; id < 2; ++id) {
+    writer.beginObject();
+    writer.key("id");
+    writer.value(static_cast<uint64_t>(id * 1234567890123ULL));
+    writer.key("url");
+    writer.value("http://a/\"x\"");
+    writer.key("score");
+    writer.value(id + 0.5);
+    writer.endObject();
+  }
+  writer.endArray();
+  writer.key("empty");
+  writer.beginArray();
+  writer.endArray();
+  writer.key("values");
+  writer.beginArray();
+  writer.value(true);
+  writer.value(false);
+  writer.null();
+  writer.value(NAN);
+  writer.value(-2.25);
+  writer.endArray();
+  writer.endObject();
+  output += ");";
+  EXPECT_EQ("callback({\"hits\":["
+      "{\"id\":0,\"url\":\"http://a/\\\"x\\\"\",\"score\":0.5},"
+      "{\"id\":1234567890123,\"url\":\"http://a/\\\"x\\\"\",\"score\":1.5}],"
+      "\"empty\":[],\"values\":[true,false,null,null,-2.25]});", output);
+}
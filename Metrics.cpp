@@ -0,0 +1,240 @@
+// Copyright 2012, Milan Oberkirch
+// Author: Milan Oberkirch <oberkirm@informatik.uni-freiburg.de>
+
+#include "./Metrics.h"
+#include <stdint.h>
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdio>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+using std::pair;
+
+const size_t Metrics::numberOfBuckets;
+
+// How a histogram is exported: histograms with the same name are one
+// metric with the label phase. The buckets are 2^minExponent to
+// 2^maxExponent (times scale).
+struct HistogramExport {
+  char const* name;
+  char const* phase;
+  char const* help;
+  double scale;
+  int minExponent;
+  int maxExponent;
+};
+
+// In the order of Metrics::Histogram.
+static HistogramExport const histogramExports[] = {
+  {"searchserver_phase_seconds", "parse",
+    "Time spent in the phases of answering queries.", 1e-9, 10, 35},
+  {"searchserver_phase_seconds", "lookup", "", 1e-9, 10, 35},
+  {"searchserver_phase_seconds", "intersect", "", 1e-9, 10, 35},
+  {"searchserver_phase_seconds", "rank", "", 1e-9, 10, 35},
+  {"searchserver_phase_seconds", "fuzzy", "", 1e-9, 10, 35},
+  {"searchserver_phase_seconds", "serialize", "", 1e-9, 10, 35},
+  {"searchserver_request_seconds", NULL,
+    "Time spent answering requests.", 1e-9, 10, 35},
+  {"searchserver_edit_distance_seconds", NULL,
+    "Time spent computing the edit distances of a fuzzy lookup.", 1e-9, 10,
+    35},
+  {"searchserver_fuzzy_matches", NULL,
+    "Number of similar words found by a fuzzy lookup.", 1, 0, 10}
+};
+
+// In the order of Metrics::Counter.
+static char const* const counterExports[][2] = {
+  {"searchserver_searches_total", "Searches answered."},
+  {"searchserver_vocabulary_lookups_total", "Vocabulary lookups answered."},
+  {"searchserver_errors_total", "Requests answered with an error."}
+};
+
+// Hands out the ids of the Metrics.
+static std::atomic<uint64_t> nextId(0);
+
+// ___________________________________________________________________________
+Metrics::Metrics() : _id(nextId++) {
+}
+
+// ___________________________________________________________________________
+Metrics::Shard::Shard() {
+  for (size_t i = 0; i < numberOfCounters; ++i) counters[i] = 0;
+  for (size_t i = 0; i < numberOfHistograms; ++i) {
+    sums[i] = 0;
+    for (size_t j = 0; j < numberOfBuckets; ++j) buckets[i][j] = 0;
+  }
+}
+
+// ___________________________________________________________________________
+Metrics::Shard* Metrics::shard() {
+  // The shards of this thread by the ids of their Metrics (ids are not
+  // reused, so entries of destroyed Metrics are never found again).
+  static thread_local vector<pair<uint64_t, Shard*> > shards;
+  for (size_t i = 0; i < shards.size(); ++i)
+    if (shards[i].first == _id) return shards[i].second;
+  std::lock_guard<std::mutex> lock(_mutex);
+  _shards.emplace_back(new Shard());
+  shards.push_back(pair<uint64_t, Shard*>(_id, _shards.back().get()));
+  return _shards.back().get();
+}
+
+// Add n to a value only the calling thread writes.
+static void add(std::atomic<uint64_t>* value, uint64_t n) {
+  value->store(value->load(std::memory_order_relaxed) + n,
+      std::memory_order_relaxed);
+}
+
+// ___________________________________________________________________________
+void Metrics::increment(Counter counter, uint64_t n) {
+  add(&shard()->counters[counter], n);
+}
+
+// ___________________________________________________________________________
+void Metrics::record(Histogram histogram, uint64_t value) {
+  Shard* shard = this->shard();
+  add(&shard->buckets[histogram][bucket(value)], 1);
+  add(&shard->sums[histogram], value);
+}
+
+// ___________________________________________________________________________
+size_t Metrics::bucket(uint64_t value) {
+  // Bucket b has the values in (upperBound(b - 1), upperBound(b)], so the
+  // bucket of value follows the one value - 1 would have with buckets
+  // starting at their bounds.
+  if (value <= 16) return value;
+  uint64_t below = value - 1;
+  int exponent = 63 - __builtin_clzll(below);
+  if (exponent >= 40) return numberOfBuckets - 1;
+  return 17 + (exponent - 4) * 16 + ((below >> (exponent - 4)) & 15);
+}
+
+// ___________________________________________________________________________
+uint64_t Metrics::upperBound(size_t bucket) {
+  if (bucket < 16) return bucket;
+  if (bucket == numberOfBuckets - 1) return UINT64_MAX;
+  int exponent = (bucket - 16) / 16 + 4;
+  return static_cast<uint64_t>(16 + (bucket - 16) % 16) << (exponent - 4);
+}
+
+// ___________________________________________________________________________
+uint64_t Metrics::count(Counter counter) const {
+  std::lock_guard<std::mutex> lock(_mutex);
+  uint64_t count = 0;
+  for (size_t i = 0; i < _shards.size(); ++i)
+    count += _shards[i]->counters[counter].load(std::memory_order_relaxed);
+  return count;
+}
+
+// ___________________________________________________________________________
+void Metrics::buckets(Histogram histogram, vector<uint64_t>* counts) const {
+  counts->assign(numberOfBuckets, 0);
+  std::lock_guard<std::mutex> lock(_mutex);
+  for (size_t i = 0; i < _shards.size(); ++i) {
+    for (size_t j = 0; j < numberOfBuckets; ++j) {
+      (*counts)[j] +=
+        _shards[i]->buckets[histogram][j].load(std::memory_order_relaxed);
+    }
+  }
+}
+
+// ___________________________________________________________________________
+uint64_t Metrics::count(Histogram histogram) const {
+  vector<uint64_t> counts;
+  buckets(histogram, &counts);
+  uint64_t count = 0;
+  for (size_t i = 0; i < counts.size(); ++i) count += counts[i];
+  return count;
+}
+
+// ___________________________________________________________________________
+uint64_t Metrics::sum(Histogram histogram) const {
+  std::lock_guard<std::mutex> lock(_mutex);
+  uint64_t sum = 0;
+  for (size_t i = 0; i < _shards.size(); ++i)
+    sum += _shards[i]->sums[histogram].load(std::memory_order_relaxed);
+  return sum;
+}
+
+// ___________________________________________________________________________
+uint64_t Metrics::quantile(Histogram histogram, double q) const {
+  vector<uint64_t> counts;
+  buckets(histogram, &counts);
+  uint64_t count = 0;
+  for (size_t i = 0; i < counts.size(); ++i) count += counts[i];
+  if (count == 0) return 0;
+  // The rank of the value (at least 1).
+  uint64_t rank = std::max<uint64_t>(1, ceil(q * count));
+  uint64_t seen = 0;
+  for (size_t i = 0; i < counts.size(); ++i) {
+    seen += counts[i];
+    if (seen >= rank) return upperBound(i);
+  }
+  return upperBound(numberOfBuckets - 1);
+}
+
+// A value as Prometheus expects it (integers without exponent).
+static string formatValue(double value) {
+  char buffer[32];
+  if (value == floor(value) && fabs(value) < 1e15)
+    snprintf(buffer, sizeof(buffer), "%.0f", value);
+  else
+    snprintf(buffer, sizeof(buffer), "%.9g", value);
+  return buffer;
+}
+
+// ___________________________________________________________________________
+void Metrics::appendMetric(string const& name, string const& type,
+    string const& help, double value, string* out) {
+  out->append("# HELP ").append(name).append(" ").append(help).append("\n");
+  out->append("# TYPE ").append(name).append(" ").append(type).append("\n");
+  out->append(name).append(" ").append(formatValue(value)).append("\n");
+}
+
+// ___________________________________________________________________________
+void Metrics::writePrometheus(string* out) const {
+  for (size_t i = 0; i < numberOfCounters; ++i) {
+    appendMetric(counterExports[i][0], "counter", counterExports[i][1],
+        count(static_cast<Counter>(i)), out);
+  }
+  vector<uint64_t> counts;
+  for (size_t i = 0; i < numberOfHistograms; ++i) {
+    HistogramExport const& metric = histogramExports[i];
+    string name = metric.name;
+    if (i == 0 || name != histogramExports[i - 1].name) {
+      out->append("# HELP ").append(name).append(" ").append(metric.help)
+        .append("\n");
+      out->append("# TYPE ").append(name).append(" histogram\n");
+    }
+    string labels = metric.phase
+      ? string("phase=\"") + metric.phase + "\"," : string();
+    buckets(static_cast<Histogram>(i), &counts);
+    // Powers of two are upper bounds of buckets, so the counts of the values
+    // up to them (le) are exact.
+    size_t bucket = 0;
+    uint64_t below = 0;
+    for (int exponent = metric.minExponent; exponent <= metric.maxExponent;
+        ++exponent) {
+      uint64_t bound = static_cast<uint64_t>(1) << exponent;
+      for (; bucket < numberOfBuckets && upperBound(bucket) <= bound;
+          ++bucket)
+        below += counts[bucket];
+      out->append(name).append("_bucket{").append(labels).append("le=\"")
+        .append(formatValue(bound * metric.scale)).append("\"} ")
+        .append(formatValue(below)).append("\n");
+    }
+    for (; bucket < numberOfBuckets; ++bucket) below += counts[bucket];
+    out->append(name).append("_bucket{").append(labels)
+      .append("le=\"+Inf\"} ").append(formatValue(below)).append("\n");
+    string sumLabels = metric.phase
+      ? string("{phase=\"") + metric.phase + "\"}" : string();
+    out->append(name).append("_sum").append(sumLabels).append(" ")
+      .append(formatValue(sum(static_cast<Histogram>(i)) * metric.scale))
+      .append("\n");
+    out->append(name).append("_count").append(sumLabels).append(" ")
+      .append(formatValue(below)).append("\n");
+  }
+}
@@ -0,0 +1,130 @@
+// Copyright 2012, Milan Oberkirch
+// Author: Milan Oberkirch <oberkirm@informatik.uni-freiburg.de>
+
+#ifndef METRICS_H_
+#define METRICS_H_
+
+#include <gtest/gtest.h>
+#include <stdint.h>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+using std::string;
+using std::vector;
+
+// Counters and histograms of the server, cheap enough to be updated for
+// every request. Each thread updates its own shard (with relaxed atomic
+// stores, it is the only writer), so threads never wait for each other or
+// share cache lines. The shards are only summed up when the values are read
+// (see writePrometheus). The histograms have HDR-style buckets: values up to
+// 16 exactly, larger ones in 16 buckets between consecutive powers of two,
+// so quantiles are exact up to 1/16 of the value.
+class Metrics {
+ public:
+  // The histograms. Durations are in nanoseconds.
+  enum Histogram {
+    // The phases of answering a query: parsing it, looking up its words,
+    // traversing the inverted lists (scoring the candidates on the way),
+    // ordering the results, finding candidates for similar words and
+    // writing the answer.
+    PARSE,
+    LOOKUP,
+    INTERSECT,
+    RANK,
+    FUZZY,
+    SERIALIZE,
+    // Whole requests and the edit distances of the candidates of a
+    // fuzzy lookup.
+    REQUEST,
+    EDIT_DISTANCE,
+    // The number of similar words found by a fuzzy lookup.
+    FUZZY_MATCHES,
+    numberOfHistograms
+  };
+  enum Counter {
+    SEARCHES,
+    VOCABULARY_LOOKUPS,
+    // Requests answered with an error.
+    ERRORS,
+    numberOfCounters
+  };
+
+  Metrics();
+
+  void increment(Counter counter, uint64_t n = 1);
+  void record(Histogram histogram, uint64_t value);
+
+  // The sum of a counter over all threads.
+  uint64_t count(Counter counter) const;
+  // The number of values recorded, their sum and the largest value of the
+  // bucket containing the given quantile of them (0 without values).
+  uint64_t count(Histogram histogram) const;
+  uint64_t sum(Histogram histogram) const;
+  uint64_t quantile(Histogram histogram, double q) const;
+
+  // Append the counters and histograms in the text format of Prometheus
+  // (durations in seconds). Histograms have buckets for powers of two.
+  void writePrometheus(string* out) const;
+  // Append a single value in the text format of Prometheus (type is
+  // "counter" or "gauge").
+  static void appendMetric(string const& name, string const& type,
+      string const& help, double value, string* out);
+
+  // Records the time from its construction to its destruction (or to
+  // stop) in a histogram. Does nothing without metrics.
+  class Timer;
+
+ private:
+  // The bucket of a value and the largest value in a bucket (the buckets
+  // end at powers of two, like the buckets of Prometheus).
+  FRIEND_TEST(Metrics, buckets);
+  static size_t bucket(uint64_t value);
+  static uint64_t upperBound(size_t bucket);
+  // Values up to 2^40 (18 minutes in nanoseconds), larger ones are in the
+  // last bucket (with UINT64_MAX as upper bound).
+  static const size_t numberOfBuckets = 18 + 36 * 16;
+
+  struct Shard {
+    Shard();
+    std::atomic<uint64_t> counters[numberOfCounters];
+    std::atomic<uint64_t> sums[numberOfHistograms];
+    std::atomic<uint64_t> buckets[numberOfHistograms][numberOfBuckets];
+  };
+  // The shard of the calling thread (created on its first call).
+  Shard* shard();
+  // The counts of the buckets of a histogram, summed over all shards.
+  void buckets(Histogram histogram, vector<uint64_t>* counts) const;
+
+  // Distinguishes the shards of different Metrics in a thread.
+  uint64_t _id;
+  mutable std::mutex _mutex;
+  vector<std::unique_ptr<Shard> > _shards;
+};
+
+class Metrics::Timer {
+ public:
+  Timer(Metrics* metrics, Histogram histogram)
+    : _metrics(metrics), _histogram(histogram) {
+    if (_metrics) _start = std::chrono::steady_clock::now();
+  }
+  ~Timer() { stop(); }
+  // Record the time so far (only once).
+  void stop() {
+    if (!_metrics) return;
+    _metrics->record(_histogram, std::chrono::duration_cast<
+        std::chrono::nanoseconds>(std::chrono::steady_clock::now()
+          - _start).count());
+    _metrics = NULL;
+  }
+
+ private:
+  Metrics* _metrics;
+  Histogram _histogram;
+  std::chrono::steady_clock::time_point _start;
+};
+
+#endif  // METRICS_H_
@@ -0,0 +1,147 @@
+// Copyright 2012, Milan Oberkirch
+// Author: Milan Oberkirch <oberkirm@informatik.uni-freiburg.de>
+
+#include <gtest/gtest.h>
+#include <stdint.h>
+#include <string>
+#include <thread>
+#include <vector>
+#include "./Metrics.h"
+
+using std::string;
+using std::vector;
+
+// ___________________________________________________________________________
+TEST(Metrics, buckets) {
+  // Small values have buckets of their own.
+  for (uint64_t i = 0; i <= 16; ++i) {
+    EXPECT_EQ(i, Metrics::bucket(i));
+    EXPECT_EQ(i, Metrics::upperBound(i));
+  }
+  // Larger ones share them, 16 buckets for each power of two.
+  EXPECT_EQ(17, Metrics::bucket(17));
+  EXPECT_EQ(32, Metrics::bucket(32));
+  EXPECT_EQ(33, Metrics::bucket(33));
+  EXPECT_EQ(33, Metrics::bucket(34));
+  EXPECT_EQ(34, Metrics::bucket(35));
+  EXPECT_EQ(1024, Metrics::upperBound(Metrics::bucket(1000)));
+  // Powers of two end buckets.
+  EXPECT_EQ(1024, Metrics::upperBound(Metrics::bucket(1024)));
+  EXPECT_EQ(1088, Metrics::upperBound(Metrics::bucket(1025)));
+  // Each value is at most the upper bound of its bucket and more than that
+  // of the previous one.
+  for (uint64_t value = 1; value < UINT64_MAX / 3; value = value * 3 + 1) {
+    size_t bucket = Metrics::bucket(value);
+    ASSERT_LT(bucket, Metrics::numberOfBuckets);
+    EXPECT_GE(Metrics::upperBound(bucket), value);
+    EXPECT_LT(Metrics::upperBound(bucket - 1), value);
+  }
+  // The last power of two ends the last bucket but one, larger values are
+  // in the last one.
+  size_t last = Metrics::bucket(1ULL << 40);
+  EXPECT_EQ(Metrics::numberOfBuckets - 2, last);
+  EXPECT_EQ(1ULL << 40, Metrics::upperBound(last));
+  EXPECT_EQ(31ULL << 35, Metrics::upperBound(Metrics::bucket(31ULL << 35)));
+  EXPECT_EQ(last, Metrics::bucket((31ULL << 35) + 1));
+  EXPECT_EQ(Metrics::numberOfBuckets - 1, Metrics::bucket((1ULL << 40) + 1));
+  EXPECT_EQ(Metrics::numberOfBuckets - 1, Metrics::bucket(UINT64_MAX));
+  EXPECT_EQ(UINT64_MAX, Metrics::upperBound(Metrics::numberOfBuckets - 1));
+}
+
+// ___________________________________________________________________________
+TEST(Metrics, quantile) {
+  Metrics metrics;
+  EXPECT_EQ(0, metrics.quantile(Metrics::REQUEST, 0.5));
+  for (uint64_t i = 1; i <= 100; ++i) metrics.record(Metrics::REQUEST, i);
+  EXPECT_EQ(100, metrics.count(Metrics::REQUEST));
+  EXPECT_EQ(5050, metrics.sum(Metrics::REQUEST));
+  EXPECT_EQ(1, metrics.quantile(Metrics::REQUEST, 0));
+  // 50 is in the bucket (48, 50], 99 in (96, 100].
+  EXPECT_EQ(50, metrics.quantile(Metrics::REQUEST, 0.5));
+  EXPECT_EQ(100, metrics.quantile(Metrics::REQUEST, 0.99));
+  EXPECT_EQ(100, metrics.quantile(Metrics::REQUEST, 1));
+  // Other histograms are separate.
+  EXPECT_EQ(0, metrics.count(Metrics::PARSE));
+}
+
+// ___________________________________________________________________________
+TEST(Metrics, countersOfThreads) {
+  Metrics metrics;
+  Metrics other;
+  vector<std::thread> threads;
+  for (size_t i = 0; i < 4; ++i) {
+    threads.push_back(std::thread([&metrics, &other]() {
+      for (size_t j = 0; j < 1000; ++j) {
+        metrics.increment(Metrics::SEARCHES);
+        metrics.record(Metrics::LOOKUP, j);
+      }
+      other.increment(Metrics::SEARCHES, 2);
+    }));
+  }
+  for (size_t i = 0; i < threads.size(); ++i) threads[i].join();
+  EXPECT_EQ(4000, metrics.count(Metrics::SEARCHES));
+  EXPECT_EQ(4000, metrics.count(Metrics::LOOKUP));
+  EXPECT_EQ(4 * 999 * 1000 / 2, metrics.sum(Metrics::LOOKUP));
+  EXPECT_EQ(8, other.count(Metrics::SEARCHES));
+  EXPECT_EQ(0, metrics.count(Metrics::ERRORS));
+}
+
+// ___________________________________________________________________________
+TEST(Metrics, writePrometheus) {
+  Metrics metrics;
+  metrics.increment(Metrics::SEARCHES, 3);
+  metrics.record(Metrics::PARSE, 1500);
+  metrics.record(Metrics::FUZZY_MATCHES, 3);
+  string out;
+  metrics.writePrometheus(&out);
+  EXPECT_NE(string::npos, out.find("# TYPE searchserver_searches_total "
+        "counter\nsearchserver_searches_total 3\n"));
+  // The phases are one histogram with a label.
+  EXPECT_NE(string::npos,
+      out.find("# TYPE searchserver_phase_seconds histogram\n"));
+  EXPECT_EQ(out.find("# TYPE searchserver_phase_seconds"),
+      out.rfind("# TYPE searchserver_phase_seconds"));
+  EXPECT_NE(string::npos, out.find(
+        "searchserver_phase_seconds_bucket{phase=\"parse\",le=\"1.024e-06\"}"
+        " 0\nsearchserver_phase_seconds_bucket{phase=\"parse\","
+        "le=\"2.048e-06\"} 1\n"));
+  EXPECT_NE(string::npos, out.find(
+        "searchserver_phase_seconds_bucket{phase=\"parse\",le=\"+Inf\"} 1\n"
+        "searchserver_phase_seconds_sum{phase=\"parse\"} 1.5e-06\n"
+        "searchserver_phase_seconds_count{phase=\"parse\"} 1\n"));
+  EXPECT_NE(string::npos,
+      out.find("searchserver_phase_seconds_count{phase=\"lookup\"} 0\n"));
+  EXPECT_NE(string::npos, out.find(
+        "searchserver_fuzzy_matches_bucket{le=\"2\"} 0\n"
+        "searchserver_fuzzy_matches_bucket{le=\"4\"} 1\n"));
+  EXPECT_NE(string::npos, out.find("searchserver_fuzzy_matches_sum 3\n"));
+
+  // Buckets count the values up to their bound (le).
+  metrics.record(Metrics::RANK, 1024);
+  metrics.record(Metrics::RANK, 1025);
+  out.clear();
+  metrics.writePrometheus(&out);
+  EXPECT_NE(string::npos, out.find(
+        "searchserver_phase_seconds_bucket{phase=\"rank\",le=\"1.024e-06\"}"
+        " 1\nsearchserver_phase_seconds_bucket{phase=\"rank\","
+        "le=\"2.048e-06\"} 2\n"));
+
+  string metric;
+  Metrics::appendMetric("a", "gauge", "An a.", 0.25, &metric);
+  EXPECT_EQ("# HELP a An a.\n# TYPE a gauge\na 0.25\n", metric);
+}
+
+// ___________________________________________________________________________
+TEST(Metrics, Timer) {
+  Metrics metrics;
+  {
+    Metrics::Timer timer(&metrics, Metrics::RANK);
+    Metrics::Timer stopped(&metrics, Metrics::INTERSECT);
+    stopped.stop();
+    stopped.stop();
+    // Without metrics nothing is recorded.
+    Metrics::Timer none(NULL, Metrics::RANK);
+  }
+  EXPECT_EQ(1, metrics.count(Metrics::RANK));
+  EXPECT_EQ(1, metrics.count(Metrics::INTERSECT));
+}
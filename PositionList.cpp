@@ -0,0 +1,122 @@
+// Copyright 2012, Milan Oberkirch
+// Author: Milan Oberkirch <oberkirm@informatik.uni-freiburg.de>
+
+#include "./PositionList.h"
+#include <stdint.h>
+#include <cstring>
+#include <vector>
+#include "./FlatVector.h"
+#include "./PostingList.h"
+
+using std::vector;
+
+// ___________________________________________________________________________
+PositionList::PositionList(uint8_t const* data) {
+  uint32_t size;
+  memcpy(&size, data, sizeof(size));
+  _size = size;
+  _blockOffsets = reinterpret_cast<uint32_t const*>(data + sizeof(size));
+  _blocks = data + sizeof(size)
+    + (numberOfBlocks() > 1 ? numberOfBlocks() * sizeof(uint32_t) : 0);
+}
+
+// ___________________________________________________________________________
+size_t PositionList::numberOfBlocks() const {
+  return (_size + PostingList::blockSize - 1) / PostingList::blockSize;
+}
+
+// ___________________________________________________________________________
+size_t PositionList::encode(vector<uint32_t> const& positions,
+    FlatVector<uint8_t>* data) {
+  // Align the header and block offsets.
+  while (data->size() % sizeof(uint32_t)) data->push_back(0);
+  size_t offset = data->size();
+
+  uint32_t size = 0;
+  for (size_t i = 0; i < positions.size(); i += positions[i] + 1) ++size;
+  uint8_t const* header = reinterpret_cast<uint8_t const*>(&size);
+  data->append(header, header + sizeof(size));
+  size_t numberOfBlocks =
+    (size + PostingList::blockSize - 1) / PostingList::blockSize;
+  size_t blockOffsetsOffset = data->size();
+  if (numberOfBlocks > 1)
+    data->resize(blockOffsetsOffset + numberOfBlocks * sizeof(uint32_t));
+  size_t blocksOffset = data->size();
+
+  size_t posting = 0;
+  for (size_t i = 0; i < positions.size(); i += positions[i] + 1) {
+    if (numberOfBlocks > 1 && posting % PostingList::blockSize == 0) {
+      uint32_t blockOffset = data->size() - blocksOffset;
+      memcpy(&(*data)[blockOffsetsOffset + posting / PostingList::blockSize
+          * sizeof(uint32_t)], &blockOffset, sizeof(blockOffset));
+    }
+    PostingList::appendVariableByte(positions[i], data);
+    uint32_t previousPosition = 0;
+    for (size_t j = i + 1; j <= i + positions[i]; ++j) {
+      PostingList::appendVariableByte(positions[j] - previousPosition, data);
+      previousPosition = positions[j];
+    }
+    ++posting;
+  }
+  return offset;
+}
+
+// ___________________________________________________________________________
+void PositionList::positions(size_t index, vector<uint32_t>* result) const {
+  result->clear();
+  if (index >= _size) return;
+  size_t first = index - index % PostingList::blockSize;
+  uint8_t const* data = block(first);
+  for (size_t i = first; i < index; ++i) data = skipPosting(data);
+  readPosting(data, result);
+}
+
+// ___________________________________________________________________________
+uint8_t const* PositionList::block(size_t index) const {
+  size_t block = index / PostingList::blockSize;
+  return _blocks + (block ? _blockOffsets[block] : 0);
+}
+
+// ___________________________________________________________________________
+uint8_t const* PositionList::skipPosting(uint8_t const* data) {
+  uint32_t count;
+  data = PostingList::readVariableByte(data, &count);
+  // The last byte of each variable-byte value has the high bit unset.
+  for (; count > 0; --count) {
+    while (*data & 0x80) ++data;
+    ++data;
+  }
+  return data;
+}
+
+// ___________________________________________________________________________
+uint8_t const* PositionList::readPosting(uint8_t const* data,
+    vector<uint32_t>* result) {
+  uint32_t count;
+  data = PostingList::readVariableByte(data, &count);
+  result->resize(count);
+  uint32_t position = 0;
+  for (size_t i = 0; i < count; ++i) {
+    uint32_t gap;
+    data = PostingList::readVariableByte(data, &gap);
+    position += gap;
+    (*result)[i] = position;
+  }
+  return data;
+}
+
+// ___________________________________________________________________________
+void PositionList::Cursor::positions(size_t index,
+    vector<uint32_t>* result) {
+  result->clear();
+  if (index >= _list._size) return;
+  // Jump to the block of index, unless the cursor is in front of index in
+  // it already.
+  size_t first = index - index % PostingList::blockSize;
+  if (_data == NULL || _index < first) {
+    _index = first;
+    _data = _list.block(first);
+  }
+  for (; _index < index; ++_index) _data = skipPosting(_data);
+  readPosting(_data, result);
+}
@@ -0,0 +1,81 @@
+// Copyright 2012, Milan Oberkirch
+// Author: Milan Oberkirch <oberkirm@informatik.uni-freiburg.de>
+
+#ifndef POSITIONLIST_H_
+#define POSITIONLIST_H_
+
+#include <gtest/gtest.h>
+#include <stdint.h>
+#include <vector>
+#include "./FlatVector.h"
+
+using std::vector;
+
+// Read-only view on the compressed positions of the occurrences of a word,
+// for the postings of its inverted list (see PostingList) in the same order.
+// The positions are stored apart from the inverted lists, so queries not
+// using them never touch them. They are split into the blocks of the
+// inverted list, so the positions of one posting are found by skipping the
+// postings in front of it in its block only. Layout:
+//   uint32 size, uint32 blockOffsets[numberOfBlocks] (if numberOfBlocks > 1),
+//   for each posting: varbyte number of positions, then the varbyte gaps of
+//   the positions.
+class PositionList {
+ public:
+  // The empty list.
+  PositionList() : _size(0), _blockOffsets(NULL), _blocks(NULL) {}
+  // The list compressed at data (by encode).
+  explicit PositionList(uint8_t const* data);
+
+  // The number of postings.
+  size_t size() const { return _size; }
+  bool empty() const { return _size == 0; }
+
+  // Append the compressed form of positions to data. positions holds for
+  // each posting the number of its positions followed by the (increasing)
+  // positions. Returns the offset of the list in data (which is aligned for
+  // the header).
+  static size_t encode(vector<uint32_t> const& positions,
+      FlatVector<uint8_t>* data);
+  // The positions of the posting with the given index into result.
+  void positions(size_t index, vector<uint32_t>* result) const;
+
+  // Reads the positions of postings in increasing order (defined below).
+  class Cursor;
+
+ private:
+  size_t numberOfBlocks() const;
+  // The positions of the postings of the block starting at the posting
+  // with the given index.
+  uint8_t const* block(size_t index) const;
+  // Skip the positions of one posting at data.
+  static uint8_t const* skipPosting(uint8_t const* data);
+  // Decode the positions of one posting at data into result.
+  static uint8_t const* readPosting(uint8_t const* data,
+      vector<uint32_t>* result);
+
+  size_t _size;
+  uint32_t const* _blockOffsets;
+  uint8_t const* _blocks;
+};
+
+// Reads the positions of postings of a list in increasing order of their
+// indexes (like the documents of a PostingList::Cursor), so postings in
+// front of them are only skipped once.
+class PositionList::Cursor {
+ public:
+  explicit Cursor(PositionList const& list)
+    : _list(list), _index(0), _data(NULL) {}
+  // The positions of the posting with the given index (which must not be
+  // smaller than the index of the previous call) into result.
+  void positions(size_t index, vector<uint32_t>* result);
+
+ private:
+  PositionList _list;
+  // The posting of the previous call and its positions (NULL before the
+  // first call).
+  size_t _index;
+  uint8_t const* _data;
+};
+
+#endif  // POSITIONLIST_H_
@@ -0,0 +1,78 @@
+// Copyright 2012, Milan Oberkirch
+// Author: Milan Oberkirch <oberkirm@informatik.uni-freiburg.de>
+
+#include <gtest/gtest.h>
+#include <stdint.h>
+#include <vector>
+#include "./FlatVector.h"
+#include "./PositionList.h"
+#include "./PostingList.h"
+
+using std::vector;
+
+// ___________________________________________________________________________
+TEST(PositionList, encodeAndPositions) {
+  FlatVector<uint8_t> data;
+  // Two lists in one buffer, the second one with several blocks.
+  vector<uint32_t> positions1 = {2, 3, 7, 1, 0};
+  vector<vector<uint32_t> > expected;
+  vector<uint32_t> positions2;
+  for (size_t i = 0; i < 3 * PostingList::blockSize + 5; ++i) {
+    vector<uint32_t> posting;
+    for (size_t j = 0; j < 1 + i % 4; ++j)
+      posting.push_back(i % 7 + j * (200 + i));
+    expected.push_back(posting);
+    positions2.push_back(posting.size());
+    positions2.insert(positions2.end(), posting.begin(), posting.end());
+  }
+  data.push_back(42);
+  size_t offset1 = PositionList::encode(positions1, &data);
+  size_t offset2 = PositionList::encode(positions2, &data);
+  EXPECT_EQ(0, offset1 % sizeof(uint32_t));
+  EXPECT_EQ(0, offset2 % sizeof(uint32_t));
+
+  vector<uint32_t> result;
+  PositionList list1(data.data() + offset1);
+  ASSERT_EQ(2, list1.size());
+  list1.positions(0, &result);
+  EXPECT_EQ(vector<uint32_t>({3, 7}), result);
+  list1.positions(1, &result);
+  EXPECT_EQ(vector<uint32_t>({0}), result);
+  list1.positions(2, &result);
+  EXPECT_TRUE(result.empty());
+
+  PositionList list2(data.data() + offset2);
+  ASSERT_EQ(expected.size(), list2.size());
+  for (size_t i = 0; i < expected.size(); ++i) {
+    list2.positions(i, &result);
+    EXPECT_EQ(expected[i], result);
+  }
+
+  PositionList empty;
+  EXPECT_TRUE(empty.empty());
+  empty.positions(0, &result);
+  EXPECT_TRUE(result.empty());
+}
+
+// ___________________________________________________________________________
+TEST(PositionList, Cursor) {
+  FlatVector<uint8_t> data;
+  vector<uint32_t> positions;
+  for (uint32_t i = 0; i < 5 * PostingList::blockSize; ++i) {
+    positions.push_back(2);
+    positions.push_back(i);
+    positions.push_back(2 * i + 1);
+  }
+  size_t offset = PositionList::encode(positions, &data);
+  PositionList::Cursor cursor(PositionList(data.data() + offset));
+  vector<uint32_t> result;
+  // Within a block, to the next posting, to later blocks and behind the end.
+  size_t indexes[] = {3, 4, 100, 130, 500, 639};
+  for (size_t i = 0; i < 6; ++i) {
+    uint32_t index = indexes[i];
+    cursor.positions(index, &result);
+    EXPECT_EQ(vector<uint32_t>({index, 2 * index + 1}), result);
+  }
+  cursor.positions(640, &result);
+  EXPECT_TRUE(result.empty());
+}
@@ -0,0 +1,255 @@
+// Copyright 2012, Milan Oberkirch
+// Author: Milan Oberkirch <oberkirm@informatik.uni-freiburg.de>
+
+#include "./PostingList.h"
+#include <stdint.h>
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstring>
+#include <vector>
+#include "./Bm25.h"
+#include "./FlatVector.h"
+#include "./Posting.h"
+
+using std::vector;
+
+const size_t PostingList::blockSize;
+
+// ___________________________________________________________________________
+PostingList::PostingList()
+  : _size(0), _valueScale(0), _scoreScale(0), _maxValue(0),
+    _minDocumentLength(0), _maxScore(0), _hasPrecomputedScores(false),
+    _skipTable(NULL), _blocks(NULL), _useBm25(false),
+    _usePrecomputedScores(false) {
+}
+
+// ___________________________________________________________________________
+PostingList::PostingList(uint8_t const* data, Scoring scoring)
+  : _useBm25(false) {
+  Header header;
+  memcpy(&header, data, sizeof(header));
+  _size = header.size;
+  _hasPrecomputedScores = header.hasPrecomputedScores;
+  // With precomputed scores, the values are term frequencies.
+  _valueScale = _hasPrecomputedScores ? 1 : header.scoreScale;
+  _scoreScale = header.scoreScale;
+  _maxValue = header.maxValue;
+  _minDocumentLength = header.minDocumentLength;
+  _maxScore = header.maxScore;
+  _skipTable = reinterpret_cast<SkipEntry const*>(data + sizeof(header));
+  _blocks = data + sizeof(header) + skipTableSize() * sizeof(SkipEntry);
+  assert(scoring == VALUES || _hasPrecomputedScores);
+  _usePrecomputedScores = scoring == PRECOMPUTED_SCORES;
+}
+
+// ___________________________________________________________________________
+PostingList::PostingList(uint8_t const* data, Bm25 const& bm25)
+  : PostingList(data) {
+  _useBm25 = true;
+  _bm25 = bm25;
+}
+
+// The score relative to scale as a byte (term frequencies with scale 1).
+static uint8_t quantize(float score, float scale) {
+  long value = scale > 0 ? lround(score / scale) : 0;  // NOLINT
+  return std::max(0L, std::min(255L, value));
+}
+
+// ___________________________________________________________________________
+size_t PostingList::encode(vector<Posting> const& postings,
+    FlatVector<uint8_t>* data, uint8_t const* documentLengths,
+    Bm25 const* bm25) {
+  // Align the header and skip table.
+  while (data->size() % sizeof(uint32_t)) data->push_back(0);
+  size_t offset = data->size();
+  if (!documentLengths) bm25 = NULL;
+
+  // Scores are quantized relative to the largest score of the list, term
+  // frequencies are stored as they are.
+  vector<float> scores(postings.size());
+  float maxScore = 0;
+  for (size_t i = 0; i < postings.size(); ++i) {
+    scores[i] = bm25 ? bm25->score(quantize(postings[i].score, 1),
+        documentLengths[postings[i].documentId]) : postings[i].score;
+    maxScore = std::max(maxScore, scores[i]);
+  }
+  Header header;
+  memset(&header, 0, sizeof(header));
+  header.size = postings.size();
+  header.scoreScale = documentLengths && !bm25 ? 1 : maxScore / 255;
+  header.minDocumentLength = documentLengths ? UINT8_MAX : 0;
+  header.hasPrecomputedScores = bm25 != NULL;
+  size_t headerOffset = data->size();
+  data->resize(headerOffset + sizeof(header));
+
+  size_t numberOfBlocks = (postings.size() + blockSize - 1) / blockSize;
+  bool hasSkipTable = numberOfBlocks > 1;
+  size_t skipTableOffset = data->size();
+  if (hasSkipTable)
+    data->resize(skipTableOffset + numberOfBlocks * sizeof(SkipEntry));
+  size_t blocksOffset = data->size();
+
+  uint32_t previousDocumentId = 0;
+  for (size_t block = 0; block < numberOfBlocks; ++block) {
+    size_t begin = block * blockSize;
+    size_t end = std::min(begin + blockSize, postings.size());
+    SkipEntry entry;
+    memset(&entry, 0, sizeof(entry));
+    entry.offset = data->size() - blocksOffset;
+    entry.minDocumentLength = documentLengths ? UINT8_MAX : 0;
+    for (size_t i = begin; i < end; ++i) {
+      appendVariableByte(postings[i].documentId - previousDocumentId, data);
+      previousDocumentId = postings[i].documentId;
+    }
+    for (size_t i = begin; i < end; ++i) {
+      data->push_back(documentLengths
+          ? quantize(postings[i].score, 1)
+          : quantize(scores[i], header.scoreScale));
+      entry.maxValue = std::max(entry.maxValue, data->back());
+      if (documentLengths) {
+        entry.minDocumentLength = std::min(entry.minDocumentLength,
+            documentLengths[postings[i].documentId]);
+      }
+    }
+    for (size_t i = begin; bm25 && i < end; ++i) {
+      data->push_back(quantize(scores[i], header.scoreScale));
+      entry.maxScore = std::max(entry.maxScore, data->back());
+    }
+    entry.lastDocumentId = previousDocumentId;
+    if (hasSkipTable)
+      memcpy(&(*data)[skipTableOffset + block * sizeof(SkipEntry)], &entry,
+          sizeof(entry));
+    header.maxValue = std::max(header.maxValue, entry.maxValue);
+    header.minDocumentLength =
+      std::min(header.minDocumentLength, entry.minDocumentLength);
+    header.maxScore = std::max(header.maxScore, entry.maxScore);
+  }
+  memcpy(&(*data)[headerOffset], &header, sizeof(header));
+  return offset;
+}
+
+// ___________________________________________________________________________
+vector<Posting> PostingList::decode() const {
+  vector<Posting> postings;
+  postings.reserve(_size);
+  for (Cursor cursor(*this); !cursor.atEnd(); cursor.next())
+    postings.push_back(Posting(cursor.documentId(), cursor.score()));
+  return postings;
+}
+
+// ___________________________________________________________________________
+void PostingList::appendVariableByte(uint32_t value,
+    FlatVector<uint8_t>* data) {
+  while (value >= 0x80) {
+    data->push_back((value & 0x7F) | 0x80);
+    value >>= 7;
+  }
+  data->push_back(value);
+}
+
+// ___________________________________________________________________________
+uint8_t const* PostingList::readVariableByte(uint8_t const* data,
+    uint32_t* value) {
+  uint32_t result = *data & 0x7F;
+  for (int shift = 7; *data++ & 0x80; shift += 7)
+    result |= static_cast<uint32_t>(*data & 0x7F) << shift;
+  *value = result;
+  return data;
+}
+
+// ___________________________________________________________________________
+PostingList::Cursor::Cursor(PostingList const& list)
+  : _list(list), _block(0), _decodedBlock(0), _blockLength(0),
+    _position(0) {
+  decodeBlock(0);
+}
+
+// ___________________________________________________________________________
+void PostingList::Cursor::decodeBlock(size_t block) {
+  _block = block;
+  _decodedBlock = block;
+  _position = 0;
+  if (atEnd()) return;
+  _blockLength = std::min(blockSize, _list._size - block * blockSize);
+  uint8_t const* data =
+    _list._blocks + (block ? _list.skipEntry(block).offset : 0);
+  uint32_t documentId =
+    block ? _list.skipEntry(block - 1).lastDocumentId : 0;
+  for (size_t i = 0; i < _blockLength; ++i) {
+    uint32_t gap;
+    data = readVariableByte(data, &gap);
+    documentId += gap;
+    _documentIds[i] = documentId;
+  }
+  _list.scores(_documentIds, data, _blockLength, _scores);
+}
+
+// ___________________________________________________________________________
+void PostingList::scores(uint32_t const* documentIds, uint8_t const* values,
+    size_t n, float* scores) const {
+  if (_useBm25) {
+    _bm25.scores(documentIds, values, n, scores);
+  } else if (_usePrecomputedScores) {
+    // They follow the values.
+    for (size_t i = 0; i < n; ++i) scores[i] = values[n + i] * _scoreScale;
+  } else {
+    for (size_t i = 0; i < n; ++i) scores[i] = values[i] * _valueScale;
+  }
+}
+
+// ___________________________________________________________________________
+void PostingList::Cursor::next() {
+  if (++_position == _blockLength) decodeBlock(_block + 1);
+}
+
+// Order skip entries by their last document id.
+static bool lastDocumentIdLess(PostingList::SkipEntry const& entry,
+    size_t documentId) {
+  return entry.lastDocumentId < documentId;
+}
+
+// ___________________________________________________________________________
+void PostingList::Cursor::shallowSkipTo(size_t documentId) {
+  if (atEnd() || _list.numberOfBlocks() == 1) return;
+  if (_list.skipEntry(_block).lastDocumentId >= documentId) return;
+  SkipEntry const* end = _list._skipTable + _list.numberOfBlocks();
+  _block = std::lower_bound(_list._skipTable + _block + 1, end, documentId,
+      lastDocumentIdLess) - _list._skipTable;
+}
+
+// ___________________________________________________________________________
+size_t PostingList::Cursor::blockLastDocumentId() const {
+  if (_list.numberOfBlocks() == 1) return UINT32_MAX;
+  return _list.skipEntry(_block).lastDocumentId;
+}
+
+// ___________________________________________________________________________
+float PostingList::Cursor::blockMaxScore() const {
+  if (_list.numberOfBlocks() == 1) return _list.maxScore();
+  SkipEntry const& entry = _list.skipEntry(_block);
+  return _list.bound(entry.maxValue, entry.minDocumentLength,
+      entry.maxScore);
+}
+
+// ___________________________________________________________________________
+void PostingList::Cursor::skipTo(size_t documentId) {
+  shallowSkipTo(documentId);
+  if (atEnd()) return;
+  if (_block != _decodedBlock) decodeBlock(_block);
+  if (_documentIds[_position] < documentId) {
+    // Double the step until the document id at _position + step is not
+    // smaller than documentId, then search between the last two steps.
+    size_t step = 1;
+    while (_position + step < _blockLength
+        && _documentIds[_position + step] < documentId) {
+      _position += step;
+      step *= 2;
+    }
+    _position = std::lower_bound(_documentIds + _position + 1,
+        _documentIds + std::min(_position + step, _blockLength), documentId)
+      - _documentIds;
+  }
+  // Only lists without skip table end before documentId here.
+  if (_position == _blockLength) decodeBlock(_block + 1);
+}
@@ -0,0 +1,192 @@
+// Copyright 2012, Milan Oberkirch
+// Author: Milan Oberkirch <oberkirm@informatik.uni-freiburg.de>
+
+#ifndef POSTINGLIST_H_
+#define POSTINGLIST_H_
+
+#include <gtest/gtest.h>
+#include <stdint.h>
+#include <vector>
+#include "./Bm25.h"
+#include "./FlatVector.h"
+#include "./Posting.h"
+
+using std::vector;
+
+// Read-only view on a compressed inverted list. The postings are split into
+// blocks of blockSize postings. In each block the document ids are stored as
+// variable-byte encoded gaps, followed by one byte per posting: either its
+// score quantized relative to the largest score of the list, or its term
+// frequency (at most 255), from which the scores are computed at query time
+// (see Bm25). Lists of term frequencies may also have precomputed BM25
+// scores, one more quantized byte per posting. A skip table with the last
+// document id and bounds for the scores of each block allows to jump over
+// whole blocks without decoding them (lists with only one block, like those
+// of most words, have no skip table). Layout:
+//   Header, SkipEntry[numberOfBlocks] (if numberOfBlocks > 1),
+//   blocks (each: size varbyte gaps, then size uint8 values, then size
+//   uint8 precomputed scores if the list has them).
+class PostingList {
+ public:
+  static const size_t blockSize = 128;
+
+  // Entry of the skip table.
+  struct SkipEntry {
+    // Largest document id in the block.
+    uint32_t lastDocumentId;
+    // Offset of the block behind the skip table.
+    uint32_t offset;
+    // Largest value (quantized score or term frequency) in the block.
+    uint8_t maxValue;
+    // Smallest quantized length (see Bm25) of the documents in the block
+    // (only for term frequencies).
+    uint8_t minDocumentLength;
+    // Largest precomputed score in the block (if the list has them).
+    uint8_t maxScore;
+  };
+
+  // Which scores a list without Bm25 has.
+  enum Scoring {
+    // The values: quantized scores or term frequencies.
+    VALUES,
+    // The precomputed scores (the list must have them).
+    PRECOMPUTED_SCORES
+  };
+
+  // The empty list.
+  PostingList();
+  // The list compressed at data (by encode).
+  explicit PostingList(uint8_t const* data, Scoring scoring = VALUES);
+  // The list of term frequencies compressed at data (by encode with
+  // documentLengths), scored by bm25.
+  PostingList(uint8_t const* data, Bm25 const& bm25);
+
+  size_t size() const { return _size; }
+  bool empty() const { return _size == 0; }
+  size_t numberOfBlocks() const { return (_size + blockSize - 1) / blockSize; }
+  bool hasPrecomputedScores() const { return _hasPrecomputedScores; }
+  // Upper bound for the scores in the list (the largest score up to
+  // quantization).
+  float maxScore() const {
+    return empty() ? 0 : bound(_maxValue, _minDocumentLength, _maxScore);
+  }
+
+  // Append the compressed form of postings (sorted by document id) to data.
+  // With documentLengths (the quantized lengths of the documents the ids
+  // refer to), the scores of the postings are term frequencies, which are
+  // stored as they are (larger ones as 255). With bm25 as well, their BM25
+  // scores are precomputed and stored quantized, too. Without
+  // documentLengths, the scores are quantized. Returns the offset of the
+  // list in data (which is aligned for the header and skip table).
+  static size_t encode(vector<Posting> const& postings,
+      FlatVector<uint8_t>* data, uint8_t const* documentLengths = NULL,
+      Bm25 const* bm25 = NULL);
+  // All postings of the list (with their term frequencies as score, if the
+  // list has them and is not scored by a Bm25).
+  vector<Posting> decode() const;
+
+  // Iterates over the postings of a list (defined below).
+  class Cursor;
+
+  // Variable-byte encoding (7 bits per byte, high bit set on all but the
+  // last byte), also used for the positions (see PositionList).
+  FRIEND_TEST(PostingList, variableByte);
+  static void appendVariableByte(uint32_t value, FlatVector<uint8_t>* data);
+  static uint8_t const* readVariableByte(uint8_t const* data, uint32_t* value);
+
+ private:
+  // The beginning of each list.
+  struct Header {
+    uint32_t size;
+    // The factor of the quantized scores (the values or the precomputed
+    // scores).
+    float scoreScale;
+    // The bounds of the whole list (like in SkipEntry).
+    uint8_t maxValue;
+    uint8_t minDocumentLength;
+    uint8_t maxScore;
+    uint8_t hasPrecomputedScores;
+  };
+
+  SkipEntry const& skipEntry(size_t block) const { return _skipTable[block]; }
+  size_t skipTableSize() const {
+    return numberOfBlocks() > 1 ? numberOfBlocks() : 0;
+  }
+  // Upper bound for the scores of postings with values up to maxValue (and
+  // precomputed scores up to maxScore) in documents with a quantized length
+  // of at least minDocumentLength.
+  float bound(uint8_t maxValue, uint8_t minDocumentLength,
+      uint8_t maxScore) const {
+    if (_useBm25) return _bm25.score(maxValue, minDocumentLength);
+    if (_usePrecomputedScores) return maxScore * _scoreScale;
+    return maxValue * _valueScale;
+  }
+  // The scores of the n values of the postings with the given document ids.
+  void scores(uint32_t const* documentIds, uint8_t const* values, size_t n,
+      float* scores) const;
+
+  size_t _size;
+  // The factors of the values and of the precomputed scores.
+  float _valueScale;
+  float _scoreScale;
+  uint8_t _maxValue;
+  uint8_t _minDocumentLength;
+  uint8_t _maxScore;
+  bool _hasPrecomputedScores;
+  SkipEntry const* _skipTable;
+  uint8_t const* _blocks;
+  // Whether the values are term frequencies scored by _bm25, or the
+  // precomputed scores are used.
+  bool _useBm25;
+  bool _usePrecomputedScores;
+  Bm25 _bm25;
+};
+
+// Iterates over the postings of a list in order of document ids. Blocks
+// are decoded as a whole when the cursor enters them. For dynamic pruning the
+// cursor can also be moved to a block without decoding it (shallowSkipTo)
+// to look at the bounds of the block first.
+class PostingList::Cursor {
+ public:
+  explicit Cursor(PostingList const& list);
+  bool atEnd() const { return _block >= _list.numberOfBlocks(); }
+  size_t documentId() const { return _documentIds[_position]; }
+  float score() const { return _scores[_position]; }
+  void next();
+  // Advance to the first posting with a document id >= documentId.
+  // Blocks ending before documentId are skipped without decoding them.
+  void skipTo(size_t documentId);
+
+  // Move to the block which may contain documentId (the first block not
+  // ending before it) without decoding it. documentId() and score() are
+  // only valid again after the next call of skipTo.
+  void shallowSkipTo(size_t documentId);
+  // Largest document id of the current block (of all document ids, if the
+  // list has no skip table).
+  size_t blockLastDocumentId() const;
+  // Upper bound for the scores in the current block.
+  float blockMaxScore() const;
+
+  // The decoded current block, for processing it as a whole. Valid like
+  // documentId().
+  uint32_t const* blockDocumentIds() const { return _documentIds; }
+  size_t blockLength() const { return _blockLength; }
+  size_t position() const { return _position; }
+  // The number of postings in front of the current one in the list.
+  size_t index() const { return _block * blockSize + _position; }
+  float score(size_t position) const { return _scores[position]; }
+
+ private:
+  void decodeBlock(size_t block);
+
+  PostingList _list;
+  size_t _block;
+  // The block in _documentIds and _scores.
+  size_t _decodedBlock;
+  size_t _blockLength;
+  size_t _position;
+  uint32_t _documentIds[blockSize];
+  float _scores[blockSize];
+};
+
+#endif  // POSTINGLIST_H_
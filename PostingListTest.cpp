@@ -0,0 +1,178 @@
+// Copyright 2012, Milan Oberkirch
+// Author: Milan Oberkirch <oberkirm@informatik.uni-freiburg.de>
+
+#include <gtest/gtest.h>
+#include <stdint.h>
+#include <algorithm>
+#include <vector>
+#include "./Bm25.h"
+#include "./FlatVector.h"
+#include "./Posting.h"
+#include "./PostingList.h"
+
+using std::vector;
+
+// A list spanning several blocks with document ids 0, 7, 14, ...
+vector<Posting> createPostings(size_t size) {
+  vector<Posting> postings;
+  for (size_t i = 0; i < size; ++i)
+    postings.push_back(Posting(7 * i, (i % 10) / 4.0));
+  return postings;
+}
+
+// ___________________________________________________________________________
+TEST(PostingList, encodeAndDecode) {
+  vector<Posting> postings = createPostings(300);
+  FlatVector<uint8_t> data;
+  data.push_back(42);
+  size_t offset = PostingList::encode(postings, &data);
+  EXPECT_EQ(0, offset % 4);
+  PostingList list(data.data() + offset);
+  ASSERT_EQ(300, list.size());
+  EXPECT_EQ(3, list.numberOfBlocks());
+  // Much smaller than 16 bytes per posting.
+  EXPECT_GT(300 * sizeof(Posting) / 4, data.size());
+
+  vector<Posting> decoded = list.decode();
+  ASSERT_EQ(postings.size(), decoded.size());
+  for (size_t i = 0; i < postings.size(); ++i) {
+    EXPECT_EQ(postings[i].documentId, decoded[i].documentId);
+    // Scores are quantized to 1/255 of the largest score.
+    EXPECT_NEAR(postings[i].score, decoded[i].score, 2.25 / 255 / 2);
+  }
+
+  EXPECT_TRUE(PostingList().decode().empty());
+  EXPECT_TRUE(PostingList::Cursor(PostingList()).atEnd());
+}
+
+// ___________________________________________________________________________
+TEST(PostingList, skipTo) {
+  vector<Posting> postings = createPostings(1000);
+  FlatVector<uint8_t> data;
+  size_t offset = PostingList::encode(postings, &data);
+  PostingList list(data.data() + offset);
+  PostingList::Cursor cursor(list);
+  cursor.skipTo(0);
+  EXPECT_EQ(0, cursor.documentId());
+  cursor.skipTo(8);
+  EXPECT_EQ(14, cursor.documentId());
+  // Into a later block.
+  cursor.skipTo(7 * 600);
+  EXPECT_EQ(7 * 600, cursor.documentId());
+  cursor.next();
+  EXPECT_EQ(7 * 601, cursor.documentId());
+  // Backwards does not move.
+  cursor.skipTo(5);
+  EXPECT_EQ(7 * 601, cursor.documentId());
+  cursor.skipTo(7 * 999);
+  EXPECT_EQ(7 * 999, cursor.documentId());
+  cursor.skipTo(7 * 999 + 1);
+  EXPECT_TRUE(cursor.atEnd());
+}
+
+// ___________________________________________________________________________
+TEST(PostingList, variableByte) {
+  FlatVector<uint8_t> data;
+  uint32_t values[] = {0, 1, 127, 128, 16383, 16384, 4294967295u};
+  for (size_t i = 0; i < 7; ++i)
+    PostingList::appendVariableByte(values[i], &data);
+  EXPECT_EQ(1 + 1 + 1 + 2 + 2 + 3 + 5, data.size());
+  uint8_t const* position = data.data();
+  for (size_t i = 0; i < 7; ++i) {
+    uint32_t value;
+    position = PostingList::readVariableByte(position, &value);
+    EXPECT_EQ(values[i], value);
+  }
+  EXPECT_EQ(data.end(), position);
+}
+
+// ___________________________________________________________________________
+TEST(PostingList, blockBounds) {
+  vector<Posting> postings = createPostings(300);
+  postings[130].score = 5;
+  FlatVector<uint8_t> data;
+  size_t offset = PostingList::encode(postings, &data);
+  PostingList list(data.data() + offset);
+  EXPECT_NEAR(5, list.maxScore(), 1e-5);
+  PostingList::Cursor cursor(list);
+  EXPECT_EQ(7 * 127, cursor.blockLastDocumentId());
+  EXPECT_NEAR(2.25, cursor.blockMaxScore(), 5.0 / 255);
+  // Moves to the second block without decoding it.
+  cursor.shallowSkipTo(7 * 128);
+  EXPECT_EQ(7 * 255, cursor.blockLastDocumentId());
+  EXPECT_NEAR(5, cursor.blockMaxScore(), 1e-5);
+  cursor.shallowSkipTo(7 * 299 + 1);
+  EXPECT_TRUE(cursor.atEnd());
+
+  // A list with one block only has the bounds of the whole list.
+  offset = PostingList::encode(createPostings(10), &data);
+  PostingList::Cursor shortCursor(PostingList(data.data() + offset));
+  EXPECT_EQ(UINT32_MAX, shortCursor.blockLastDocumentId());
+  EXPECT_NEAR(2.25, shortCursor.blockMaxScore(), 1e-5);
+  shortCursor.skipTo(7 * 9 + 1);
+  EXPECT_TRUE(shortCursor.atEnd());
+}
+
+// ___________________________________________________________________________
+TEST(PostingList, termFrequencies) {
+  // Term frequencies 1, 2, ..., 300 in documents of (quantized) lengths 50,
+  // 51, ...
+  vector<Posting> postings;
+  vector<uint8_t> lengths;
+  for (size_t i = 0; i < 300; ++i) {
+    postings.push_back(Posting(i, i + 1));
+    lengths.push_back(50 + i % 100);
+  }
+  FlatVector<uint8_t> data;
+  size_t offset = PostingList::encode(postings, &data, lengths.data());
+
+  // Without scoring, the term frequencies are the scores (larger ones are
+  // stored as 255).
+  vector<Posting> decoded = PostingList(data.data() + offset).decode();
+  ASSERT_EQ(300, decoded.size());
+  EXPECT_EQ(1, decoded[0].score);
+  EXPECT_EQ(255, decoded[254].score);
+  EXPECT_EQ(255, decoded[299].score);
+
+  // Scored at query time, the bounds are not below the scores.
+  Bm25::Parameters parameters(1.75, 0.75, 100);
+  Bm25 bm25(parameters, 1000, 300, lengths.data());
+  PostingList list(data.data() + offset, bm25);
+  EXPECT_FALSE(list.hasPrecomputedScores());
+  EXPECT_FLOAT_EQ(bm25.score(255, 50), list.maxScore());
+  float maxScore = 0;
+  for (PostingList::Cursor cursor(list); !cursor.atEnd(); cursor.next()) {
+    size_t documentId = cursor.documentId();
+    EXPECT_FLOAT_EQ(bm25.score(std::min<size_t>(documentId + 1, 255),
+          lengths[documentId]), cursor.score());
+    EXPECT_LE(cursor.score(), cursor.blockMaxScore());
+    maxScore = std::max(maxScore, cursor.score());
+  }
+  EXPECT_LE(maxScore, list.maxScore());
+  // The bounds of the blocks use their shortest documents (at positions 0
+  // and 200) and their largest frequencies.
+  PostingList::Cursor cursor(list);
+  EXPECT_FLOAT_EQ(bm25.score(128, 50), cursor.blockMaxScore());
+  cursor.shallowSkipTo(128);
+  EXPECT_FLOAT_EQ(bm25.score(255, 50), cursor.blockMaxScore());
+
+  // With precomputed scores, the term frequencies are still there.
+  offset = PostingList::encode(postings, &data, lengths.data(), &bm25);
+  list = PostingList(data.data() + offset);
+  EXPECT_TRUE(list.hasPrecomputedScores());
+  EXPECT_EQ(255, list.decode()[299].score);
+  EXPECT_FLOAT_EQ(bm25.score(255, 50),
+      PostingList(data.data() + offset, bm25).maxScore());
+  list = PostingList(data.data() + offset, PostingList::PRECOMPUTED_SCORES);
+  maxScore = 0;
+  for (PostingList::Cursor cursor(list); !cursor.atEnd(); cursor.next()) {
+    size_t documentId = cursor.documentId();
+    EXPECT_NEAR(bm25.score(std::min<size_t>(documentId + 1, 255),
+          lengths[documentId]), cursor.score(), list.maxScore() / 255);
+    EXPECT_LE(cursor.score(), cursor.blockMaxScore());
+    maxScore = std::max(maxScore, cursor.score());
+  }
+  // The largest score, not a bound from the lengths.
+  EXPECT_FLOAT_EQ(maxScore, list.maxScore());
+  EXPECT_LT(list.maxScore(), bm25.score(255, 50));
+}
@@ -0,0 +1,139 @@
+// Copyright 2012, Milan Oberkirch
+// Author: Milan Oberkirch <oberkirm@informatik.uni-freiburg.de>
+
+#include "./PrefixCompletion.h"
+#include <stdint.h>
+#include <boost/utility/string_view.hpp>
+#include <algorithm>
+#include <string>
+#include <vector>
+#include "./FlatVector.h"
+#include "./IndexFile.h"
+#include "./SegmentedIndex.h"
+#include "./TermDictionary.h"
+
+// ___________________________________________________________________________
+void PrefixCompletion::init(SegmentedIndex const& index) {
+  _words = &index.words();
+  size_t n = _words->size();
+  _frequencies.clear();
+  for (size_t id = 0; id < n; ++id)
+    _frequencies.push_back(index.documentFrequency(id));
+  _tree.clear();
+  _tree.resize(n);
+  for (size_t i = n ? n - 1 : 0; i > 0; --i) {
+    size_t left = node(2 * i);
+    size_t right = node(2 * i + 1);
+    _tree[i] = before(right, left) ? right : left;
+  }
+}
+
+// ___________________________________________________________________________
+vector<string> PrefixCompletion::complete(string_view prefix,
+    size_t numberOfResults) const {
+  vector<string> results;
+  size_t begin;
+  size_t end;
+  prefixRange(prefix, &begin, &end);
+  if (begin == end) return results;
+
+  // The ranges not reported yet, as heap with the range with the most
+  // frequent word on top.
+  vector<Range> heap;
+  heap.push_back(range(begin, end));
+  while (!heap.empty() && results.size() < numberOfResults) {
+    std::pop_heap(heap.begin(), heap.end());
+    Range top = heap.back();
+    heap.pop_back();
+    results.push_back((*_words)[top.best]);
+    if (top.begin < top.best) {
+      heap.push_back(range(top.begin, top.best));
+      std::push_heap(heap.begin(), heap.end());
+    }
+    if (top.best + 1 < top.end) {
+      heap.push_back(range(top.best + 1, top.end));
+      std::push_heap(heap.begin(), heap.end());
+    }
+  }
+  return results;
+}
+
+// ___________________________________________________________________________
+void PrefixCompletion::writeToFile(IndexFileWriter* file) const {
+  file->write(_frequencies);
+  file->write(_tree);
+}
+
+// ___________________________________________________________________________
+void PrefixCompletion::readFromFile(SegmentedIndex const& index,
+    IndexFileReader* file) {
+  _words = &index.words();
+  file->read(&_frequencies);
+  file->read(&_tree);
+  if (_frequencies.size() != _words->size()
+      || _tree.size() != _words->size())
+    throw IndexFileError("Index file contains an inconsistent prefix tree.");
+  for (size_t i = 1; i < _tree.size(); ++i) {
+    if (_tree[i] >= _words->size())
+      throw IndexFileError("Index file contains an inconsistent prefix tree.");
+  }
+}
+
+// ___________________________________________________________________________
+void PrefixCompletion::prefixRange(string_view prefix, size_t* begin,
+    size_t* end) const {
+  *begin = _words->lowerBound(prefix);
+  // The smallest string larger than all strings starting with prefix: drop
+  // the trailing maximal chars and increment the last one.
+  string next = prefix.to_string();
+  while (!next.empty() && static_cast<unsigned char>(next.back()) == 0xFF)
+    next.erase(next.size() - 1);
+  if (next.empty()) {
+    *end = _words->size();
+  } else {
+    ++next[next.size() - 1];
+    *end = _words->lowerBound(next);
+  }
+}
+
+// ___________________________________________________________________________
+size_t PrefixCompletion::mostFrequent(size_t begin, size_t end) const {
+  size_t n = _words->size();
+  size_t best = begin;
+  // Walk up from both leaves, taking the nodes covering the range.
+  for (begin += n, end += n; begin < end; begin /= 2, end /= 2) {
+    if (begin & 1) {
+      size_t id = node(begin++);
+      if (before(id, best)) best = id;
+    }
+    if (end & 1) {
+      size_t id = node(--end);
+      if (before(id, best)) best = id;
+    }
+  }
+  return best;
+}
+
+// ___________________________________________________________________________
+PrefixCompletion::Range PrefixCompletion::range(size_t begin,
+    size_t end) const {
+  Range result;
+  result.best = mostFrequent(begin, end);
+  result.frequency = _frequencies[result.best];
+  result.begin = begin;
+  result.end = end;
+  return result;
+}
+
+// ___________________________________________________________________________
+bool PrefixCompletion::before(size_t id1, size_t id2) const {
+  if (_frequencies[id1] != _frequencies[id2])
+    return _frequencies[id1] > _frequencies[id2];
+  return id1 < id2;
+}
+
+// ___________________________________________________________________________
+size_t PrefixCompletion::node(size_t i) const {
+  size_t n = _words->size();
+  return i >= n ? i - n : _tree[i];
+}
@@ -0,0 +1,78 @@
+// Copyright 2012, Milan Oberkirch
+// Author: Milan Oberkirch <oberkirm@informatik.uni-freiburg.de>
+
+#ifndef PREFIXCOMPLETION_H_
+#define PREFIXCOMPLETION_H_
+
+#include <gtest/gtest.h>
+#include <stdint.h>
+#include <boost/utility/string_view.hpp>
+#include <string>
+#include <vector>
+#include "./FlatVector.h"
+#include "./IndexFile.h"
+#include "./SegmentedIndex.h"
+#include "./TermDictionary.h"
+
+using boost::string_view;
+using std::string;
+using std::vector;
+
+// Completion of prefixes to the words of the vocabulary with the most
+// documents. The words starting with a prefix are a range of ids in the
+// sorted vocabulary. A segment tree over the document frequencies gives the
+// most frequent word of any range in O(log n), so the top-k words of a range
+// are found in O(k log n) by repeatedly splitting the range at its most
+// frequent word.
+class PrefixCompletion {
+ public:
+  PrefixCompletion() : _words(NULL) {}
+
+  // Build for the vocabulary of the index.
+  void init(SegmentedIndex const& index);
+
+  // The (at most) numberOfResults words starting with prefix, the words
+  // contained in the most documents first.
+  vector<string> complete(string_view prefix, size_t numberOfResults) const;
+
+  // Append the frequencies and the tree to a binary index file.
+  void writeToFile(IndexFileWriter* file) const;
+  // Read them (instead of init) for the vocabulary of the index.
+  void readFromFile(SegmentedIndex const& index, IndexFileReader* file);
+
+ private:
+  // The range of ids of the words starting with prefix.
+  FRIEND_TEST(PrefixCompletion, prefixRange);
+  void prefixRange(string_view prefix, size_t* begin, size_t* end) const;
+  // The id of the most frequent word in [begin, end) (begin < end).
+  FRIEND_TEST(PrefixCompletion, mostFrequent);
+  size_t mostFrequent(size_t begin, size_t end) const;
+  // A range of ids with its most frequent word. The ranges with the words
+  // completed first are the largest.
+  struct Range {
+    uint32_t frequency;
+    size_t best;
+    size_t begin;
+    size_t end;
+    bool operator<(Range const& other) const {
+      if (frequency != other.frequency) return frequency < other.frequency;
+      return best > other.best;
+    }
+  };
+  Range range(size_t begin, size_t end) const;
+  // Whether word id1 comes before id2 in the completions (is more frequent,
+  // or as frequent and smaller).
+  bool before(size_t id1, size_t id2) const;
+  // The id of the most frequent word below node i of the tree.
+  size_t node(size_t i) const;
+
+  TermDictionary const* _words;
+  // Number of documents containing each word.
+  FlatVector<uint32_t> _frequencies;
+  // Segment tree: node i (0 < i < n) has the children 2i and 2i + 1, node
+  // n + id is the leaf of word id. Holds the most frequent word of each
+  // inner node.
+  FlatVector<uint32_t> _tree;
+};
+
+#endif  // PREFIXCOMPLETION_H_
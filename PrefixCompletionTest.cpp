@@ -0,0 +1,117 @@
+// Copyright 2012, Milan Oberkirch
+// Author: Milan Oberkirch <oberkirm@informatik.uni-freiburg.de>
+
+#include <gtest/gtest.h>
+#include <stdlib.h>
+#include <algorithm>
+#include <cstdio>
+#include <fstream>  // NOLINT
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+#include "./IndexFile.h"
+#include "./PrefixCompletion.h"
+#include "./SegmentedIndex.h"
+
+using std::string;
+using std::vector;
+
+const char mockupFileName[] = "PrefixCompletionMockup.test.tmp";
+const char indexFileName[] = "PrefixCompletion.index.test.tmp";
+SegmentedIndex ii;
+PrefixCompletion prefixCompletion;
+
+// ___________________________________________________________________________
+TEST(PrefixCompletion, createMockup) {
+  // Words over few letters (so they share prefixes) in a random number of
+  // records each.
+  srand(42);
+  std::ofstream mockup(mockupFileName);
+  for (int i = 0; i < 300; ++i) {
+    string word(4 + rand() % 4, 'a');  // NOLINT
+    for (size_t j = 0; j < word.size(); ++j) word[j] += rand() % 3;  // NOLINT
+    for (int j = rand() % 8; j >= 0; --j)  // NOLINT
+      mockup << "url" << rand() % 50 << "\t" << word << "\n";  // NOLINT
+  }
+  mockup.close();
+  ii.buildFromCsvFile(mockupFileName);
+  prefixCompletion.init(ii);
+}
+
+// The completions of prefix by sorting the whole vocabulary.
+vector<string> completeBySorting(string const& prefix,
+    size_t numberOfResults) {
+  vector<std::pair<int, string> > words;
+  for (size_t id = 0; id < ii.words().size(); ++id) {
+    string word = ii.words()[id];
+    if (word.compare(0, prefix.size(), prefix) == 0)
+      words.push_back(std::make_pair(-static_cast<int>(
+              ii.documentFrequency(id)), word));
+  }
+  std::sort(words.begin(), words.end());
+  vector<string> result;
+  for (size_t i = 0; i < std::min(numberOfResults, words.size()); ++i)
+    result.push_back(words[i].second);
+  return result;
+}
+
+// ___________________________________________________________________________
+TEST(PrefixCompletion, prefixRange) {
+  size_t begin;
+  size_t end;
+  prefixCompletion.prefixRange("", &begin, &end);
+  EXPECT_EQ(0, begin);
+  EXPECT_EQ(ii.words().size(), end);
+  prefixCompletion.prefixRange("b", &begin, &end);
+  ASSERT_LT(begin, end);
+  EXPECT_TRUE(begin == 0 || ii.words()[begin - 1] < "b");
+  EXPECT_EQ('b', ii.words()[begin][0]);
+  EXPECT_EQ('b', ii.words()[end - 1][0]);
+  EXPECT_TRUE(end == ii.words().size() || ii.words()[end][0] == 'c');
+  prefixCompletion.prefixRange("x", &begin, &end);
+  EXPECT_EQ(begin, end);
+  prefixCompletion.prefixRange("\xff", &begin, &end);
+  EXPECT_EQ(ii.words().size(), begin);
+  EXPECT_EQ(ii.words().size(), end);
+}
+
+// ___________________________________________________________________________
+TEST(PrefixCompletion, mostFrequent) {
+  size_t n = ii.words().size();
+  for (size_t begin = 0; begin < n; begin += 7) {
+    for (size_t end = begin + 1; end <= n; end += 5) {
+      size_t expected = begin;
+      for (size_t id = begin; id < end; ++id)
+        if (ii.documentFrequency(id) > ii.documentFrequency(expected))
+          expected = id;
+      EXPECT_EQ(expected, prefixCompletion.mostFrequent(begin, end));
+    }
+  }
+}
+
+// ___________________________________________________________________________
+TEST(PrefixCompletion, complete) {
+  char const* prefixes[] = {"", "a", "ab", "bca", "cccc", "ccccc", "d", "ba"};
+  for (size_t i = 0; i < 8; ++i) {
+    for (size_t k = 0; k < 20; k += 3) {
+      EXPECT_EQ(completeBySorting(prefixes[i], k),
+          prefixCompletion.complete(prefixes[i], k)) << prefixes[i];
+    }
+  }
+  EXPECT_EQ(ii.words().size(), prefixCompletion.complete("", 1000).size());
+}
+
+// ___________________________________________________________________________
+TEST(PrefixCompletion, writeToFileAndReadFromFile) {
+  IndexFileWriter writer(indexFileName);
+  prefixCompletion.writeToFile(&writer);
+  writer.close();
+  PrefixCompletion mapped;
+  std::shared_ptr<IndexFileReader> file(new IndexFileReader(indexFileName));
+  mapped.readFromFile(ii, file.get());
+  EXPECT_EQ(prefixCompletion.complete("b", 10), mapped.complete("b", 10));
+  EXPECT_EQ(prefixCompletion.complete("", 50), mapped.complete("", 50));
+  remove(indexFileName);
+  remove(mockupFileName);
+}
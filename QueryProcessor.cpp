@@ -2,6 +2,7 @@
 // Author: Milan Oberkirch <oberkirm@informatik.uni-freiburg.de>
 
 #include "./QueryProcessor.h"
+#include <stdint.h>
 #include <boost/algorithm/string.hpp>
 #include <string>
 #include <vector>
@@ -10,21 +11,49 @@
 #include <stdexcept>
 #include "./InvertedIndex.h"
 #include "./ApproximateMatching.h"
+#include "./IndexFile.h"
+#include "./Metrics.h"
+#include "./Intersection.h"
 #include "./Posting.h"
+#include "./PostingList.h"
+#include "./PrefixCompletion.h"
+#include "./SegmentedIndex.h"
+#include "./TermDictionary.h"
 
 using std::map;
 using std::string;
 using std::vector;
 
 // ___________________________________________________________________________
-void QueryProcessor::init(InvertedIndex const& index, int const& k) {
+void QueryProcessor::init(SegmentedIndex const& index, int const& k) {
   _index = &index;
   _approximateMatching.init(index, k);
+  _prefixCompletion.init(index);
+}
+
+// ___________________________________________________________________________
+void QueryProcessor::initFromFile(SegmentedIndex const& index,
+    std::shared_ptr<IndexFileReader> const& file) {
+  _index = &index;
+  _approximateMatching.readFromFile(file);
+  _prefixCompletion.readFromFile(index, file.get());
+}
+
+// ___________________________________________________________________________
+void QueryProcessor::writeToFile(IndexFileWriter* file) const {
+  _approximateMatching.writeToFile(file);
+  _prefixCompletion.writeToFile(file);
+}
+
+// ___________________________________________________________________________
+void QueryProcessor::setMetrics(Metrics* metrics) {
+  _metrics = metrics;
+  _approximateMatching.setMetrics(metrics);
 }
 
 // ___________________________________________________________________________
 vector<string> QueryProcessor::similarWords(size_t numberOfResults,
-    string const& query) {
+    string const& query) const {
   vector<string> queryVector;
   split(queryVector, query, boost::is_any_of(" ,+,,"));
   string word = queryVector.back();
@@ -32,8 +61,20 @@ vector<string> QueryProcessor::similarWords(size_t numberOfResults,
   string prefix =
     query.substr(0, query.size() - (queryVector.size() - 1 + word.size()));
   if (!prefix.empty()) prefix += " ";
-  vector<string> results =  _approximateMatching.
-    computeApproximateMatches(word, (word.size() - 1) / 3, numberOfResults);
+  Metrics::Timer lookupTimer(_metrics, Metrics::LOOKUP);
+  vector<string> results =
+    _prefixCompletion.complete(word, numberOfResults);
+  lookupTimer.stop();
+  if (results.size() < numberOfResults) {
+    vector<string> similar = _approximateMatching.computeApproximateMatches(
+        word, (word.size() - 1) / 3, numberOfResults);
+    for (size_t i = 0; i < similar.size()
+        && results.size() < numberOfResults; ++i) {
+      if (std::find(results.begin(), results.end(), similar[i])
+          == results.end())
+        results.push_back(similar[i]);
+    }
+  }
   for (vector<string>::iterator it = results.begin();
       it < results.end(); ++it)
     *it = prefix + *it;
@@ -42,42 +83,303 @@ vector<string> QueryProcessor::similarWords(size_t numberOfResults,
 
 // ___________________________________________________________________________
 vector<size_t> QueryProcessor::searchRecords(size_t numberOfResults,
-    string query) {
-  vector<string> queryVector;
-  vector<Posting> postings;
+    string query, Mode mode) const {
+  vector<Posting> postings = searchPostings(numberOfResults, query, mode);
   vector<size_t> result;
+  // convert the result to vector<int>
+  for (size_t i = 0; i < postings.size(); i++) {
+    result.push_back(postings[i].documentId);
+  }
+  return result;
+}
 
-  // uniform query
-  std::transform(query.begin(), query.end(), query.begin(), ::tolower);
-  split(queryVector, query, boost::is_any_of(" ,+,,"));
+// Order postings by decreasing score, ties by increasing document id.
+static bool betterPosting(Posting const& posting1, Posting const& posting2) {
+  if (posting1.score != posting2.score)
+    return posting1.score > posting2.score;
+  return posting1.documentId < posting2.documentId;
+}
 
-  // collect candidates
-  postings = _index->getPostingsFromWord(queryVector[0]);
-  if (postings.empty())
-    return vector<size_t>();
-  for (size_t i = 1; i < queryVector.size(); ++i) {
-    postings = intersect(_index->getPostingsFromWord(queryVector[i]),
-        postings);
+// ___________________________________________________________________________
+vector<Posting> QueryProcessor::searchPostings(size_t numberOfResults,
+    string query, Mode mode) const {
+  return searchPostings(numberOfResults, query, mode,
+      _index->bm25Parameters());
+}
+
+// ___________________________________________________________________________
+vector<Posting> QueryProcessor::searchPostings(size_t numberOfResults,
+    string query, Mode mode, Bm25::Parameters const& bm25) const {
+  vector<string> queryVector;
+  static thread_local Scratch scratch;
+  Metrics::Timer parseTimer(_metrics, Metrics::PARSE);
+  parseQuery(query, &queryVector, &scratch.phrases);
+  parseTimer.stop();
+
+  // The ids of the words in each segment (SIZE_MAX for words not in it)
+  // and the number of documents of all segments containing them.
+  Metrics::Timer lookupTimer(_metrics, Metrics::LOOKUP);
+  size_t numberOfSegments = _index->numberOfSegments();
+  scratch.wordIds.assign(numberOfSegments * queryVector.size(), SIZE_MAX);
+  scratch.documentFrequencies.assign(queryVector.size(), 0);
+  for (size_t segment = 0; segment < numberOfSegments; ++segment) {
+    TermDictionary const& words = _index->segment(segment).words();
+    for (size_t i = 0; i < queryVector.size(); ++i) {
+      size_t* wordId = &scratch.wordIds[segment * queryVector.size() + i];
+      if (words.find(queryVector[i], wordId)) {
+        scratch.documentFrequencies[i] +=
+          _index->segment(segment).postingList(*wordId).size();
+      } else {
+        *wordId = SIZE_MAX;
+      }
+    }
   }
 
-  // sort the results
-  std::partial_sort(
-      postings.begin(),
-      std::min(postings.end(), postings.begin() + numberOfResults),
-      postings.end());
+  lookupTimer.stop();
 
-  // convert the result to vector<int>
-  for (size_t i = 0; i < numberOfResults && i < postings.size(); i++) {
-    result.push_back(postings[i].documentId);
+  // The best results of each segment, merged. The candidates are scored
+  // while the lists are traversed, so ranking is only merging the results.
+  Metrics::Timer intersectTimer(_metrics, Metrics::INTERSECT);
+  vector<Posting> results;
+  for (size_t segment = 0; segment < numberOfSegments; ++segment) {
+    InvertedIndex const& index = _index->segment(segment);
+    scratch.lists.clear();
+    scratch.positionLists.clear();
+    for (size_t i = 0; i < queryVector.size(); ++i) {
+      size_t wordId = scratch.wordIds[segment * queryVector.size() + i];
+      if (wordId != SIZE_MAX) {
+        scratch.lists.push_back(_index->postingList(segment, wordId,
+              scratch.documentFrequencies[i], bm25));
+        scratch.positionLists.push_back(index.positionList(wordId));
+      } else {
+        scratch.lists.push_back(PostingList());
+        scratch.positionLists.push_back(PositionList());
+      }
+    }
+    if (mode == DISJUNCTIVE && scratch.phrases.empty())
+      topKUnion(numberOfResults, &scratch);
+    else if (_index->hasPositions()
+        && (scratch.lists.size() > 1 || !scratch.phrases.empty()))
+      topKPositional(numberOfResults, &scratch);
+    else
+      topKIntersection(numberOfResults, &scratch);
+    for (size_t i = 0; i < scratch.results.size(); ++i) {
+      results.push_back(scratch.results[i]);
+      results.back().documentId += _index->firstDocumentId(segment);
+    }
   }
+  intersectTimer.stop();
+  Metrics::Timer rankTimer(_metrics, Metrics::RANK);
+  if (numberOfSegments > 1) {
+    std::sort(results.begin(), results.end(), betterPosting);
+    if (results.size() > numberOfResults) results.resize(numberOfResults);
+  }
+  return results;
+}
 
-  return result;
+// ___________________________________________________________________________
+void QueryProcessor::parseQuery(string const& query, vector<string>* words,
+    vector<Phrase>* phrases) {
+  words->clear();
+  phrases->clear();
+  size_t pos = 0;
+  while (pos < query.size()) {
+    bool isPhrase = query[pos] == '"';
+    size_t end = isPhrase ? query.find('"', pos + 1) : query.find('"', pos);
+    if (end == string::npos) end = query.size();
+    if (isPhrase) ++pos;
+    if (isPhrase) phrases->push_back(Phrase());
+    uint32_t position = 0;
+    while (pos < end) {
+      // The next word.
+      size_t wordStart = pos;
+      size_t wordEnd = pos;
+      if (isPhrase) {
+        while (wordStart < end
+            && !InvertedIndex::isLetter(query[wordStart]))
+          ++wordStart;
+        wordEnd = wordStart;
+        while (wordEnd < end && InvertedIndex::isLetter(query[wordEnd]))
+          ++wordEnd;
+      } else {
+        wordEnd = std::min(end, query.find_first_of(" ,+", wordStart));
+      }
+      pos = wordEnd + (isPhrase ? 0 : 1);
+      if (wordEnd == wordStart) continue;
+      if (isPhrase && wordEnd - wordStart <= InvertedIndex::minWordLength) {
+        ++position;
+        continue;
+      }
+      string word = query.substr(wordStart, wordEnd - wordStart);
+      std::transform(word.begin(), word.end(), word.begin(), ::tolower);
+      size_t index = std::find(words->begin(), words->end(), word)
+        - words->begin();
+      if (index == words->size()) words->push_back(word);
+      if (isPhrase) {
+        phrases->back().words.push_back(index);
+        phrases->back().offsets.push_back(position++);
+      }
+    }
+    // Behind the closing quote of a phrase.
+    pos = isPhrase ? end + 1 : end;
+  }
+}
+
+// Add posting to the heap of the best k results if it is better than the
+// worst of them. Documents are added in order of their ids, so later
+// documents only replace results with smaller scores.
+static void addResult(Posting const& posting, size_t k,
+    vector<Posting>* heap) {
+  if (heap->size() < k) {
+    heap->push_back(posting);
+    std::push_heap(heap->begin(), heap->end(), betterPosting);
+  } else if (posting.score > heap->front().score) {
+    std::pop_heap(heap->begin(), heap->end(), betterPosting);
+    heap->back() = posting;
+    std::push_heap(heap->begin(), heap->end(), betterPosting);
+  }
+}
+
+// The largest document id in the decoded block of cursor.
+static size_t lastBlockDocumentId(PostingList::Cursor const& cursor) {
+  return cursor.blockDocumentIds()[cursor.blockLength() - 1];
+}
+
+// Order inverted lists by size.
+static bool shorterList(PostingList const& list1, PostingList const& list2) {
+  return list1.size() < list2.size();
+}
+
+// Order inverted lists by their maximum score.
+static bool lowerMaxScore(PostingList const& list1,
+    PostingList const& list2) {
+  return list1.maxScore() < list2.maxScore();
+}
+
+// The weight of the distance of the query words in a document (see
+// proximityBoost).
+static const float proximityWeight = 0.5;
+
+// Whether a score bounded by bound cannot beat threshold. Sums are not
+// computed in the same order as their bounds, so leave room for rounding.
+static bool cannotBeat(float bound, float threshold) {
+  return bound * (1 + 1e-5) <= threshold;
+}
+
+// ___________________________________________________________________________
+void QueryProcessor::topKIntersection(size_t k, Scratch* scratch) const {
+  // The best k postings so far as heap with the worst one on top.
+  vector<Posting>& heap = scratch->results;
+  vector<PostingList>& lists = scratch->lists;
+  vector<PostingList::Cursor>& cursors = scratch->cursors;
+  heap.clear();
+  cursors.clear();
+  if (k == 0 || lists.empty()) return;
+
+  // Candidates are taken from the shortest list.
+  std::sort(lists.begin(), lists.end(), shorterList);
+  vector<uint32_t>& candidates = scratch->candidates;
+  vector<float>& scores = scratch->scores;
+  vector<float>& blockMaxScores = scratch->upperBounds;
+  blockMaxScores.resize(lists.size());
+  vector<uint32_t>& positions1 = scratch->positions1;
+  vector<uint32_t>& positions2 = scratch->positions2;
+  positions1.resize(PostingList::blockSize);
+  positions2.resize(PostingList::blockSize);
+  float maxScore = 1;
+  for (size_t i = 0; i < lists.size(); ++i) {
+    cursors.push_back(PostingList::Cursor(lists[i]));
+    maxScore *= lists[i].maxScore();
+  }
+
+  size_t documentId = 0;
+  while (true) {
+    // Once there are k results, a candidate has to beat the worst of them.
+    // Scores are multiplied in the same order as the bounds, so the bounds
+    // are not affected by rounding.
+    if (heap.size() == k) {
+      if (maxScore <= heap.front().score) break;
+      float blockMaxScore = 1;
+      size_t blockEnd = UINT32_MAX;
+      size_t i = 0;
+      for (; i < cursors.size(); ++i) {
+        cursors[i].shallowSkipTo(documentId);
+        if (cursors[i].atEnd()) break;
+        blockMaxScore *= cursors[i].blockMaxScore();
+        blockEnd = std::min(blockEnd, cursors[i].blockLastDocumentId());
+      }
+      if (i < cursors.size()) break;
+      if (blockMaxScore <= heap.front().score) {
+        // No document up to the end of the first of the blocks can be
+        // better, continue behind it (without decoding the blocks).
+        if (blockEnd == UINT32_MAX) break;
+        documentId = blockEnd + 1;
+        continue;
+      }
+    }
+
+    // The next candidate from the first list, and the blocks of the other
+    // lists which may contain it. The documents up to the end of the first
+    // of these blocks are intersected block-wise.
+    cursors[0].skipTo(documentId);
+    if (cursors[0].atEnd()) break;
+    documentId = cursors[0].documentId();
+    size_t windowEnd = lastBlockDocumentId(cursors[0]);
+    size_t i = 1;
+    for (; i < cursors.size(); ++i) {
+      cursors[i].skipTo(documentId);
+      if (cursors[i].atEnd()) break;
+      windowEnd = std::min(windowEnd, lastBlockDocumentId(cursors[i]));
+      blockMaxScores[i] = cursors[i].blockMaxScore();
+    }
+    if (i < cursors.size()) break;
+
+    // Candidates of the first list in the window. Skip those which can not
+    // get into the results even with the block maxima of the other lists.
+    candidates.clear();
+    scores.clear();
+    uint32_t const* documentIds = cursors[0].blockDocumentIds();
+    for (size_t position = cursors[0].position();
+        position < cursors[0].blockLength()
+        && documentIds[position] <= windowEnd; ++position) {
+      float score = cursors[0].score(position);
+      if (heap.size() == k) {
+        float bound = score;
+        for (size_t i = 1; i < cursors.size(); ++i) bound *= blockMaxScores[i];
+        if (bound <= heap.front().score) continue;
+      }
+      candidates.push_back(documentIds[position]);
+      scores.push_back(score);
+    }
+
+    // Keep the candidates contained in the other lists.
+    for (size_t i = 1; i < cursors.size() && !candidates.empty(); ++i) {
+      documentIds = cursors[i].blockDocumentIds() + cursors[i].position();
+      size_t size = std::upper_bound(documentIds,
+          cursors[i].blockDocumentIds() + cursors[i].blockLength(),
+          windowEnd) - documentIds;
+      size_t count = Intersection::intersect(candidates.data(),
+          candidates.size(), documentIds, size, positions1.data(),
+          positions2.data());
+      for (size_t j = 0; j < count; ++j) {
+        candidates[j] = candidates[positions1[j]];
+        scores[j] = scores[positions1[j]]
+          * cursors[i].score(cursors[i].position() + positions2[j]);
+      }
+      candidates.resize(count);
+      scores.resize(count);
+    }
+    for (size_t j = 0; j < candidates.size(); ++j)
+      addResult(Posting(candidates[j], scores[j]), k, &heap);
+    documentId = windowEnd + 1;
+  }
+  std::sort_heap(heap.begin(), heap.end(), betterPosting);
 }
 
 // ___________________________________________________________________________
-vector<Posting> QueryProcessor::intersect(
-    vector<Posting> list1, vector<Posting> list2) {
-  vector<Posting> result;
+void QueryProcessor::intersect(vector<Posting> const& list1,
+    vector<Posting> const& list2, vector<Posting>* result) const {
+  result->clear();
 
   vector<Posting>::const_iterator i = list1.begin();
   vector<Posting>::const_iterator j = list2.begin();
@@ -88,10 +390,233 @@ vector<Posting> QueryProcessor::intersect(
     while (i < list1.end() && j->documentId > i->documentId) ++i;
     if (i == list1.end()) break;
     if (*i == *j) {
-      result.push_back(Posting(i->documentId, i->score * j->score));
+      result->push_back(Posting(i->documentId, i->score * j->score));
       ++i;
       ++j;
     }
   }
-  return result;
+}
+
+// ___________________________________________________________________________
+void QueryProcessor::intersect(vector<Posting> const& list1,
+    PostingList const& list2, vector<Posting>* result) const {
+  result->clear();
+  PostingList::Cursor cursor(list2);
+  for (vector<Posting>::const_iterator i = list1.begin();
+      i < list1.end(); ++i) {
+    cursor.skipTo(i->documentId);
+    if (cursor.atEnd()) break;
+    if (cursor.documentId() == i->documentId)
+      result->push_back(Posting(i->documentId, i->score * cursor.score()));
+  }
+}
+
+// ___________________________________________________________________________
+void QueryProcessor::topKUnion(size_t k, Scratch* scratch) const {
+  // The best k postings so far as heap with the worst one on top.
+  vector<Posting>& heap = scratch->results;
+  vector<PostingList>& lists = scratch->lists;
+  vector<PostingList::Cursor>& cursors = scratch->cursors;
+  heap.clear();
+  cursors.clear();
+  if (k == 0 || lists.empty()) return;
+
+  // Lists ordered by their maximum score, with upperBounds[i] the largest
+  // possible sum of scores from lists 0..i.
+  std::stable_sort(lists.begin(), lists.end(), lowerMaxScore);
+  vector<float>& upperBounds = scratch->upperBounds;
+  upperBounds.clear();
+  for (size_t i = 0; i < lists.size(); ++i) {
+    cursors.push_back(PostingList::Cursor(lists[i]));
+    upperBounds.push_back((i ? upperBounds.back() : 0) + lists[i].maxScore());
+  }
+  // Scores of the current document in each list.
+  vector<float>& scores = scratch->scores;
+  scores.resize(lists.size());
+
+  // Lists firstEssential.. are essential: a document in none of them can not
+  // get into the results.
+  size_t firstEssential = 0;
+  while (true) {
+    if (heap.size() == k) {
+      while (firstEssential < lists.size()
+          && cannotBeat(upperBounds[firstEssential], heap.front().score))
+        ++firstEssential;
+    }
+    // The next candidate is the smallest document id in essential lists.
+    size_t documentId = UINT32_MAX;
+    for (size_t i = firstEssential; i < cursors.size(); ++i) {
+      if (!cursors[i].atEnd())
+        documentId = std::min(documentId, cursors[i].documentId());
+    }
+    if (documentId == UINT32_MAX) break;
+
+    float score = 0;
+    for (size_t i = firstEssential; i < cursors.size(); ++i) {
+      scores[i] = 0;
+      if (!cursors[i].atEnd() && cursors[i].documentId() == documentId) {
+        scores[i] = cursors[i].score();
+        score += scores[i];
+        cursors[i].next();
+      }
+    }
+    // Add the scores from the other lists, as long as they can still make
+    // a difference.
+    size_t i = firstEssential;
+    for (; i > 0; --i) {
+      if (heap.size() == k
+          && cannotBeat(score + upperBounds[i - 1], heap.front().score))
+        break;
+      scores[i - 1] = 0;
+      cursors[i - 1].skipTo(documentId);
+      if (!cursors[i - 1].atEnd() && cursors[i - 1].documentId() == documentId)
+        scores[i - 1] = cursors[i - 1].score();
+      score += scores[i - 1];
+    }
+    if (i > 0) continue;
+
+    // Sum up in a fixed order, so the score does not depend on pruning.
+    score = 0;
+    for (size_t j = 0; j < scores.size(); ++j) score += scores[j];
+    addResult(Posting(documentId, score), k, &heap);
+  }
+  std::sort_heap(heap.begin(), heap.end(), betterPosting);
+}
+
+// ___________________________________________________________________________
+void QueryProcessor::topKPositional(size_t k, Scratch* scratch) const {
+  vector<Posting>& heap = scratch->results;
+  vector<PostingList>& lists = scratch->lists;
+  vector<PostingList::Cursor>& cursors = scratch->cursors;
+  heap.clear();
+  cursors.clear();
+  if (k == 0 || lists.empty()) return;
+
+  // The lists keep their order (the phrases refer to it), candidates are
+  // taken from the shortest one.
+  size_t first = std::min_element(lists.begin(), lists.end(), shorterList)
+    - lists.begin();
+  scratch->positionCursors.clear();
+  for (size_t i = 0; i < lists.size(); ++i) {
+    cursors.push_back(PostingList::Cursor(lists[i]));
+    scratch->positionCursors.push_back(
+        PositionList::Cursor(scratch->positionLists[i]));
+  }
+  float maxBoost = lists.size() > 1 ? 1 + proximityWeight : 1;
+  float maxScore = maxBoost;
+  for (size_t i = 0; i < lists.size(); ++i) maxScore *= lists[i].maxScore();
+
+  size_t documentId = 0;
+  while (true) {
+    // Skip blocks whose documents cannot beat the worst result even with
+    // the largest boost (like in topKIntersection).
+    if (heap.size() == k) {
+      if (cannotBeat(maxScore, heap.front().score)) break;
+      float blockMaxScore = maxBoost;
+      size_t blockEnd = UINT32_MAX;
+      size_t i = 0;
+      for (; i < cursors.size(); ++i) {
+        cursors[i].shallowSkipTo(documentId);
+        if (cursors[i].atEnd()) break;
+        blockMaxScore *= cursors[i].blockMaxScore();
+        blockEnd = std::min(blockEnd, cursors[i].blockLastDocumentId());
+      }
+      if (i < cursors.size()) break;
+      if (cannotBeat(blockMaxScore, heap.front().score)) {
+        if (blockEnd == UINT32_MAX) break;
+        documentId = blockEnd + 1;
+        continue;
+      }
+    }
+
+    cursors[first].skipTo(documentId);
+    if (cursors[first].atEnd()) break;
+    documentId = cursors[first].documentId();
+    // Skip the candidate if it cannot beat the worst result with the block
+    // maxima of the other lists.
+    if (heap.size() == k) {
+      float bound = cursors[first].score() * maxBoost;
+      for (size_t i = 0; i < cursors.size(); ++i) {
+        if (i == first) continue;
+        cursors[i].shallowSkipTo(documentId);
+        if (cursors[i].atEnd()) break;
+        bound *= cursors[i].blockMaxScore();
+      }
+      if (cannotBeat(bound, heap.front().score)) {
+        ++documentId;
+        continue;
+      }
+    }
+    size_t i = 0;
+    for (; i < cursors.size(); ++i) {
+      cursors[i].skipTo(documentId);
+      if (cursors[i].atEnd() || cursors[i].documentId() != documentId) break;
+    }
+    if (i < cursors.size()) {
+      if (cursors[i].atEnd()) break;
+      documentId = cursors[i].documentId();
+      continue;
+    }
+
+    float score = 1;
+    for (size_t i = 0; i < cursors.size(); ++i) score *= cursors[i].score();
+    if (heap.size() < k || !cannotBeat(score * maxBoost, heap.front().score)) {
+      float boost = proximityBoost(scratch);
+      if (boost > 0) addResult(Posting(documentId, score * boost), k, &heap);
+    }
+    ++documentId;
+  }
+  std::sort_heap(heap.begin(), heap.end(), betterPosting);
+}
+
+// ___________________________________________________________________________
+float QueryProcessor::proximityBoost(Scratch* scratch) {
+  vector<vector<uint32_t> >& positions = scratch->positions;
+  size_t n = scratch->cursors.size();
+  positions.resize(n);
+  for (size_t i = 0; i < n; ++i) {
+    scratch->positionCursors[i].positions(scratch->cursors[i].index(),
+        &positions[i]);
+    // Without positions of a word it is not near to the others.
+    if (positions[i].empty()) return scratch->phrases.empty() ? 1 : 0;
+  }
+
+  // Each phrase has to start at one of the positions of its first word.
+  for (size_t p = 0; p < scratch->phrases.size(); ++p) {
+    Phrase const& phrase = scratch->phrases[p];
+    if (phrase.words.empty()) continue;
+    vector<uint32_t> const& starts = positions[phrase.words[0]];
+    bool found = false;
+    for (size_t s = 0; s < starts.size() && !found; ++s) {
+      if (starts[s] < phrase.offsets[0]) continue;
+      uint32_t start = starts[s] - phrase.offsets[0];
+      size_t j = 1;
+      while (j < phrase.words.size()
+          && std::binary_search(positions[phrase.words[j]].begin(),
+            positions[phrase.words[j]].end(), start + phrase.offsets[j]))
+        ++j;
+      found = j == phrase.words.size();
+    }
+    if (!found) return 0;
+  }
+  if (n < 2) return 1;
+
+  // The shortest distance between occurrences of all words: move the
+  // occurrence with the smallest position to the next one of its word.
+  vector<uint32_t>& next = scratch->positions1;
+  next.assign(n, 0);
+  uint32_t distance = UINT32_MAX;
+  while (true) {
+    size_t smallest = 0;
+    uint32_t largest = 0;
+    for (size_t i = 0; i < n; ++i) {
+      if (positions[i][next[i]] < positions[smallest][next[smallest]])
+        smallest = i;
+      largest = std::max(largest, positions[i][next[i]]);
+    }
+    distance = std::min(distance,
+        largest - positions[smallest][next[smallest]]);
+    if (++next[smallest] == positions[smallest].size()) break;
+  }
+  return 1 + proximityWeight * (n - 1) / std::max<uint32_t>(distance, n - 1);
 }
@@ -5,12 +5,20 @@
 #define QUERYPROCESSOR_H_
 
 #include <gtest/gtest.h>
+#include <memory>
 #include <string>
 #include <vector>
 #include <map>
 #include "./InvertedIndex.h"
 #include "./ApproximateMatching.h"
+#include "./Bm25.h"
+#include "./IndexFile.h"
+#include "./Metrics.h"
+#include "./PositionList.h"
 #include "./Posting.h"
+#include "./PostingList.h"
+#include "./PrefixCompletion.h"
+#include "./SegmentedIndex.h"
 
 using std::map;
 using std::string;
@@ -18,23 +26,138 @@ using std::vector;
 
 // Class for processing queries with two keywords based on an inverted index.
 class QueryProcessor {
-  InvertedIndex const *_index;
+  SegmentedIndex const *_index;
   ApproximateMatching _approximateMatching;
+  PrefixCompletion _prefixCompletion;
+  Metrics* _metrics;
 
  public:
+  QueryProcessor() : _index(NULL), _metrics(NULL) {}
   // Initialice vovabulary in _approximateMatching and set index for search.
-  void init(InvertedIndex const& index, int const& k);
-  // Answer given query. Return list of matching record ids.
-  vector<size_t> searchRecords(size_t numberOfResults, string query);
-  // Lookup words with similar prefix.
-  vector<string> similarWords(size_t numberOfResults, string const& query);
+  void init(SegmentedIndex const& index, int const& k);
+  // Like init, but read the vocabulary from an index file.
+  void initFromFile(SegmentedIndex const& index,
+      std::shared_ptr<IndexFileReader> const& file);
+  // Append the vocabulary to an index file.
+  void writeToFile(IndexFileWriter* file) const;
+  // Record the time the phases of queries take in metrics (none by
+  // default, see Metrics::Histogram).
+  void setMetrics(Metrics* metrics);
+  ApproximateMatching const& approximateMatching() const {
+    return _approximateMatching;
+  }
+  // How the words of a query are combined.
+  enum Mode {
+    // Records containing all words, ranked by the product of their scores.
+    CONJUNCTIVE,
+    // Records containing any of the words, ranked by the sum of their
+    // scores.
+    DISJUNCTIVE
+  };
+  // A phrase of a query: its words (as indices of the query words) and
+  // their positions relative to the beginning of the phrase.
+  struct Phrase {
+    vector<size_t> words;
+    vector<uint32_t> offsets;
+  };
+  // Buffers for evaluating queries. They are kept between queries (one
+  // per thread), so evaluating a query does not allocate memory once they
+  // have grown large enough.
+  struct Scratch {
+    // The inverted lists of the query words.
+    vector<PostingList> lists;
+    vector<PostingList::Cursor> cursors;
+    // Candidate documents and their scores (or the scores of a document in
+    // each list).
+    vector<uint32_t> candidates;
+    vector<float> scores;
+    // Bounds for the scores in each list.
+    vector<float> upperBounds;
+    // Positions of common documents in two lists.
+    vector<uint32_t> positions1;
+    vector<uint32_t> positions2;
+    // The best results, best first.
+    vector<Posting> results;
+    // The phrases of the query, the positions of the query words (in the
+    // order of lists) and their positions in the current document.
+    vector<Phrase> phrases;
+    vector<PositionList> positionLists;
+    vector<PositionList::Cursor> positionCursors;
+    vector<vector<uint32_t> > positions;
+    // The ids of the query words in each segment and the number of
+    // documents containing them.
+    vector<size_t> wordIds;
+    vector<size_t> documentFrequencies;
+  };
+  // Answer given query. Return list of matching record ids. Words in double
+  // quotes are a phrase, which has to occur in the records as it is. If the
+  // index has positions, records containing all words of a query are ranked
+  // higher the closer the words are in them. Queries with phrases are always
+  // conjunctive (without positions their phrases are only words). The
+  // segments of the index are searched one after the other, with the BM25
+  // statistics of all of them.
+  vector<size_t> searchRecords(size_t numberOfResults, string query,
+      Mode mode = CONJUNCTIVE) const;
+  // Like searchRecords, but with the scores of the records (best first).
+  vector<Posting> searchPostings(size_t numberOfResults, string query,
+      Mode mode = CONJUNCTIVE) const;
+  // Like searchPostings, with other BM25 parameters than those of the
+  // index (see SegmentedIndex::bm25Parameters).
+  vector<Posting> searchPostings(size_t numberOfResults, string query,
+      Mode mode, Bm25::Parameters const& bm25) const;
+  // Lookup words with the prefix, the most frequent first. If there are
+  // not enough of them, words with a similar prefix follow.
+  vector<string> similarWords(size_t numberOfResults,
+      string const& query) const;
 
  private:
-  // Intersect two inverted lists and return the result list.
+  // Intersect two inverted lists into result.
   FRIEND_TEST(QueryProcessor, intersect);
   FRIEND_TEST(QueryProcessor, intersectFromEx03);
-  vector<Posting> intersect(vector<Posting> list1,
-      vector<Posting> list2);
+  void intersect(vector<Posting> const& list1, vector<Posting> const& list2,
+      vector<Posting>* result) const;
+  // Intersect a list with a compressed inverted list. Blocks of list2
+  // without candidates from list1 are skipped.
+  FRIEND_TEST(QueryProcessor, intersectPostingList);
+  void intersect(vector<Posting> const& list1, PostingList const& list2,
+      vector<Posting>* result) const;
+  // The k documents contained in all scratch->lists with the highest
+  // scores (the product of their scores in the lists) into
+  // scratch->results. Ties are broken by
+  // smaller document ids. Instead of evaluating the whole intersection,
+  // candidates are skipped block-wise while the product of the block maxima
+  // cannot beat the k-th best score found so far (block-max pruning). The
+  // remaining candidates are intersected a block at a time (see
+  // Intersection).
+  FRIEND_TEST(QueryProcessor, topKIntersection);
+  void topKIntersection(size_t k, Scratch* scratch) const;
+  // The k documents contained in any of scratch->lists with the highest
+  // sums of their scores (ties broken like above). Lists are traversed
+  // document at a time. With MaxScore pruning, lists whose maximum scores
+  // together cannot lift a document into the results are only used to
+  // complete the scores of candidates from the other lists.
+  FRIEND_TEST(QueryProcessor, topKUnion);
+  void topKUnion(size_t k, Scratch* scratch) const;
+  // Like topKIntersection, but only documents containing the
+  // scratch->phrases count, and scores are multiplied with the proximity
+  // boost (see proximityBoost). Positions are only decoded for documents
+  // in the intersection of the lists which can get into the results.
+  FRIEND_TEST(QueryProcessor, topKPositional);
+  void topKPositional(size_t k, Scratch* scratch) const;
+  // For the current documents of scratch->cursors (with the positions
+  // read by scratch->positionCursors): 0 if one of the phrases
+  // does not occur in it, otherwise the factor for the score by the
+  // shortest distance d between occurrences of all n query words:
+  // 1 + proximityWeight * (n - 1) / d (at most 1 + proximityWeight).
+  FRIEND_TEST(QueryProcessor, proximityBoost);
+  static float proximityBoost(Scratch* scratch);
+  // Split a query into its distinct lower-case words and its phrases.
+  // Words are separated by " ,+". Phrases are split into words like records
+  // (see InvertedIndex::parseRecord), words too short to be indexed only
+  // count for the positions.
+  FRIEND_TEST(QueryProcessor, parseQuery);
+  static void parseQuery(string const& query, vector<string>* words,
+      vector<Phrase>* phrases);
 };
 
 #endif  // QUERYPROCESSOR_H_
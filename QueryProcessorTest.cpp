@@ -2,10 +2,17 @@
 // Author: Milan Oberkirch <oberkirm@informatik.uni-freiburg.de>
 
 #include <gtest/gtest.h>
+#include <algorithm>
+#include <fstream>  // NOLINT
+#include <map>
 #include <vector>
 #include <string>
-#include "./QueryProcessor.h"
+#include "./FlatVector.h"
+#include "./PositionList.h"
 #include "./Posting.h"
+#include "./PostingList.h"
+#include "./QueryProcessor.h"
+#include "./SegmentedIndex.h"
 
 using std::string;
 QueryProcessor qp;
@@ -17,7 +24,7 @@ vector<Posting> result;
 TEST(QueryProcessor, intersect) {
   list1 = {Posting(2, 0.5), Posting(5, 0.3)};
   list2 = {Posting(2, 0.8), Posting(3, 0.9)};
-  result = qp.intersect(list1, list2);
+  qp.intersect(list1, list2, &result);
   EXPECT_EQ(1, result.size());
   ASSERT_NEAR(0.4, result.at(0).score, 1e-5);
   ASSERT_EQ(2, result.at(0).documentId);
@@ -32,7 +39,351 @@ TEST(QueryProcessor, intersectFromEx03) {
   QueryProcessor q;
   list1 = A;
   list2 = B;
-  result = q.intersect(list1, list2);
+  q.intersect(list1, list2, &result);
   vector<Posting> expected = {Posting(1, 1)};
   EXPECT_EQ(expected, result);
 }
+
+// ___________________________________________________________________________
+TEST(QueryProcessor, intersectPostingList) {
+  QueryProcessor q;
+  vector<Posting> candidates = {Posting(3, 2), Posting(300, 1),
+    Posting(1000, 1)};
+  vector<Posting> list;
+  for (size_t documentId = 0; documentId < 1000; documentId += 3)
+    list.push_back(Posting(documentId, 0.5));
+  FlatVector<uint8_t> data;
+  PostingList::encode(list, &data);
+  q.intersect(candidates, PostingList(data.data()), &result);
+  ASSERT_EQ(2, result.size());
+  EXPECT_EQ(3, result.at(0).documentId);
+  EXPECT_NEAR(1, result.at(0).score, 1e-5);
+  EXPECT_EQ(300, result.at(1).documentId);
+}
+
+// Order by decreasing score, then by increasing document id.
+bool betterThan(Posting const& posting1, Posting const& posting2) {
+  if (posting1.score != posting2.score) return posting1.score > posting2.score;
+  return posting1.documentId < posting2.documentId;
+}
+
+// ___________________________________________________________________________
+TEST(QueryProcessor, topKIntersection) {
+  QueryProcessor q;
+  QueryProcessor::Scratch scratch;
+  // Lists of different density with scores repeating in patterns, so there
+  // are many ties and the pruning has to decide correctly at the bounds.
+  // The second set has a very short list.
+  size_t steps[2][3] = {{2, 3, 5}, {2, 3, 997}};
+  // Outside of the loop, scratch.lists still refers to it afterwards.
+  FlatVector<uint8_t> data;
+  for (size_t listSet = 0; listSet < 2; ++listSet) {
+    vector<size_t> offsets;
+    for (size_t i = 0; i < 3; ++i) {
+      vector<Posting> list;
+      for (size_t documentId = 0; documentId < 20000;
+          documentId += steps[listSet][i])
+        list.push_back(Posting(documentId,
+              1 + (documentId * (i + 7)) % (11 + i)));
+      offsets.push_back(PostingList::encode(list, &data));
+    }
+    vector<PostingList> postingLists;
+    for (size_t i = 0; i < 3; ++i)
+      postingLists.push_back(PostingList(data.data() + offsets[i]));
+
+    // Exhaustive evaluation of the quantized lists, starting with the
+    // shortest list like topKIntersection.
+    vector<Posting> expected = postingLists[2].decode();
+    for (size_t i = 2; i > 0; --i) {
+      q.intersect(expected, postingLists[i - 1], &result);
+      expected.swap(result);
+    }
+    std::sort(expected.begin(), expected.end(), betterThan);
+
+    size_t ks[] = {1, 10, 100, 1000, 10000};
+    for (size_t j = 0; j < 5; ++j) {
+      // The same scratch buffers for all queries.
+      scratch.lists = postingLists;
+      q.topKIntersection(ks[j], &scratch);
+      result = scratch.results;
+      ASSERT_EQ(std::min(ks[j], expected.size()), result.size());
+      for (size_t i = 0; i < result.size(); ++i) {
+        EXPECT_EQ(expected[i].documentId, result[i].documentId);
+        EXPECT_EQ(expected[i].score, result[i].score);
+      }
+    }
+  }
+
+  q.topKIntersection(0, &scratch);
+  EXPECT_TRUE(scratch.results.empty());
+  scratch.lists.push_back(PostingList());
+  q.topKIntersection(10, &scratch);
+  EXPECT_TRUE(scratch.results.empty());
+}
+
+// ___________________________________________________________________________
+TEST(QueryProcessor, topKUnion) {
+  QueryProcessor q;
+  // Lists ordered by their maximum score (so sums are computed in the same
+  // order as below) with overlapping document ids and many ties.
+  FlatVector<uint8_t> data;
+  vector<size_t> offsets;
+  vector<vector<Posting> > lists(3);
+  size_t steps[] = {2, 3, 5};
+  for (size_t i = 0; i < lists.size(); ++i) {
+    for (size_t documentId = i; documentId < 20000; documentId += steps[i])
+      lists[i].push_back(Posting(documentId,
+            (1 + (documentId * 7) % 5) * (i + 1)));
+    offsets.push_back(PostingList::encode(lists[i], &data));
+  }
+  vector<PostingList> postingLists;
+  for (size_t i = 0; i < lists.size(); ++i)
+    postingLists.push_back(PostingList(data.data() + offsets[i]));
+  // A word not in the vocabulary does not change the result.
+  postingLists.insert(postingLists.begin(), PostingList());
+
+  // Exhaustive evaluation of the quantized lists.
+  map<size_t, float> scores;
+  for (size_t i = 0; i < postingLists.size(); ++i) {
+    vector<Posting> decoded = postingLists[i].decode();
+    for (size_t j = 0; j < decoded.size(); ++j)
+      scores[decoded[j].documentId] += decoded[j].score;
+  }
+  vector<Posting> expected;
+  for (map<size_t, float>::iterator it = scores.begin(); it != scores.end();
+      ++it)
+    expected.push_back(Posting(it->first, it->second));
+  std::sort(expected.begin(), expected.end(), betterThan);
+
+  QueryProcessor::Scratch scratch;
+  size_t ks[] = {1, 10, 100, 1000, 20000};
+  for (size_t j = 0; j < 5; ++j) {
+    // The same scratch buffers for all queries.
+    scratch.lists = postingLists;
+    q.topKUnion(ks[j], &scratch);
+    result = scratch.results;
+    ASSERT_EQ(std::min(ks[j], expected.size()), result.size());
+    for (size_t i = 0; i < result.size(); ++i) {
+      EXPECT_EQ(expected[i].documentId, result[i].documentId);
+      EXPECT_EQ(expected[i].score, result[i].score);
+    }
+  }
+  q.topKUnion(0, &scratch);
+  EXPECT_TRUE(scratch.results.empty());
+  scratch.lists.assign(1, PostingList());
+  q.topKUnion(10, &scratch);
+  EXPECT_TRUE(scratch.results.empty());
+}
+
+// ___________________________________________________________________________
+TEST(QueryProcessor, parseQuery) {
+  vector<string> words;
+  vector<QueryProcessor::Phrase> phrases;
+  QueryProcessor::parseQuery("Marie,curie+ MARIE", &words, &phrases);
+  EXPECT_EQ(vector<string>({"marie", "curie"}), words);
+  EXPECT_TRUE(phrases.empty());
+
+  // Short words of phrases only count for the positions.
+  QueryProcessor::parseQuery("physics \"Theory of Relativity\" theory \"x",
+      &words, &phrases);
+  EXPECT_EQ(vector<string>({"physics", "theory", "relativity"}), words);
+  ASSERT_EQ(2, phrases.size());
+  EXPECT_EQ(vector<size_t>({1, 2}), phrases[0].words);
+  EXPECT_EQ(vector<uint32_t>({0, 2}), phrases[0].offsets);
+  EXPECT_TRUE(phrases[1].words.empty());
+}
+
+// Encode lists of postings with positions (positions[i][j] are the
+// positions of posting j of list i) into scratch.
+void encodeWithPositions(vector<vector<Posting> > const& postings,
+    vector<vector<vector<uint32_t> > > const& positions,
+    FlatVector<uint8_t>* postingData, FlatVector<uint8_t>* positionData,
+    QueryProcessor::Scratch* scratch) {
+  vector<size_t> postingOffsets;
+  vector<size_t> positionOffsets;
+  for (size_t i = 0; i < postings.size(); ++i) {
+    postingOffsets.push_back(PostingList::encode(postings[i], postingData));
+    vector<uint32_t> flat;
+    for (size_t j = 0; j < positions[i].size(); ++j) {
+      flat.push_back(positions[i][j].size());
+      flat.insert(flat.end(), positions[i][j].begin(), positions[i][j].end());
+    }
+    positionOffsets.push_back(PositionList::encode(flat, positionData));
+  }
+  scratch->lists.clear();
+  scratch->positionLists.clear();
+  for (size_t i = 0; i < postings.size(); ++i) {
+    scratch->lists.push_back(
+        PostingList(postingData->data() + postingOffsets[i]));
+    scratch->positionLists.push_back(
+        PositionList(positionData->data() + positionOffsets[i]));
+  }
+}
+
+// ___________________________________________________________________________
+TEST(QueryProcessor, proximityBoost) {
+  vector<vector<Posting> > postings(2, vector<Posting>(1, Posting(0, 1)));
+  vector<vector<vector<uint32_t> > > positions(2);
+  positions[0].push_back({1, 7, 20});
+  positions[1].push_back({4, 12});
+  FlatVector<uint8_t> postingData;
+  FlatVector<uint8_t> positionData;
+  QueryProcessor::Scratch scratch;
+  encodeWithPositions(postings, positions, &postingData, &positionData,
+      &scratch);
+  for (size_t i = 0; i < 2; ++i) {
+    scratch.cursors.push_back(PostingList::Cursor(scratch.lists[i]));
+    scratch.positionCursors.push_back(
+        PositionList::Cursor(scratch.positionLists[i]));
+  }
+
+  // The closest occurrences are 4 and 7.
+  EXPECT_FLOAT_EQ(1 + 0.5 / 3, QueryProcessor::proximityBoost(&scratch));
+  QueryProcessor::Phrase phrase;
+  phrase.words = {1, 0};
+  phrase.offsets = {0, 3};
+  scratch.phrases.push_back(phrase);
+  EXPECT_FLOAT_EQ(1 + 0.5 / 3, QueryProcessor::proximityBoost(&scratch));
+  scratch.phrases[0].offsets[1] = 2;
+  EXPECT_EQ(0, QueryProcessor::proximityBoost(&scratch));
+}
+
+// ___________________________________________________________________________
+TEST(QueryProcessor, topKPositional) {
+  QueryProcessor q;
+  // Three words in overlapping documents, the first two often next to each
+  // other.
+  vector<vector<Posting> > postings(3);
+  vector<vector<vector<uint32_t> > > positions(3);
+  size_t steps[] = {2, 3, 1};
+  for (size_t i = 0; i < 3; ++i) {
+    for (size_t documentId = 0; documentId < 3000;
+        documentId += steps[i]) {
+      postings[i].push_back(Posting(documentId, 1 + (documentId * 7) % 5));
+      uint32_t position = (documentId * (i + 3)) % 11;
+      if (i == 1 && documentId % 4 == 0) position = (documentId * 3) % 11 + 1;
+      positions[i].push_back({position, position + 20});
+    }
+  }
+  FlatVector<uint8_t> postingData;
+  FlatVector<uint8_t> positionData;
+  QueryProcessor::Scratch scratch;
+  encodeWithPositions(postings, positions, &postingData, &positionData,
+      &scratch);
+  vector<PostingList> lists = scratch.lists;
+  QueryProcessor::Phrase phrase;
+  phrase.words = {0, 1};
+  phrase.offsets = {0, 1};
+
+  // Exhaustive evaluation with the same boost.
+  for (size_t withPhrase = 0; withPhrase < 2; ++withPhrase) {
+    scratch.phrases.clear();
+    if (withPhrase) scratch.phrases.push_back(phrase);
+    vector<Posting> expected;
+    scratch.cursors.clear();
+    scratch.positionCursors.clear();
+    for (size_t i = 0; i < 3; ++i) {
+      scratch.cursors.push_back(PostingList::Cursor(lists[i]));
+      scratch.positionCursors.push_back(
+          PositionList::Cursor(scratch.positionLists[i]));
+    }
+    for (size_t documentId = 0; documentId < 3000; documentId += 6) {
+      float score = 1;
+      for (size_t i = 0; i < 3; ++i) {
+        scratch.cursors[i].skipTo(documentId);
+        score *= scratch.cursors[i].score();
+      }
+      float boost = QueryProcessor::proximityBoost(&scratch);
+      if (boost > 0) expected.push_back(Posting(documentId, score * boost));
+    }
+    std::sort(expected.begin(), expected.end(), betterThan);
+    ASSERT_LT(10, expected.size());
+
+    size_t ks[] = {1, 10, 100, 10000};
+    for (size_t j = 0; j < 4; ++j) {
+      q.topKPositional(ks[j], &scratch);
+      result = scratch.results;
+      ASSERT_EQ(std::min(ks[j], expected.size()), result.size());
+      for (size_t i = 0; i < result.size(); ++i) {
+        EXPECT_EQ(expected[i].documentId, result[i].documentId);
+        EXPECT_FLOAT_EQ(expected[i].score, result[i].score);
+      }
+    }
+  }
+}
+
+// ___________________________________________________________________________
+TEST(QueryProcessor, searchSegments) {
+  // The same documents in one segment and in two segments (the lines
+  // behind the first 200).
+  char const* words[] = {"alpha", "beta", "gamma", "delta", "epsilon"};
+  std::ofstream first("QueryProcessorFirst.test.tmp");
+  std::ofstream all("QueryProcessorAll.test.tmp");
+  for (size_t i = 0; i < 300; ++i) {
+    string line = "url" + std::to_string(i) + "\t";
+    for (size_t j = 0; j < 3 + i % 7; ++j)
+      line += string(words[(i * j + i / 3) % 5]) + " ";
+    line += "\n";
+    if (i < 200) first << line;
+    all << line;
+  }
+  first.close();
+  all.close();
+  SegmentedIndex whole;
+  whole.buildFromCsvFile("QueryProcessorAll.test.tmp", 1, true);
+  SegmentedIndex segmented;
+  size_t size = segmented.buildFromCsvFile("QueryProcessorFirst.test.tmp",
+      1, true);
+  std::shared_ptr<InvertedIndex> rest(new InvertedIndex());
+  rest->buildFromCsvFile("QueryProcessorAll.test.tmp", 1, true, size);
+  segmented.addSegment(rest);
+  ASSERT_EQ(2, segmented.numberOfSegments());
+
+  // The scores use the statistics of all segments, so the results are the
+  // same, also after merging the segments.
+  QueryProcessor wholeProcessor;
+  wholeProcessor.init(whole, 3);
+  for (size_t merged = 0; merged < 2; ++merged) {
+    if (merged) segmented.mergeSegments(0, 2);
+    QueryProcessor segmentedProcessor;
+    segmentedProcessor.init(segmented, 3);
+    string queries[] = {"alpha", "beta gamma", "\"delta epsilon\"", "zeta"};
+    for (size_t i = 0; i < 4; ++i) {
+      for (size_t mode = 0; mode < 2; ++mode) {
+        QueryProcessor::Mode m = mode ? QueryProcessor::DISJUNCTIVE
+          : QueryProcessor::CONJUNCTIVE;
+        vector<Posting> expected = wholeProcessor.searchPostings(20,
+            queries[i], m);
+        result = segmentedProcessor.searchPostings(20, queries[i], m);
+        ASSERT_EQ(expected.size(), result.size());
+        for (size_t j = 0; j < result.size(); ++j) {
+          EXPECT_EQ(expected[j].documentId, result[j].documentId);
+          EXPECT_FLOAT_EQ(expected[j].score, result[j].score);
+        }
+      }
+    }
+  }
+}
+
+// ___________________________________________________________________________
+TEST(QueryProcessor, bm25Parameters) {
+  std::ofstream file("QueryProcessorBm25.test.tmp");
+  file << "a\tword\nb\tword word word and more words in this one\n"
+    << "c\tother\n";
+  file.close();
+  SegmentedIndex index;
+  index.setBm25Parameters(1.2, 1);
+  index.buildFromCsvFile("QueryProcessorBm25.test.tmp");
+  QueryProcessor processor;
+  processor.init(index, 3);
+  // With b = 1, the long document is penalized, with b = 0 it is not.
+  result = processor.searchPostings(2, "word");
+  ASSERT_EQ(2, result.size());
+  EXPECT_EQ(0, result[0].documentId);
+  result = processor.searchPostings(2, "word", QueryProcessor::CONJUNCTIVE,
+      index.bm25Parameters(1.2, 0));
+  ASSERT_EQ(2, result.size());
+  EXPECT_EQ(1, result[0].documentId);
+  EXPECT_NEAR(index.bm25(0, 2, index.bm25Parameters(1.2, 0)).score(3, 8),
+      result[0].score, 1e-5);
+}
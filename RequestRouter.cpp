@@ -0,0 +1,51 @@
+// Copyright 2012, Milan Oberkirch
+// Author: Milan Oberkirch <oberkirm@informatik.uni-freiburg.de>
+
+#include "./RequestRouter.h"
+#include <algorithm>
+#include <string>
+#include <utility>
+#include <vector>
+#include "./HttpConnection.h"
+#include "./HttpRequest.h"
+
+// Order prefix routes by length, the longest first.
+static bool longerPrefix(std::pair<string, RequestRouter::Handler> const& a,
+    std::pair<string, RequestRouter::Handler> const& b) {
+  return a.first.size() > b.first.size();
+}
+
+// ___________________________________________________________________________
+void RequestRouter::add(string const& path, Handler const& handler) {
+  if (path.empty() || path[path.size() - 1] != '/') {
+    _paths[path] = handler;
+    return;
+  }
+  for (size_t i = 0; i < _prefixes.size(); ++i) {
+    if (_prefixes[i].first == path) {
+      _prefixes[i].second = handler;
+      return;
+    }
+  }
+  _prefixes.push_back(std::make_pair(path, handler));
+  std::stable_sort(_prefixes.begin(), _prefixes.end(), longerPrefix);
+}
+
+// ___________________________________________________________________________
+bool RequestRouter::route(HttpRequest const& request,
+    HttpConnection::Answer* answer) const {
+  string path;
+  HttpRequest::urlDecode(request.path(), &path, false);
+  auto exact = _paths.find(path);
+  if (exact != _paths.end()) {
+    exact->second(request, answer);
+    return true;
+  }
+  for (size_t i = 0; i < _prefixes.size(); ++i) {
+    if (path.compare(0, _prefixes[i].first.size(), _prefixes[i].first) == 0) {
+      _prefixes[i].second(request, answer);
+      return true;
+    }
+  }
+  return false;
+}
@@ -0,0 +1,40 @@
+// Copyright 2012, Milan Oberkirch
+// Author: Milan Oberkirch <oberkirm@informatik.uni-freiburg.de>
+
+#ifndef REQUESTROUTER_H_
+#define REQUESTROUTER_H_
+
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include "./HttpConnection.h"
+#include "./HttpRequest.h"
+
+using std::string;
+using std::vector;
+
+// Maps the paths of requests to handlers answering them in-process. A route
+// is either a path or a prefix of paths (ending with '/'). Routes must be
+// added before the server starts; routing is thread-safe afterwards.
+class RequestRouter {
+ public:
+  typedef HttpConnection::RequestHandler Handler;
+
+  // Answer requests for path (for all paths starting with path, if it ends
+  // with '/') with handler. Replaces the handler of an existing route.
+  void add(string const& path, Handler const& handler);
+
+  // Answer the request with the handler of the route of its (decoded) path.
+  // Paths match before prefixes, longer prefixes before shorter ones.
+  // Returns false if there is no route for the path.
+  bool route(HttpRequest const& request,
+      HttpConnection::Answer* answer) const;
+
+ private:
+  std::unordered_map<string, Handler> _paths;
+  // The prefix routes, the longest prefix first.
+  vector<std::pair<string, Handler> > _prefixes;
+};
+
+#endif  // REQUESTROUTER_H_
@@ -0,0 +1,57 @@
+// Copyright 2012, Milan Oberkirch
+// Author: Milan Oberkirch <oberkirm@informatik.uni-freiburg.de>
+
+#include <gtest/gtest.h>
+#include <boost/bind/bind.hpp>
+#include <string>
+#include "./HttpConnection.h"
+#include "./HttpRequest.h"
+#include "./RequestRouter.h"
+
+using std::string;
+
+// Answer with the name of the handler and the query.
+void answerWithName(string const& name, HttpRequest const& request,
+    HttpConnection::Answer* answer) {
+  answer->head = name + " " + request.query().to_string();
+}
+
+// A handler answering with its name.
+RequestRouter::Handler handler(string const& name) {
+  return boost::bind(answerWithName, name, boost::placeholders::_1,
+      boost::placeholders::_2);
+}
+
+// Route a GET-request for target, the answer or "none".
+string route(RequestRouter const& router, string const& target) {
+  string buffer = "GET " + target + " HTTP/1.1\r\n\r\n";
+  HttpRequest request;
+  EXPECT_EQ(HttpRequest::COMPLETE, request.parse(buffer.c_str(),
+        buffer.size()));
+  HttpConnection::Answer answer;
+  return router.route(request, &answer) ? answer.head : "none";
+}
+
+// ___________________________________________________________________________
+TEST(RequestRouter, route) {
+  RequestRouter router;
+  EXPECT_EQ("none", route(router, "/"));
+  router.add("/api/search", handler("search"));
+  router.add("/api/", handler("api"));
+  router.add("/api/v2/", handler("v2"));
+  router.add("/status", handler("status"));
+  EXPECT_EQ("search q=a", route(router, "/api/search?q=a"));
+  EXPECT_EQ("search ", route(router, "/api/%73earch"));
+  EXPECT_EQ("api ", route(router, "/api/other"));
+  EXPECT_EQ("api ", route(router, "/api/"));
+  EXPECT_EQ("v2 x=1", route(router, "/api/v2/search?x=1"));
+  EXPECT_EQ("none", route(router, "/api"));
+  EXPECT_EQ("none", route(router, "/status/"));
+  EXPECT_EQ("none", route(router, "/index.html"));
+
+  // Replaced routes.
+  router.add("/status", handler("new status"));
+  router.add("/api/", handler("new api"));
+  EXPECT_EQ("new status ", route(router, "/status"));
+  EXPECT_EQ("new api ", route(router, "/api/other"));
+}
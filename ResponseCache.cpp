@@ -0,0 +1,89 @@
+// Copyright 2012, Milan Oberkirch
+// Author: Milan Oberkirch <oberkirm@informatik.uni-freiburg.de>
+
+#include "./ResponseCache.h"
+#include <algorithm>
+#include <functional>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// ___________________________________________________________________________
+void ResponseCache::init(size_t capacity, size_t numberOfShards) {
+  _shards.clear();
+  _shardCapacity = 0;
+  _hits = 0;
+  _misses = 0;
+  if (capacity == 0) return;
+  numberOfShards = std::max<size_t>(1, std::min(numberOfShards, capacity));
+  for (size_t i = 0; i < numberOfShards; ++i)
+    _shards.push_back(std::unique_ptr<Shard>(new Shard()));
+  _shardCapacity = (capacity + numberOfShards - 1) / numberOfShards;
+}
+
+// ___________________________________________________________________________
+bool ResponseCache::find(string const& key, string* value) {
+  if (_shards.empty()) return false;
+  Shard& keyShard = shard(key);
+  {
+    std::lock_guard<std::mutex> lock(keyShard.mutex);
+    auto position = keyShard.positions.find(key);
+    if (position != keyShard.positions.end()) {
+      keyShard.entries.splice(keyShard.entries.begin(), keyShard.entries,
+          position->second);
+      *value = position->second->value;
+      ++_hits;
+      return true;
+    }
+  }
+  ++_misses;
+  return false;
+}
+
+// ___________________________________________________________________________
+void ResponseCache::insert(string const& key, string const& value) {
+  if (_shards.empty()) return;
+  Shard& keyShard = shard(key);
+  std::lock_guard<std::mutex> lock(keyShard.mutex);
+  auto position = keyShard.positions.find(key);
+  if (position != keyShard.positions.end()) {
+    // Computed by two threads at the same time.
+    position->second->value = value;
+    keyShard.entries.splice(keyShard.entries.begin(), keyShard.entries,
+        position->second);
+    return;
+  }
+  if (keyShard.entries.size() >= _shardCapacity) {
+    keyShard.positions.erase(keyShard.entries.back().key);
+    keyShard.entries.pop_back();
+  }
+  Entry entry = {key, value};
+  keyShard.entries.push_front(entry);
+  keyShard.positions[key] = keyShard.entries.begin();
+}
+
+// ___________________________________________________________________________
+void ResponseCache::clear() {
+  for (size_t i = 0; i < _shards.size(); ++i) {
+    std::lock_guard<std::mutex> lock(_shards[i]->mutex);
+    _shards[i]->entries.clear();
+    _shards[i]->positions.clear();
+  }
+}
+
+// ___________________________________________________________________________
+size_t ResponseCache::size() const {
+  size_t size = 0;
+  for (size_t i = 0; i < _shards.size(); ++i) {
+    std::lock_guard<std::mutex> lock(_shards[i]->mutex);
+    size += _shards[i]->entries.size();
+  }
+  return size;
+}
+
+// ___________________________________________________________________________
+ResponseCache::Shard& ResponseCache::shard(string const& key) {
+  return *_shards[std::hash<string>()(key) % _shards.size()];
+}
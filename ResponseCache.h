@@ -0,0 +1,60 @@
+// Copyright 2012, Milan Oberkirch
+// Author: Milan Oberkirch <oberkirm@informatik.uni-freiburg.de>
+
+#ifndef RESPONSECACHE_H_
+#define RESPONSECACHE_H_
+
+#include <atomic>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+using std::string;
+using std::vector;
+
+// Bounded cache of serialized responses, shared by all server-threads. The
+// keys are split into shards by their hash, each shard is an LRU list with
+// its own lock, so threads rarely wait for each other.
+class ResponseCache {
+ public:
+  ResponseCache() : _shardCapacity(0), _hits(0), _misses(0) {}
+
+  // Remove all entries and hold at most capacity entries from now on (0
+  // disables the cache).
+  void init(size_t capacity, size_t numberOfShards = 16);
+
+  // Set value to the cached value of key. Returns false if there is none.
+  bool find(string const& key, string* value);
+  // Cache value for key, evicting the least recently used entry of its shard
+  // if the shard is full.
+  void insert(string const& key, string const& value);
+  // Remove all entries (e.g. when the index changed).
+  void clear();
+
+  size_t size() const;
+  size_t hits() const { return _hits; }
+  size_t misses() const { return _misses; }
+
+ private:
+  struct Entry {
+    string key;
+    string value;
+  };
+  struct Shard {
+    std::mutex mutex;
+    // The most recently used entry first.
+    std::list<Entry> entries;
+    std::unordered_map<string, std::list<Entry>::iterator> positions;
+  };
+  Shard& shard(string const& key);
+
+  vector<std::unique_ptr<Shard> > _shards;
+  size_t _shardCapacity;
+  std::atomic<size_t> _hits;
+  std::atomic<size_t> _misses;
+};
+
+#endif  // RESPONSECACHE_H_
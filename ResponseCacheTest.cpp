@@ -0,0 +1,64 @@
+// Copyright 2012, Milan Oberkirch
+// Author: Milan Oberkirch <oberkirm@informatik.uni-freiburg.de>
+
+#include <gtest/gtest.h>
+#include <string>
+#include <thread>
+#include <vector>
+#include "./ResponseCache.h"
+
+using std::string;
+using std::vector;
+
+// ___________________________________________________________________________
+TEST(ResponseCache, findAndInsert) {
+  ResponseCache cache;
+  string value;
+  // Disabled until init.
+  cache.insert("a", "1");
+  EXPECT_FALSE(cache.find("a", &value));
+
+  // One shard, so the least recently used entry of all is evicted.
+  cache.init(2, 1);
+  EXPECT_FALSE(cache.find("a", &value));
+  cache.insert("a", "1");
+  cache.insert("b", "2");
+  ASSERT_TRUE(cache.find("a", &value));
+  EXPECT_EQ("1", value);
+  cache.insert("c", "3");
+  EXPECT_FALSE(cache.find("b", &value));
+  ASSERT_TRUE(cache.find("c", &value));
+  EXPECT_EQ("3", value);
+  cache.insert("a", "4");
+  ASSERT_TRUE(cache.find("a", &value));
+  EXPECT_EQ("4", value);
+  EXPECT_EQ(2, cache.size());
+  EXPECT_EQ(3, cache.hits());
+  EXPECT_EQ(2, cache.misses());
+
+  cache.clear();
+  EXPECT_EQ(0, cache.size());
+  EXPECT_FALSE(cache.find("a", &value));
+}
+
+// ___________________________________________________________________________
+TEST(ResponseCache, concurrentAccess) {
+  ResponseCache cache;
+  cache.init(100, 4);
+  vector<std::thread> threads;
+  for (int t = 0; t < 4; ++t) {
+    threads.push_back(std::thread([&cache, t]() {
+      string value;
+      for (int i = 0; i < 10000; ++i) {
+        string key = std::to_string((i * 7 + t) % 150);
+        if (!cache.find(key, &value))
+          cache.insert(key, "value of " + key);
+        else
+          EXPECT_EQ("value of " + key, value);
+      }
+    }));
+  }
+  for (size_t t = 0; t < threads.size(); ++t) threads[t].join();
+  EXPECT_EQ(40000, cache.hits() + cache.misses());
+  EXPECT_GE(100, cache.size());
+}
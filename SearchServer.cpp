@@ -2,20 +2,35 @@
 // Author: Milan Oberkirch <oberkirm@informatik.uni-freiburg.de>
 
 #include "./SearchServer.h"
+#include <sys/stat.h>
 #include <unistd.h>
 #include <boost/asio.hpp>
 #include <boost/program_options.hpp>
+#include <boost/bind/bind.hpp>
 #include <boost/algorithm/string.hpp>
-#include <boost/algorithm/string/replace.hpp>
 #include <numeric>
 #include <algorithm>
-#include <ctime>
+#include <chrono>
+#include <cmath>
 #include <map>
+#include <memory>
 #include <string>
+#include <thread>
 #include <vector>
 #include <stdexcept>
+#include "./AccessLog.h"
+#include "./HttpConnection.h"
+#include "./HttpRequest.h"
+#include "./IndexFile.h"
 #include "./InvertedIndex.h"
+#include "./JsonWriter.h"
+#include "./Posting.h"
 #include "./QueryProcessor.h"
+#include "./RequestRouter.h"
+#include "./ResponseCache.h"
+#include "./SegmentedIndex.h"
+#include "./SnippetGenerator.h"
+#include "./StaticFiles.h"
 
 using std::cout;
 using std::endl;
@@ -28,75 +43,44 @@ using std::ifstream;
 using std::cout;
 namespace po = boost::program_options;
 
+// The prefix of the headers written by beginHttp200 and the width of the
+// Content-Length, which is filled in when the content is complete.
+static const char http200Prefix[] = "HTTP/1.1 200 OK\r\n"
+  "Server: SearchServer 0.1\r\n"
+  "Content-Length: ";
+static const size_t contentLengthWidth = 10;
+
 // ___________________________________________________________________________
-string SearchServer::http200(
-    string const& content, string const& mimeType) {
-  std::stringstream answer;
-  answer << "HTTP/1.0 200 OK\r\n"
-    << "Server: SearchServer 0.1\r\n"
-    << "Content-Length: " << content.size() << "\r\n"
-    << "Content-Language: en\r\n"
-    << "Content-Type: " << mimeType  << "; charset=utf-8\r\n"
-    << "Connection: close\r\n"
-    << "\r\n"
-    << content;
-  return answer.str();
+size_t SearchServer::beginHttp200(string const& mimeType, bool keepAlive,
+    string* answer) {
+  size_t begin = answer->size();
+  answer->append(http200Prefix);
+  answer->append(contentLengthWidth, ' ');
+  answer->append("\r\nContent-Language: en\r\nContent-Type: ");
+  answer->append(mimeType);
+  answer->append("; charset=utf-8\r\nConnection: ");
+  answer->append(keepAlive ? "keep-alive" : "close");
+  answer->append("\r\n\r\n");
+  return begin;
 }
 
 // ___________________________________________________________________________
-string SearchServer::http200(
-    string const& filePath) {
-  string suffix = filePath.substr(filePath.rfind('.') + 1);
-  std::transform(suffix.begin(), suffix.end(), suffix.begin(), ::tolower);
-
-  if (suffix == "py" || suffix == "php") {
-    string cmd;
-    if (suffix == "php")
-      string cmd = "php " + filePath;
-    else
-      cmd = "python " + filePath;
-    FILE* pipe = popen(cmd.c_str(), "r");
-    if (!pipe) return "ERROR";
-    char buffer[128];
-    std::string result = "";
-    while (!feof(pipe)) {
-      if (fgets(buffer, 128, pipe) != NULL)
-        result += buffer;
-    }
-    pclose(pipe);
-    return http200(result, "text/html");
-  }
-
-  map<string, string> mimeTypes = {
-    {"jpg", "image/jpeg"},
-    {"png", "image/png"},
-    {"ico", "image/image/vnd.microsoft.icon"},
-    {"html", "text/html"},
-    {"css", "text/css"},
-    {"less", "text/x-less"},
-    {"js", "application/javascript"}
-  };
-
-  string mimeType = mimeTypes[suffix];
-  if (mimeType.empty())
-    throw Error501("Unknown Filetype \"" + suffix + "\"");
-
-  std::ifstream file(filePath.c_str());
-  string content;
-
-  file.seekg(0, std::ios::end);
-  content.reserve(file.tellg());
-  file.seekg(0, std::ios::beg);
-
-  content.assign((std::istreambuf_iterator<char>(file)),
-      std::istreambuf_iterator<char>());
-
-  return http200(content, mimeType);
+void SearchServer::endHttp200(size_t begin, string* answer) {
+  size_t contentBegin = answer->find("\r\n\r\n", begin) + 4;
+  size_t contentLength = answer->size() - contentBegin;
+  // The digits right-aligned in the spaces reserved by beginHttp200 (the
+  // leading spaces are optional white space to HTTP).
+  size_t position = begin + sizeof(http200Prefix) - 1 + contentLengthWidth;
+  do {
+    (*answer)[--position] = '0' + contentLength % 10;
+    contentLength /= 10;
+  } while (contentLength > 0);
 }
 
 // ___________________________________________________________________________
 string SearchServer::http418(
-    string const& content = "") {
+    string const& content, bool keepAlive) {
+  _metrics.increment(Metrics::ERRORS);
   std::stringstream contentStream;
   contentStream << "<!DOCTYPE html>" << endl
     << "<html>"
@@ -107,10 +91,10 @@ string SearchServer::http418(
     << content
     << "</p></body></html>";
   std::stringstream answer;
-  answer << "HTTP/1.0 418 I'm a teapot\r\n"
+  answer << "HTTP/1.1 418 I'm a teapot\r\n"
     << "Content-Length: " << contentStream.str().size() << "\r\n"
     << "Content-Type: text/html" << "\r\n"
-    << "Connection: close\r\n"
+    << "Connection: " << (keepAlive ? "keep-alive" : "close") << "\r\n"
     << "\r\n"
     << contentStream.str();
   return answer.str();
@@ -120,7 +104,8 @@ string SearchServer::http418(
 void SearchServer::parse(int argc, char** argv) {
   // Number of Arguments expected:
   int8_t _minArgs = 2;
-  int8_t _maxArgs = 6;
+  int8_t _maxArgs = 20;
+  unsigned int hardwareThreads = std::thread::hardware_concurrency();
   std::stringstream defaults;
   defaults << "Defaults:"
     << "\n\tweb-root = " << (_webRoot = "www")
@@ -128,10 +113,19 @@ void SearchServer::parse(int argc, char** argv) {
     << "\n\tnumber-of-results = " << (_numberOfResults = 10)
     << "\n\tbm25k = " << (_bm25k = 1.75)
     << "\n\tbm25b = " << (_bm25b = 0.75)
+    << "\n\tthreads = "
+    << (_numberOfThreads = hardwareThreads ? hardwareThreads : 1)
+    << "\n\tkeep-alive-timeout = " << (_keepAliveTimeout = 15)
+    << "\n\tcache-size = " << (_cacheSize = 10000)
+    << "\n\taccess-log = " << (_accessLogFile = "-")
+    << "\n\tlog-level = " << AccessLog::levelName(_logLevel = AccessLog::INFO)
+    << "\n\tlog-sample = " << (_logSampleRate = 1)
+    << "\n\tlog-max-size = " << (_logMaxBytes = 0)
     << endl;
 
   string optionsPrefix =
     "Usage: ./SearchServerMain <input-file> <port> [Options]\n" +
+    string("       ./SearchServerMain <input-file> --index-out <file>\n") +
     string("Options are");
 
   po::options_description allOptions("");
@@ -140,18 +134,54 @@ void SearchServer::parse(int argc, char** argv) {
   po::options_description generalOptions("General Options");
   po::options_description searchOptions("Search");
   po::options_description editDistanceOptions("Edit-Distance");
+  po::options_description indexFileOptions("Index-File");
+  po::options_description logOptions("Logging");
 
   generalOptions.add_options()
     ("help,h", "Show this message and exit")
-    ("web-root,w", po::value<string>(), "Path to folder with files to serve.");
+    ("web-root,w", po::value<string>(), "Path to folder with files to serve.")
+    ("threads,t", po::value<unsigned int>(),
+     "Number of threads building the index and answering requests "
+     "concurrently.")
+    ("keep-alive-timeout", po::value<size_t>(),
+     "Seconds an idle persistent connection is kept open.")
+    ("cache-size", po::value<size_t>(),
+     "Number of answers to queries kept in memory (0 disables caching).");
+  logOptions.add_options()
+    ("access-log", po::value<string>(),
+     "File to log the requests to (\"-\" for the standard output). It is "
+     "written by a background thread and opened again on SIGHUP.")
+    ("log-level", po::value<string>(),
+     "off, error (only errors), info (also the requests) or debug (also "
+     "the files served).")
+    ("log-sample", po::value<size_t>(),
+     "Log only every n-th request (errors are always logged).")
+    ("log-max-size", po::value<size_t>(),
+     "Rotate the access-log when it has more than this many MB (0 for "
+     "never). Five old files are kept.");
   editDistanceOptions.add_options()
     ("k-gram-length,k", po::value<unsigned int>(),
      "The k from k-gram. See http://en.wikipedia.org/wiki/N-gram.");
+  indexFileOptions.add_options()
+    ("index-out,o", po::value<string>(),
+     "Build the index from the CSV-file, write it to the given binary "
+     "index-file and exit.")
+    ("index-in,i",
+     "The input-file is a binary index-file written with --index-out (which "
+     "is mapped into memory instead of building the index).");
   searchOptions.add_options()
     ("results,r", po::value<size_t>(),
      "Set number of results to send to client.")
     ("bm25b,b", po::value<float>(), "Set the b-value of the BM25-Algorithm.")
-    ("bm25k,n", po::value<float>(), "Set the k-value of the BM25-Algorithm.");
+    ("bm25k,n", po::value<float>(), "Set the k-value of the BM25-Algorithm.")
+    ("precompute-scores",
+     "Store the BM25 scores with --bm25k and --bm25b in the index as well "
+     "(also for --index-out). Queries with these values are answered "
+     "faster while the index has one segment.")
+    ("positions",
+     "Store the positions of the words in the records (in addition to the "
+     "inverted lists). Enables phrase queries (words in double quotes) and "
+     "ranks records higher the closer the words of a query are in them.");
   hiddenOptions.add_options()
     ("input-file", po::value<string>(), "(CSV-)File with data to search in.")
     ("port,p", po::value<unsigned int>(), "Port to listen on");
@@ -159,7 +189,9 @@ void SearchServer::parse(int argc, char** argv) {
   visibleOptions
     .add(generalOptions)
     .add(editDistanceOptions)
-    .add(searchOptions);
+    .add(searchOptions)
+    .add(indexFileOptions)
+    .add(logOptions);
   allOptions.add(visibleOptions).add(hiddenOptions);
 
   po::positional_options_description positionalOptions;
@@ -197,9 +229,14 @@ void SearchServer::parse(int argc, char** argv) {
 // ___________________________________________________________________________
 void SearchServer::setOptions() {
   // _vocabularyFileName = optionVariables["vocabulary-file"].as<string>();
+  _readIndexFile = _optionVariables.count("index-in");
+  if (_optionVariables.count("index-out"))
+    _indexOutFile = _optionVariables["index-out"].as<string>();
+  if (_readIndexFile && !_indexOutFile.empty())
+    throw po::error("--index-in and --index-out exclude each other.");
   if (_optionVariables.count("port"))
     _port = _optionVariables["port"].as<unsigned int>();
-  else
+  else if (_indexOutFile.empty())
     throw po::error("No port given.");
   if (_optionVariables.count("k-gram-length"))
     _k = _optionVariables["k-gram-length"].as<unsigned int>();
@@ -209,227 +246,588 @@ void SearchServer::setOptions() {
     _bm25b = _optionVariables["bm25b"].as<float>();
   if (_optionVariables.count("bm25k"))
     _bm25k = _optionVariables["bm25k"].as<float>();
+  _storePositions = _optionVariables.count("positions");
+  _precomputeScores = _optionVariables.count("precompute-scores");
   if (_optionVariables.count("input-file"))
     _file = _optionVariables["input-file"].as<string>();
   else
     throw po::error("No input-file given");
   if (_optionVariables.count("web-root"))
     _webRoot = _optionVariables["web-root"].as<string>();
+  if (_optionVariables.count("threads"))
+    _numberOfThreads =
+      std::max(1u, _optionVariables["threads"].as<unsigned int>());
+  if (_optionVariables.count("keep-alive-timeout"))
+    _keepAliveTimeout = _optionVariables["keep-alive-timeout"].as<size_t>();
+  if (_optionVariables.count("cache-size"))
+    _cacheSize = _optionVariables["cache-size"].as<size_t>();
+  if (_optionVariables.count("access-log"))
+    _accessLogFile = _optionVariables["access-log"].as<string>();
+  if (_optionVariables.count("log-level")
+      && !AccessLog::parseLevel(_optionVariables["log-level"].as<string>(),
+        &_logLevel))
+    throw po::error("Unknown log-level.");
+  if (_optionVariables.count("log-sample"))
+    _logSampleRate = _optionVariables["log-sample"].as<size_t>();
+  if (_optionVariables.count("log-max-size"))
+    _logMaxBytes = _optionVariables["log-max-size"].as<size_t>() << 20;
 }
 
 // ___________________________________________________________________________
 void SearchServer::run() {
-  cout << "Building index of posts ... " << flush << endl;
-  _invertedIndex.buildFromCsvFile(_file, _bm25k, _bm25b);
-  cout << "Building index of vocabulary ... " << flush << endl;
-  _queryProcessor.init(_invertedIndex, _k);
+  std::shared_ptr<Snapshot> snapshot;
+  try {
+    snapshot = buildSnapshot(0);
+    if (!_indexOutFile.empty()) {
+      cout << "Writing index file " << _indexOutFile << " ... " << endl;
+      IndexFileWriter file(_indexOutFile);
+      snapshot->index.writeToFile(&file);
+      snapshot->queryProcessor.writeToFile(&file);
+      file.close();
+      return;
+    }
+  } catch(const IndexFileError& e) {
+    cerr << "Error: " << e.what() << endl;
+    exit(1);
+  }
+  std::atomic_store(&_snapshot, std::shared_ptr<Snapshot const>(snapshot));
+  if (!_accessLog.open(_accessLogFile, _logLevel, _logSampleRate,
+        _logMaxBytes)) {
+    cerr << "Error: cannot open access-log " << _accessLogFile << endl;
+    exit(1);
+  }
+  _responseCache.init(_cacheSize);
+  _router.add("/api/search", boost::bind(&SearchServer::answerApiSearch,
+        this, boost::placeholders::_1, boost::placeholders::_2));
+  _router.add("/metrics", boost::bind(&SearchServer::answerMetrics,
+        this, boost::placeholders::_1, boost::placeholders::_2));
   cout << "Starting up Server-Loop ... " << endl;
   runServer();
 }
 
+// ___________________________________________________________________________
+std::shared_ptr<SearchServer::Snapshot> SearchServer::buildSnapshot(
+    size_t generation) {
+  // The query processor refers to the index, so the snapshot is not moved.
+  std::shared_ptr<Snapshot> snapshot(new Snapshot());
+  snapshot->generation = generation;
+  snapshot->index.setBm25Parameters(_bm25k, _bm25b);
+  snapshot->index.precomputeScores(_precomputeScores);
+  if (_readIndexFile) {
+    cout << "Mapping index file ... " << flush << endl;
+    std::shared_ptr<IndexFileReader> file(new IndexFileReader(_file));
+    snapshot->index.readFromFile(file);
+    snapshot->queryProcessor.initFromFile(snapshot->index, file);
+    snapshot->queryProcessor.setMetrics(&_metrics);
+  } else {
+    cout << "Building index of posts ... " << flush << endl;
+    _indexedSize = snapshot->index.buildFromCsvFile(_file, _numberOfThreads,
+        _storePositions);
+    _indexedEnd = readIndexedEnd();
+    cout << "Building index of vocabulary ... " << flush << endl;
+    snapshot->queryProcessor.setMetrics(&_metrics);
+    snapshot->queryProcessor.init(snapshot->index, _k);
+  }
+  return snapshot;
+}
+
+// ___________________________________________________________________________
+std::shared_ptr<SearchServer::Snapshot const> SearchServer::extendSnapshot(
+    std::shared_ptr<Snapshot const> const& snapshot) {
+  if (readIndexedEnd() != _indexedEnd) return NULL;
+  std::shared_ptr<InvertedIndex> segment(new InvertedIndex());
+  size_t size = segment->buildFromCsvFile(_file, _numberOfThreads,
+      _storePositions, _indexedSize);
+  if (segment->numberOfDocuments() == 0) return snapshot;
+  cout << "Indexed " << segment->numberOfDocuments()
+    << " new documents." << endl;
+  std::shared_ptr<Snapshot> extended(new Snapshot());
+  extended->generation = snapshot->generation + 1;
+  extended->index = snapshot->index;
+  extended->index.addSegment(segment);
+  extended->queryProcessor.setMetrics(&_metrics);
+  extended->queryProcessor.init(extended->index, _k);
+  _indexedSize = size;
+  _indexedEnd = readIndexedEnd();
+  return extended;
+}
+
+// ___________________________________________________________________________
+std::shared_ptr<SearchServer::Snapshot const> SearchServer::mergeSnapshot(
+    Snapshot const& snapshot) {
+  size_t begin;
+  size_t end;
+  if (!snapshot.index.mergeCandidates(&begin, &end)) return NULL;
+  cout << "Merging segments " << begin << " to " << end - 1 << " ..."
+    << endl;
+  std::shared_ptr<Snapshot> merged(new Snapshot());
+  merged->generation = snapshot.generation + 1;
+  merged->index = snapshot.index;
+  merged->index.mergeSegments(begin, end);
+  merged->queryProcessor.setMetrics(&_metrics);
+  merged->queryProcessor.init(merged->index, _k);
+  return merged;
+}
+
+// ___________________________________________________________________________
+string SearchServer::readIndexedEnd() const {
+  size_t size = std::min<size_t>(_indexedSize, 256);
+  std::ifstream file(_file.c_str(), std::ios::binary);
+  file.seekg(_indexedSize - size);
+  string end(size, '\0');
+  file.read(&end[0], size);
+  end.resize(file.gcount());
+  return end;
+}
+
+// ___________________________________________________________________________
+bool SearchServer::reload() {
+  if (_reloading.exchange(true)) return false;
+  std::thread(&SearchServer::rebuildSnapshot, this).detach();
+  return true;
+}
+
+// ___________________________________________________________________________
+void SearchServer::rebuildSnapshot() {
+  try {
+    std::shared_ptr<Snapshot const> current = snapshot();
+    std::shared_ptr<Snapshot const> next;
+    if (!_readIndexFile) next = extendSnapshot(current);
+    if (next == current) {
+      cout << "No new documents in " << _file << "." << endl;
+    } else {
+      if (!next) next = buildSnapshot(current->generation + 1);
+      setSnapshot(next);
+    }
+    // Merge small segments (one merge per snapshot, so requests can use
+    // the new documents in the meantime).
+    while ((next = mergeSnapshot(*snapshot()))) setSnapshot(next);
+  } catch(const std::exception& e) {
+    // Keep the old index if the new one cannot be built.
+    cerr << "\x1b[31mReloading " << _file << " failed: " << e.what()
+      << "\x1b[0m" << endl;
+  }
+  _reloading = false;
+}
+
+// ___________________________________________________________________________
+void SearchServer::setSnapshot(
+    std::shared_ptr<Snapshot const> const& snapshot) {
+  std::atomic_store(&_snapshot, snapshot);
+  _responseCache.clear();
+  cout << "Switched to snapshot " << snapshot->generation << " ("
+    << snapshot->index.numberOfDocuments() << " documents in "
+    << snapshot->index.numberOfSegments() << " segments)." << endl;
+}
+
+// ___________________________________________________________________________
+void SearchServer::waitForSignal(boost::asio::signal_set* signals) {
+  signals->async_wait(boost::bind(&SearchServer::handleSignal, this,
+        signals, boost::asio::placeholders::error));
+}
+
+// ___________________________________________________________________________
+void SearchServer::handleSignal(boost::asio::signal_set* signals,
+    boost::system::error_code const& error) {
+  if (error) return;
+  _accessLog.reopen();
+  cout << "Received SIGHUP, reloading " << _file << " ..." << endl;
+  if (!reload()) cout << "A reload is running already." << endl;
+  waitForSignal(signals);
+}
+
+// ___________________________________________________________________________
+void SearchServer::addRoute(string const& path,
+    HttpConnection::RequestHandler const& handler) {
+  _router.add(path, handler);
+}
+
 // ___________________________________________________________________________
 void SearchServer::runServer() {
   try {
     // Create socket and bind to and listen on given port.
-    boost::asio::io_service io_service;
-    tcp::acceptor acceptor(io_service, tcp::endpoint(tcp::v4(), _port));
-
-    // Wait for requests and process them.
-    int i = 0;
-    while (true) {
-      // Wait for request.
-      cout << "\x1b[1m\x1b[34m[" << (++i) << "] Waiting for query on port "
-        << _port << " ... \x1b[0m" << flush;
-      tcp::socket socket(io_service);
-      acceptor.accept(socket);
-      std::time_t now = std::time(0);
-      std::string daytime = std::ctime(&now);  // NOLINT
-      cout << "done, received new request on " << daytime << std::flush;
-
-      // Get the request string.
-      std::vector<char> requestBuffer(1000);
-      boost::system::error_code read_error;
-      socket.read_some(boost::asio::buffer(requestBuffer), read_error);
-      std::string request(requestBuffer.size(), 0);
-      std::copy(requestBuffer.begin(), requestBuffer.end(), request.begin());
-      for (size_t i = 0; i < request.size(); i++) {
-        request[i] = isspace(request[i]) ? ' ' : request[i];
-      }
-      cout << "request string is \"" << (request.size() < 99 ? request :
-          request.substr(0, 87) + "...") << "\"" << endl;
-
-      string answer;
-
-      // Parse URL
-      replaceUrlCodes(&request);
-      size_t argPos = request.find("?");
-      if (argPos == string::npos) {
-        try {
-          string path = getFilePath(request);
-          cout << "path: " << path << endl;
-          answer = http200(path);
-        } catch(const Error501& e) {
-          cerr << "\x1b[31m" << e.what() << "\x1b[0m" << endl << flush;
-          answer = http418(e.what());
-        } catch(const Error404& e) {
-          cerr << "\x1b[31m" << e.what() << "\x1b[0m" << endl << flush;
-          answer = http418(e.what());
-        }
-      } else {
-        std::string query;
-        std::ostringstream jsonp;
-        size_t numberOfResults = atoi(getValue(request, "number").c_str());
-        // Is it a vocabulary-lookup?
-        if ((query = getValue(request, "vocabularyLookup")).size()) {
-          cout << "vocabularyLookup: query string is \"" << query
-            << "\"; number: results requested: " << numberOfResults << endl;
-          vector<string> matches =
-            _queryProcessor.similarWords(numberOfResults, query);
-          // Send a JSONP object containing the answer.
-          jsonp << "similarWordsCallback({" << "\"matches\":[";
-          for (vector<string>::iterator it = matches.begin();
-              it < matches.end();
-              ++it) {
-            jsonp << "\"" << *it << "\"";
-            if (it + 1 != matches.end())
-              jsonp << ",";
-          }
-          jsonp << "]});";
-        }
-        if ((query = getValue(request, "searchQuery")).size()) {
-          cout << "searchQuery: query string is \"" << query << "\"" << endl;
-          vector<size_t> recordIds =
-            _queryProcessor.searchRecords(numberOfResults, query);
-          jsonp << "searchRecordsCallback({" << "\"matches\":[";
-          for (vector<size_t>::iterator it = recordIds.begin();
-              it < recordIds.end(); ++it) {
-            jsonp << "\"" << _invertedIndex.getUrlFromId(*it) << "\"";
-            if (it + 1 != recordIds.end())
-              jsonp << ",";
-          }
-          jsonp << " ]});";
-        }
-        answer = http200(jsonp.str(), "application/javascript");
+    boost::asio::io_service ioService;
+    tcp::acceptor acceptor(ioService, tcp::endpoint(tcp::v4(), _port));
+    _requestCounter = 0;
+    startAccept(&acceptor, &ioService);
+    boost::asio::signal_set signals(ioService, SIGHUP);
+    waitForSignal(&signals);
+
+    // Wait for requests and process them in _numberOfThreads threads.
+    cout << "\x1b[1m\x1b[34mWaiting for queries on port " << _port
+      << " (" << _numberOfThreads << " threads) ... \x1b[0m" << endl;
+    vector<std::thread> threads;
+    for (unsigned int i = 1; i < _numberOfThreads; ++i)
+      threads.push_back(std::thread(
+            &SearchServer::runIoService, this, &ioService));
+    runIoService(&ioService);
+    for (size_t i = 0; i < threads.size(); ++i)
+      threads[i].join();
+  } catch(const std::exception& e) {
+    cerr << e.what() << endl;
+  }
+}
+
+// ___________________________________________________________________________
+void SearchServer::runIoService(boost::asio::io_service* ioService) {
+  while (true) {
+    try {
+      ioService->run();
+      return;
+    } catch(const std::exception& e) {
+      // Exceptions of one request must not stop the thread.
+      cerr << "\x1b[31m" << e.what() << "\x1b[0m" << endl;
+    }
+  }
+}
+
+// ___________________________________________________________________________
+void SearchServer::startAccept(tcp::acceptor* acceptor,
+    boost::asio::io_service* ioService) {
+  std::shared_ptr<HttpConnection> connection(new HttpConnection(ioService,
+        boost::bind(&SearchServer::answerRequest, this,
+          boost::placeholders::_1, boost::placeholders::_2),
+        _keepAliveTimeout));
+  acceptor->async_accept(connection->socket(),
+      boost::bind(&SearchServer::handleAccept, this, connection,
+        acceptor, ioService, boost::asio::placeholders::error));
+}
+
+// ___________________________________________________________________________
+void SearchServer::handleAccept(std::shared_ptr<HttpConnection> connection,
+    tcp::acceptor* acceptor, boost::asio::io_service* ioService,
+    boost::system::error_code const& error) {
+  if (!error) connection->start();
+  startAccept(acceptor, ioService);
+}
+
+// ___________________________________________________________________________
+void SearchServer::answerRequest(HttpRequest const& request,
+    HttpConnection::Answer* answer) {
+  Metrics::Timer requestTimer(&_metrics, Metrics::REQUEST);
+  size_t id = ++_requestCounter;
+  if (!_accessLog.sample(AccessLog::INFO)) {
+    routeRequest(request, id, answer);
+    return;
+  }
+  std::chrono::steady_clock::time_point start =
+    std::chrono::steady_clock::now();
+  routeRequest(request, id, answer);
+  int64_t microseconds = std::chrono::duration_cast<
+    std::chrono::microseconds>(std::chrono::steady_clock::now() - start)
+    .count();
+  // The status is behind "HTTP/1.1 ".
+  string_view status = answer->head.size() >= 12
+    ? string_view(answer->head).substr(9, 3) : string_view("-");
+  static thread_local string entry;
+  entry.assign("id=").append(std::to_string(id)).append(" status=")
+    .append(status.data(), status.size()).append(" us=")
+    .append(std::to_string(microseconds)).append(" request=");
+  AccessLog::appendQuoted(request.requestLine(), &entry);
+  _accessLog.log(AccessLog::INFO, entry);
+}
+
+// ___________________________________________________________________________
+void SearchServer::routeRequest(HttpRequest const& request, size_t id,
+    HttpConnection::Answer* answer) {
+  bool keepAlive = request.keepAlive();
+  if (_router.route(request, answer)) return;
+  if (request.query().empty()) {
+    try {
+      string path = getFilePath(request.path());
+      if (_accessLog.enabled(AccessLog::DEBUG)) {
+        string entry = "id=" + std::to_string(id) + " path=";
+        AccessLog::appendQuoted(path, &entry);
+        _accessLog.log(AccessLog::DEBUG, entry);
       }
+      answerFile(path, request, answer);
+    } catch(const Error501& e) {
+      logError(id, e.what());
+      answer->head = http418(e.what(), keepAlive);
+    } catch(const Error404& e) {
+      logError(id, e.what());
+      answer->head = http418(e.what(), keepAlive);
+    }
+  } else {
+    std::string query;
+    std::string number;
+    request.parameter("number", &number);
+    size_t numberOfResults = atoi(number.c_str());
+    size_t begin = beginHttp200("application/javascript", keepAlive,
+        &answer->head);
+    // Is it a vocabulary-lookup?
+    if (request.parameter("vocabularyLookup", &query) && query.size())
+      appendVocabularyLookupAnswer(query, numberOfResults, &answer->head);
+    if (request.parameter("searchQuery", &query) && query.size()) {
+      // With mode=or records matching any of the words are found.
+      std::string mode;
+      request.parameter("mode", &mode);
+      appendSearchQueryAnswer(query, searchMode(mode), numberOfResults,
+          &answer->head);
+    }
+    endHttp200(begin, &answer->head);
+  }
+}
+
+// ___________________________________________________________________________
+void SearchServer::logError(size_t id, string const& message) {
+  string entry = "id=" + std::to_string(id) + " error=";
+  AccessLog::appendQuoted(message, &entry);
+  _accessLog.log(AccessLog::ERROR, entry);
+}
 
-      boost::system::error_code write_error;
-      boost::asio::write(socket, boost::asio::buffer(answer),
-          boost::asio::transfer_all(), write_error);
+// ___________________________________________________________________________
+void SearchServer::answerApiSearch(HttpRequest const& request,
+    HttpConnection::Answer* answer) {
+  string query;
+  string number;
+  string mode;
+  string snippets;
+  string callback;
+  string bm25k;
+  string bm25b;
+  request.parameter("q", &query);
+  request.parameter("mode", &mode);
+  request.parameter("snippets", &snippets);
+  request.parameter("callback", &callback);
+  size_t numberOfResults = request.parameter("number", &number)
+    ? atoi(number.c_str()) : _numberOfResults;
+  float k = request.parameter("k1", &bm25k) ? atof(bm25k.c_str()) : _bm25k;
+  float b = request.parameter("b", &bm25b) ? atof(bm25b.c_str()) : _bm25b;
+  if (!std::isfinite(k) || !std::isfinite(b)) {
+    answer->head = http418("Invalid BM25 parameters.", request.keepAlive());
+    return;
+  }
+  // The callback is executed by the client, so it must be a name.
+  for (size_t i = 0; i < callback.size(); ++i) {
+    unsigned char c = callback[i];
+    if (!isalnum(c) && c != '_' && c != '.' && c != '$') {
+      answer->head = http418("Invalid callback.", request.keepAlive());
+      return;
     }
-  } catch(const std::exception& e) {
-    cerr << e.what() << endl;
   }
+
+  size_t begin = beginHttp200(callback.empty()
+      ? "application/json" : "application/javascript", request.keepAlive(),
+      &answer->head);
+  if (!callback.empty()) answer->head.append(callback).append("(");
+  appendApiSearchAnswer(query, searchMode(mode), numberOfResults,
+      snippets == "1", k, b, &answer->head);
+  if (!callback.empty()) answer->head.append(");");
+  endHttp200(begin, &answer->head);
 }
 
 // ___________________________________________________________________________
-string SearchServer::getValue(string const& request, string const& name) const {
-  std::stringstream searchTerm;
-  searchTerm << name << "=";
-  size_t prefixLength = name.size() + 1;
-  size_t pos1 = request.find(searchTerm.str());
-  size_t pos2 = std::min(request.find("&", pos1), request.find(" HTTP", pos1));
-  if (pos1 == string::npos || pos2 == string::npos)
-    return "";
-  else
-    return request.substr(pos1 + prefixLength, pos2 - pos1 - prefixLength);
+void SearchServer::answerMetrics(HttpRequest const& request,
+    HttpConnection::Answer* answer) {
+  std::shared_ptr<Snapshot const> snapshot = this->snapshot();
+  SegmentedIndex const& index = snapshot->index;
+  size_t postingBytes = 0;
+  size_t positionBytes = 0;
+  for (size_t i = 0; i < index.numberOfSegments(); ++i) {
+    postingBytes += index.segment(i).postingBytes();
+    positionBytes += index.segment(i).positionBytes();
+  }
+  // Prometheus expects version 0.0.4 of its text format.
+  size_t begin = beginHttp200("text/plain; version=0.0.4",
+      request.keepAlive(), &answer->head);
+  string* out = &answer->head;
+  _metrics.writePrometheus(out);
+  Metrics::appendMetric("searchserver_requests_total", "counter",
+      "Requests received.", _requestCounter, out);
+  Metrics::appendMetric("searchserver_cache_hits_total", "counter",
+      "Answers found in the cache.", _responseCache.hits(), out);
+  Metrics::appendMetric("searchserver_cache_misses_total", "counter",
+      "Answers not found in the cache.", _responseCache.misses(), out);
+  Metrics::appendMetric("searchserver_cache_entries", "gauge",
+      "Answers in the cache.", _responseCache.size(), out);
+  Metrics::appendMetric("searchserver_index_generation", "gauge",
+      "Number of the current snapshot of the index.", snapshot->generation,
+      out);
+  Metrics::appendMetric("searchserver_index_documents", "gauge",
+      "Documents in the index.", index.numberOfDocuments(), out);
+  Metrics::appendMetric("searchserver_index_segments", "gauge",
+      "Segments of the index.", index.numberOfSegments(), out);
+  Metrics::appendMetric("searchserver_index_words", "gauge",
+      "Words in the index.", index.words().size(), out);
+  Metrics::appendMetric("searchserver_index_posting_bytes", "gauge",
+      "Size of the compressed inverted lists.", postingBytes, out);
+  Metrics::appendMetric("searchserver_index_position_bytes", "gauge",
+      "Size of the compressed positions.", positionBytes, out);
+  Metrics::appendMetric("searchserver_fuzzy_index_build_seconds", "gauge",
+      "Time spent building the index of similar words.",
+      snapshot->queryProcessor.approximateMatching().indexCreationTime(),
+      out);
+  endHttp200(begin, out);
 }
 
 // ___________________________________________________________________________
-string SearchServer::getFilePath(string const& request) const {
-  size_t pos1 = request.find("GET /") + 4;
-  size_t pos2 = std::min(request.find("?", pos1), request.find(" HTTP", pos1));
-  if (pos1 - 4 == string::npos || pos2 == string::npos)
-    throw Error501("Error parsing request: " + request);
-  std::stringstream path;
-  path << _webRoot << request.substr(pos1, pos2 - pos1);
-  if (path.str()[path.str().size() - 1] == '/') path << "index.html";
+void SearchServer::answerFile(string const& filePath,
+    HttpRequest const& request, HttpConnection::Answer* answer) {
+  bool keepAlive = request.keepAlive();
+  if (StaticFiles::mimeType(filePath).empty())
+    throw Error501("Unknown Filetype \""
+        + filePath.substr(filePath.rfind('.') + 1) + "\"");
+  if (!_staticFiles.answer(filePath, request, keepAlive, answer))
+    throw Error404(filePath);
+}
 
-  ifstream f(path.str().c_str());
-  if (f.is_open())
-    return path.str();
-  else
-    throw Error404(path.str());
+// ___________________________________________________________________________
+void SearchServer::appendVocabularyLookupAnswer(string const& query,
+    size_t numberOfResults, string* answer) {
+  _metrics.increment(Metrics::VOCABULARY_LOOKUPS);
+  std::shared_ptr<Snapshot const> snapshot = this->snapshot();
+  // The answer keeps the case of the query.
+  string key = std::to_string(snapshot->generation) + "v"
+    + std::to_string(numberOfResults) + "\t" + query;
+  string cached;
+  if (_responseCache.find(key, &cached)) {
+    answer->append(cached);
+    return;
+  }
+
+  vector<string> matches =
+    snapshot->queryProcessor.similarWords(numberOfResults, query);
+  // Send a JSONP object containing the answer.
+  Metrics::Timer serializeTimer(&_metrics, Metrics::SERIALIZE);
+  size_t begin = answer->size();
+  answer->append("similarWordsCallback(");
+  JsonWriter json(answer);
+  json.beginObject();
+  json.key("matches");
+  json.beginArray();
+  for (size_t i = 0; i < matches.size(); ++i) json.value(matches[i]);
+  json.endArray();
+  json.endObject();
+  answer->append(");");
+  _responseCache.insert(key, answer->substr(begin));
 }
 
 // ___________________________________________________________________________
-size_t SearchServer::maxEditDistance(string const& query) {
-  return ceil(query.size() / 5.0);
+QueryProcessor::Mode SearchServer::searchMode(string const& mode) {
+  return boost::algorithm::iequals(mode, "or")
+    ? QueryProcessor::DISJUNCTIVE : QueryProcessor::CONJUNCTIVE;
 }
 
 // ___________________________________________________________________________
-void SearchServer::replaceUrlCodes(string* request) {
-  map<string, string> urlToString = {
-    {"%20", " "},
-    {"+", " "},
-    {"%22", "\""},
-    {"%7E", "~"},
-    {"%C3%A4", "ä"},
-    {"%C3%96", "A"},
-    {"%C3%B6", "ö"},
-    {"%C3%96", "Ö"},
-    {"%C3%BC", "ü"},
-    {"%C3%PC", "Ü"}
-  };
-
-  for (map<string, string>::const_iterator it = urlToString.begin();
-      it != urlToString.end();
-      ++it) {
-    size_t position = 0;
-    while (
-        (position = request->find(it->first, position)) &&
-        position != std::string::npos) {
-      request->replace(
-          position, it->first.length(), it->second);
-      position += it->second.size();
+char const* SearchServer::modeName(QueryProcessor::Mode mode) {
+  return mode == QueryProcessor::DISJUNCTIVE ? "or" : "and";
+}
+
+// ___________________________________________________________________________
+void SearchServer::appendSearchQueryAnswer(string const& query,
+    QueryProcessor::Mode mode, size_t numberOfResults, string* answer) {
+  _metrics.increment(Metrics::SEARCHES);
+  std::shared_ptr<Snapshot const> snapshot = this->snapshot();
+  // Searches do not depend on the case of the query.
+  string key = std::to_string(snapshot->generation) + "s"
+    + std::to_string(numberOfResults) + modeName(mode) + "\t"
+    + boost::algorithm::to_lower_copy(query);
+  string cached;
+  if (_responseCache.find(key, &cached)) {
+    answer->append(cached);
+    return;
+  }
+
+  vector<size_t> recordIds = snapshot->queryProcessor.searchRecords(
+      numberOfResults, query, mode);
+  Metrics::Timer serializeTimer(&_metrics, Metrics::SERIALIZE);
+  size_t begin = answer->size();
+  answer->append("searchRecordsCallback(");
+  JsonWriter json(answer);
+  json.beginObject();
+  json.key("matches");
+  json.beginArray();
+  for (size_t i = 0; i < recordIds.size(); ++i)
+    json.value(snapshot->index.url(recordIds[i]));
+  json.endArray();
+  json.endObject();
+  answer->append(");");
+  _responseCache.insert(key, answer->substr(begin));
+}
+
+// ___________________________________________________________________________
+void SearchServer::appendApiSearchAnswer(string const& query,
+    QueryProcessor::Mode mode, size_t numberOfResults, bool snippets,
+    float bm25k, float bm25b, string* answer) {
+  _metrics.increment(Metrics::SEARCHES);
+  std::shared_ptr<Snapshot const> snapshot = this->snapshot();
+  // The query is written for each request, only the hits (which do not
+  // depend on the case of the query) are cached.
+  answer->append("{\"query\":\"");
+  JsonWriter::appendEscaped(query, answer);
+  answer->append("\",\"mode\":\"").append(modeName(mode))
+    .append("\",\"hits\":");
+  string key = std::to_string(snapshot->generation) + "a"
+    + std::to_string(numberOfResults) + modeName(mode)
+    + (snippets ? "+" : "-") + std::to_string(bm25k) + ","
+    + std::to_string(bm25b) + "\t" + boost::algorithm::to_lower_copy(query);
+  string cached;
+  if (_responseCache.find(key, &cached)) {
+    answer->append(cached).append("}");
+    return;
+  }
+
+  vector<Posting> hits = bm25k == _bm25k && bm25b == _bm25b
+    ? snapshot->queryProcessor.searchPostings(numberOfResults, query, mode)
+    : snapshot->queryProcessor.searchPostings(numberOfResults, query, mode,
+        snapshot->index.bm25Parameters(bm25k, bm25b));
+  // Including the snippets.
+  Metrics::Timer serializeTimer(&_metrics, Metrics::SERIALIZE);
+  SnippetGenerator snippetGenerator(query);
+  vector<SnippetGenerator::Match> matches;
+  size_t begin = answer->size();
+  JsonWriter json(answer);
+  json.beginArray();
+  for (size_t i = 0; i < hits.size(); ++i) {
+    json.beginObject();
+    json.key("id");
+    json.value(static_cast<uint64_t>(hits[i].documentId));
+    json.key("url");
+    json.value(snapshot->index.url(hits[i].documentId));
+    json.key("score");
+    json.value(static_cast<double>(hits[i].score));
+    if (snippets) {
+      json.key("snippet");
+      json.value(snippetGenerator.snippet(
+            snapshot->index.record(hits[i].documentId), &matches));
+      // The query words in the snippet as [offset, length] in bytes.
+      json.key("highlights");
+      json.beginArray();
+      for (size_t j = 0; j < matches.size(); ++j) {
+        json.beginArray();
+        json.value(static_cast<uint64_t>(matches[j].first));
+        json.value(static_cast<uint64_t>(matches[j].second));
+        json.endArray();
+      }
+      json.endArray();
     }
+    json.endObject();
   }
+  json.endArray();
+  _responseCache.insert(key, answer->substr(begin));
+  answer->append("}");
 }
 
+// ___________________________________________________________________________
+string SearchServer::getFilePath(string_view const& path) const {
+  string decodedPath;
+  HttpRequest::urlDecode(path, &decodedPath, false);
+  // Only serve files inside of the web-root.
+  if (decodedPath.empty() || decodedPath[0] != '/' ||
+      decodedPath.find("..") != string::npos)
+    throw Error404(decodedPath);
+  string filePath = _webRoot + decodedPath;
+  if (filePath[filePath.size() - 1] == '/') filePath += "index.html";
+
+  struct stat info;
+  if (stat(filePath.c_str(), &info) == 0 && S_ISREG(info.st_mode))
+    return filePath;
+  else
+    throw Error404(filePath);
+}
 
-/*
-   try {
-   while (it < request.end()) {
-   while (it < request.end() and *it != '%') result << *it++;
-   if (*++it == '2') {
-   if (*++it == '0')
-   result << ' ';
-   else if (*it == '2')
-   result << "\"";
-   else
-   throw Error501("Error: Unvalid URL-Code");
-   ++it;
-   } else if (*it == '7') {
-   if (*++it == 'E')
-   result << '~';
-   else
-   throw Error501("Error: Unvalid URL-Code");
-   ++it;
-   } else if (*it == 'C') {
-   if (*++it != '%')
-   throw Error501("Error: Unvalid umlaut in URL.");
-   if (*++it == 'A' or *it == 'B') {
-   if (*++it == '4')
-   result << "ä";
-   else if (*it == '6')
-   result << "ö";
-   else if (*it == 'C')
-   result << "ü";
-   } else {
-   if (*++it != '8' and *it != '9')
-   throw Error501("Error: Unvalid capital umlaut in URL.");
-   if (*++it == '4')
-   result << "Ä";
-   else if (*it == '6')
-   result << "Ö";
-   else if (*it == 'C')
-   result << "Ü";
-   }
-   } else {
-   throw Error501("Error: Unvalid URL-Code");
-   }
-   }
-   } catch(const int&) {
-   throw Error501("Error replacing URL-Codes.");
-   }
-   return result.str();
-   */
+// ___________________________________________________________________________
+size_t SearchServer::maxEditDistance(string const& query) {
+  return ceil(query.size() / 5.0);
+}
@@ -8,19 +8,46 @@
 #include <unistd.h>
 #include <boost/asio.hpp>
 #include <boost/program_options.hpp>
+#include <atomic>
 #include <fstream>  // NOLINT
+#include <memory>
 #include <stdexcept>
 #include <string>
 #include <vector>
+#include "./AccessLog.h"
+#include "./HttpConnection.h"
+#include "./HttpRequest.h"
+#include "./IndexFile.h"
 #include "./InvertedIndex.h"
+#include "./Metrics.h"
 #include "./QueryProcessor.h"
+#include "./RequestRouter.h"
+#include "./ResponseCache.h"
+#include "./SegmentedIndex.h"
+#include "./StaticFiles.h"
 
 using boost::asio::ip::tcp;
 namespace po = boost::program_options;
 
 class SearchServer {
-  InvertedIndex _invertedIndex;
-  QueryProcessor _queryProcessor;
+  // An index of the records with its vocabulary. Requests use the snapshot
+  // current when they arrive until they are answered, reloading swaps in a
+  // new one.
+  struct Snapshot {
+    SegmentedIndex index;
+    QueryProcessor queryProcessor;
+    // Counts the snapshots (cached answers of older ones are not used).
+    size_t generation;
+  };
+  // The current snapshot (only accessed with std::atomic_load and
+  // std::atomic_store).
+  std::shared_ptr<Snapshot const> _snapshot;
+  // Whether a new snapshot is built in the background.
+  std::atomic<bool> _reloading;
+  // The number of bytes of the CSV-file in the current snapshot and the
+  // last of them (to recognize whether lines were only appended to it).
+  size_t _indexedSize;
+  string _indexedEnd;
 
   string _usage;
   int8_t _minArgs;
@@ -28,6 +55,10 @@ class SearchServer {
   po::variables_map _optionVariables;
 
   string _file;
+  // Whether _file is a binary index file instead of a CSV-file.
+  bool _readIndexFile;
+  // Write the index to this file instead of serving queries.
+  string _indexOutFile;
   unsigned int _port;
   string _webRoot;
 
@@ -35,10 +66,46 @@ class SearchServer {
   size_t _numberOfResults;
   float _bm25k;
   float _bm25b;
+  // Whether the index stores the positions of words (for phrases).
+  bool _storePositions;
+  // Whether the index stores BM25 scores (see SegmentedIndex).
+  bool _precomputeScores;
+  unsigned int _numberOfThreads;
+  size_t _keepAliveTimeout;
+
+  // Number of requests received so far (shared by all server-threads).
+  std::atomic<size_t> _requestCounter;
+  // The requests (with their status and duration) and errors.
+  AccessLog _accessLog;
+  string _accessLogFile;
+  AccessLog::Level _logLevel;
+  size_t _logSampleRate;
+  size_t _logMaxBytes;
+  // The answers to recent queries (without HTTP-headers).
+  ResponseCache _responseCache;
+  size_t _cacheSize;
+  // The files of the web-root.
+  StaticFiles _staticFiles;
+  // Handlers of dynamic pages.
+  RequestRouter _router;
+  // Latencies and counts of the requests (see answerMetrics).
+  Metrics _metrics;
 
  public:
+  SearchServer() : _reloading(false), _indexedSize(0) {}
   void parse(int argc, char** argv);
   void run();
+  // Build the index from the input-file again in a background thread and
+  // swap it in when it is complete (the server does this on SIGHUP). If
+  // lines were only appended to the CSV-file, only they are indexed (as a
+  // new segment, see SegmentedIndex), and small segments are merged
+  // afterwards. Requests are answered with the old index meanwhile.
+  // Returns false if a reload is running already.
+  bool reload();
+  // Answer requests for path (or all paths starting with it, if it ends with
+  // '/') in-process with handler (see RequestRouter). Call before run.
+  void addRoute(string const& path,
+      HttpConnection::RequestHandler const& handler);
 
  private:
   class Error404 : public std::runtime_error  {
@@ -51,22 +118,95 @@ class SearchServer {
     explicit Error501(string message) : std::runtime_error(message) {}
   };
 
-  // Add HTTP-headers to strings.
-  string http200(string const& filePath);
-  string http200(string const& content, string const& mimeType);
-  string http418(string const& content);
+  // Add HTTP-headers to strings. keepAlive is the value of the
+  // Connection-header (keep-alive or close). Counts the error.
+  string http418(string const& content, bool keepAlive);
+  // Append the HTTP-headers of an answer with status 200 to answer, which
+  // starts at the returned position. The content is appended afterwards,
+  // endHttp200 fills in its length.
+  FRIEND_TEST(SearchServer, http200);
+  static size_t beginHttp200(string const& mimeType, bool keepAlive,
+      string* answer);
+  static void endHttp200(size_t begin, string* answer);
   // Set the Options read by parse
   void setOptions();
+  // The current snapshot.
+  std::shared_ptr<Snapshot const> snapshot() const {
+    return std::atomic_load(&_snapshot);
+  }
+  // Build the index of the input-file (or read it from the index file).
+  std::shared_ptr<Snapshot> buildSnapshot(size_t generation);
+  // The snapshot with the lines appended to the CSV-file since it was
+  // indexed as new segment (snapshot itself if there are none, NULL if the
+  // file was changed otherwise).
+  std::shared_ptr<Snapshot const> extendSnapshot(
+      std::shared_ptr<Snapshot const> const& snapshot);
+  // The snapshot with segments of snapshot merged (NULL if none should be
+  // merged).
+  std::shared_ptr<Snapshot const> mergeSnapshot(Snapshot const& snapshot);
+  // The last bytes of the first _indexedSize bytes of the CSV-file.
+  string readIndexedEnd() const;
+  // Build new snapshots and swap them in (in the reload-thread).
+  void rebuildSnapshot();
+  // Swap in a new snapshot. Requests still using the old one keep it until
+  // they are answered.
+  void setSnapshot(std::shared_ptr<Snapshot const> const& snapshot);
+  // Reload on SIGHUP.
+  void waitForSignal(boost::asio::signal_set* signals);
+  void handleSignal(boost::asio::signal_set* signals,
+      boost::system::error_code const& error);
   // Compute the default for maxEditDistance (ceil(|w|/5))
   size_t maxEditDistance(string const& query);
   // Server-loop
   void runServer();
-  // Replace URL-Codes
-  void replaceUrlCodes(string* request);
-  // Extract value of an query
-  string getValue(string const& request, string const& name) const;
-  // Extract path of an query check if file exists.
-  string getFilePath(string const& request) const;
+  // Accept the next connection asynchronously.
+  void startAccept(tcp::acceptor* acceptor,
+      boost::asio::io_service* ioService);
+  // Start the accepted connection and wait for the next one.
+  void handleAccept(std::shared_ptr<HttpConnection> connection,
+      tcp::acceptor* acceptor, boost::asio::io_service* ioService,
+      boost::system::error_code const& error);
+  // Run the event-loop of ioService in the current thread.
+  void runIoService(boost::asio::io_service* ioService);
+  // Compute the answer (including HTTP-headers) to a request and log it
+  // (see AccessLog).
+  void answerRequest(HttpRequest const& request,
+      HttpConnection::Answer* answer);
+  // Compute the answer to the request with the given number.
+  void routeRequest(HttpRequest const& request, size_t id,
+      HttpConnection::Answer* answer);
+  // Log an error of the request with the given number.
+  void logError(size_t id, string const& message);
+  // Answer a request for a file in the web-root.
+  void answerFile(string const& filePath, HttpRequest const& request,
+      HttpConnection::Answer* answer);
+  // Answer a request of the JSON-API (/api/search?q=...). See README.
+  void answerApiSearch(HttpRequest const& request,
+      HttpConnection::Answer* answer);
+  // Answer a request for the metrics of the server (/metrics) in the text
+  // format of Prometheus: the counters and latency histograms of the
+  // requests and the size of the index and of the cache.
+  void answerMetrics(HttpRequest const& request,
+      HttpConnection::Answer* answer);
+  // The mode of a search given as parameter mode (DISJUNCTIVE for "or" in
+  // any case, CONJUNCTIVE otherwise) and its name in cache keys and
+  // answers.
+  FRIEND_TEST(SearchServer, searchMode);
+  static QueryProcessor::Mode searchMode(string const& mode);
+  static char const* modeName(QueryProcessor::Mode mode);
+  // Append the JSONP answers to vocabulary lookups and searches of the
+  // web-frontend and the JSON answers to the API (from the cache if
+  // possible).
+  void appendVocabularyLookupAnswer(string const& query,
+      size_t numberOfResults, string* answer);
+  void appendSearchQueryAnswer(string const& query,
+      QueryProcessor::Mode mode, size_t numberOfResults, string* answer);
+  void appendApiSearchAnswer(string const& query, QueryProcessor::Mode mode,
+      size_t numberOfResults, bool snippets, float bm25k, float bm25b,
+      string* answer);
+  // Map the (URL-encoded) path of a request to a file in the web-root and
+  // check if the file exists.
+  string getFilePath(string_view const& path) const;
 };
 
 #endif  // SEARCHSERVER_H_
@@ -0,0 +1,50 @@
+// Copyright 2012, Milan Oberkirch
+// Author: Milan Oberkirch <oberkirm@informatik.uni-freiburg.de>
+
+#include <gtest/gtest.h>
+#include <string>
+#include "./SearchServer.h"
+
+using std::string;
+
+// ___________________________________________________________________________
+TEST(SearchServer, http200) {
+  // Appended to an answer in the buffer.
+  string answer = "previous";
+  size_t begin = SearchServer::beginHttp200("application/json", true,
+      &answer);
+  EXPECT_EQ(8, begin);
+  answer += "{\"a\":1}";
+  SearchServer::endHttp200(begin, &answer);
+  EXPECT_EQ("previousHTTP/1.1 200 OK\r\n"
+      "Server: SearchServer 0.1\r\n"
+      "Content-Length:          7\r\n"
+      "Content-Language: en\r\n"
+      "Content-Type: application/json; charset=utf-8\r\n"
+      "Connection: keep-alive\r\n"
+      "\r\n"
+      "{\"a\":1}", answer);
+
+  answer.clear();
+  begin = SearchServer::beginHttp200("text/html", false, &answer);
+  SearchServer::endHttp200(begin, &answer);
+  EXPECT_NE(string::npos, answer.find("Content-Length:          0\r\n"));
+  EXPECT_NE(string::npos, answer.find("Connection: close\r\n"));
+  answer.append(12345, 'x');
+  SearchServer::endHttp200(begin, &answer);
+  EXPECT_NE(string::npos, answer.find("Content-Length:      12345\r\n"));
+}
+
+// ___________________________________________________________________________
+TEST(SearchServer, searchMode) {
+  EXPECT_EQ(QueryProcessor::DISJUNCTIVE, SearchServer::searchMode("or"));
+  EXPECT_EQ(QueryProcessor::DISJUNCTIVE, SearchServer::searchMode("OR"));
+  EXPECT_EQ(QueryProcessor::CONJUNCTIVE, SearchServer::searchMode(""));
+  EXPECT_EQ(QueryProcessor::CONJUNCTIVE, SearchServer::searchMode("and"));
+  EXPECT_EQ(QueryProcessor::CONJUNCTIVE, SearchServer::searchMode("xor"));
+  // Cache keys and answers use one name for each mode.
+  EXPECT_EQ(string("or"),
+      SearchServer::modeName(SearchServer::searchMode("Or")));
+  EXPECT_EQ(string("and"),
+      SearchServer::modeName(SearchServer::searchMode("AND")));
+}
@@ -0,0 +1,216 @@
+// Copyright 2012, Milan Oberkirch
+// Author: Milan Oberkirch <oberkirm@informatik.uni-freiburg.de>
+
+#include "./SegmentedIndex.h"
+#include <stdint.h>
+#include <boost/utility/string_view.hpp>
+#include <algorithm>
+#include <functional>
+#include <memory>
+#include <queue>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+#include "./Bm25.h"
+#include "./IndexFile.h"
+#include "./InvertedIndex.h"
+#include "./PostingList.h"
+#include "./TermDictionary.h"
+
+// ___________________________________________________________________________
+SegmentedIndex::SegmentedIndex()
+  : _firstDocumentIds(1, 0), _averageLength(0), _bm25k(1.75),
+    _bm25b(0.75), _bm25Parameters(_bm25k, _bm25b, 0),
+    _precomputeScores(false) {
+}
+
+// ___________________________________________________________________________
+size_t SegmentedIndex::buildFromCsvFile(string const& fileName,
+    unsigned int numberOfThreads, bool storePositions) {
+  std::shared_ptr<InvertedIndex> segment(new InvertedIndex());
+  if (_precomputeScores) segment->precomputeScores(_bm25k, _bm25b);
+  size_t size = segment->buildFromCsvFile(fileName, numberOfThreads,
+      storePositions);
+  _segments.assign(1, segment);
+  update();
+  return size;
+}
+
+// ___________________________________________________________________________
+void SegmentedIndex::addSegment(
+    std::shared_ptr<InvertedIndex const> const& segment) {
+  _segments.push_back(segment);
+  update();
+}
+
+// ___________________________________________________________________________
+bool SegmentedIndex::mergeCandidates(size_t* begin, size_t* end) const {
+  *end = _segments.size();
+  *begin = *end ? *end - 1 : 0;
+  size_t size = *begin < *end ? _segments[*begin]->numberOfDocuments() : 0;
+  while (*begin > 0
+      && _segments[*begin - 1]->numberOfDocuments() <= 2 * size) {
+    --*begin;
+    size += _segments[*begin]->numberOfDocuments();
+  }
+  return *end - *begin > 1;
+}
+
+// ___________________________________________________________________________
+void SegmentedIndex::mergeSegments(size_t begin, size_t end) {
+  vector<InvertedIndex const*> segments;
+  for (size_t i = begin; i < end; ++i) segments.push_back(_segments[i].get());
+  std::shared_ptr<InvertedIndex> merged(new InvertedIndex());
+  if (_precomputeScores) merged->precomputeScores(_bm25k, _bm25b);
+  merged->merge(segments);
+  _segments.erase(_segments.begin() + begin, _segments.begin() + end);
+  _segments.insert(_segments.begin() + begin, merged);
+  update();
+}
+
+// ___________________________________________________________________________
+void SegmentedIndex::setBm25Parameters(float k, float b) {
+  _bm25k = k;
+  _bm25b = b;
+  _bm25Parameters = bm25Parameters(k, b);
+}
+
+// ___________________________________________________________________________
+void SegmentedIndex::precomputeScores(bool precompute) {
+  _precomputeScores = precompute;
+}
+
+// ___________________________________________________________________________
+Bm25::Parameters SegmentedIndex::bm25Parameters(float k, float b) const {
+  return Bm25::Parameters(k, b, _averageLength);
+}
+
+// ___________________________________________________________________________
+Bm25 SegmentedIndex::bm25(size_t i, size_t documentFrequency) const {
+  return bm25(i, documentFrequency, _bm25Parameters);
+}
+
+// ___________________________________________________________________________
+Bm25 SegmentedIndex::bm25(size_t i, size_t documentFrequency,
+    Bm25::Parameters const& parameters) const {
+  return Bm25(parameters, numberOfDocuments(), documentFrequency,
+      _segments[i]->documentLengths());
+}
+
+// ___________________________________________________________________________
+PostingList SegmentedIndex::postingList(size_t i, size_t wordId,
+    size_t documentFrequency, Bm25::Parameters const& parameters) const {
+  InvertedIndex const& segment = *_segments[i];
+  // Scores are precomputed with the statistics of the segment alone.
+  if (_segments.size() == 1 && segment.hasPrecomputedScores(parameters))
+    return segment.postingList(wordId, PostingList::PRECOMPUTED_SCORES);
+  return segment.postingList(wordId, bm25(i, documentFrequency, parameters));
+}
+
+// ___________________________________________________________________________
+TermDictionary const& SegmentedIndex::words() const {
+  return _segments.size() == 1 ? _segments[0]->words() : _words;
+}
+
+// ___________________________________________________________________________
+size_t SegmentedIndex::documentFrequency(size_t wordId) const {
+  if (_segments.size() == 1) return _segments[0]->postingList(wordId).size();
+  return _documentFrequencies[wordId];
+}
+
+// ___________________________________________________________________________
+bool SegmentedIndex::hasPositions() const {
+  // Segments without words have no positions either.
+  bool hasPositions = false;
+  for (size_t i = 0; i < _segments.size(); ++i) {
+    if (_segments[i]->hasPositions())
+      hasPositions = true;
+    else if (!_segments[i]->words().empty())
+      return false;
+  }
+  return hasPositions;
+}
+
+// ___________________________________________________________________________
+size_t SegmentedIndex::segmentOf(size_t documentId) const {
+  if (documentId >= numberOfDocuments())
+    throw std::out_of_range("Document id out of range.");
+  return std::upper_bound(_firstDocumentIds.begin(), _firstDocumentIds.end(),
+      documentId) - _firstDocumentIds.begin() - 1;
+}
+
+// ___________________________________________________________________________
+string_view SegmentedIndex::url(size_t id) const {
+  size_t i = segmentOf(id);
+  return _segments[i]->url(id - _firstDocumentIds[i]);
+}
+
+// ___________________________________________________________________________
+string_view SegmentedIndex::record(size_t id) const {
+  size_t i = segmentOf(id);
+  return _segments[i]->record(id - _firstDocumentIds[i]);
+}
+
+// ___________________________________________________________________________
+void SegmentedIndex::update() {
+  _firstDocumentIds.assign(1, 0);
+  uint64_t totalLength = 0;
+  for (size_t i = 0; i < _segments.size(); ++i) {
+    _firstDocumentIds.push_back(_firstDocumentIds.back()
+        + _segments[i]->numberOfDocuments());
+    totalLength += _segments[i]->totalLength();
+  }
+  _averageLength = numberOfDocuments()
+    ? static_cast<float>(totalLength) / numberOfDocuments() : 0;
+  _bm25Parameters = bm25Parameters(_bm25k, _bm25b);
+
+  _words.clear();
+  _documentFrequencies.clear();
+  if (_segments.size() <= 1) return;
+  // Merge the sorted vocabularies: a heap with the next word of each
+  // segment, the smallest on top.
+  typedef std::pair<string, size_t> Entry;
+  std::priority_queue<Entry, vector<Entry>, std::greater<Entry> > heap;
+  vector<size_t> nextIds(_segments.size(), 0);
+  for (size_t i = 0; i < _segments.size(); ++i) {
+    if (_segments[i]->words().empty()) continue;
+    heap.push(Entry(_segments[i]->words()[0], i));
+    nextIds[i] = 1;
+  }
+  string lastWord;
+  while (!heap.empty()) {
+    Entry top = heap.top();
+    heap.pop();
+    size_t i = top.second;
+    if (_words.empty() || top.first != lastWord) {
+      _words.push_back(top.first);
+      _documentFrequencies.push_back(0);
+      lastWord = top.first;
+    }
+    _documentFrequencies[_documentFrequencies.size() - 1] +=
+      _segments[i]->postingList(nextIds[i] - 1).size();
+    TermDictionary const& words = _segments[i]->words();
+    if (nextIds[i] < words.size()) heap.push(Entry(words[nextIds[i]++], i));
+  }
+}
+
+// ___________________________________________________________________________
+void SegmentedIndex::writeToFile(IndexFileWriter* file) const {
+  file->writeValue<uint64_t>(_segments.size());
+  for (size_t i = 0; i < _segments.size(); ++i)
+    _segments[i]->writeToFile(file);
+}
+
+// ___________________________________________________________________________
+void SegmentedIndex::readFromFile(
+    std::shared_ptr<IndexFileReader> const& file) {
+  _segments.clear();
+  uint64_t numberOfSegments = file->readValue<uint64_t>();
+  for (size_t i = 0; i < numberOfSegments; ++i) {
+    std::shared_ptr<InvertedIndex> segment(new InvertedIndex());
+    segment->readFromFile(file);
+    _segments.push_back(segment);
+  }
+  update();
+}
@@ -0,0 +1,119 @@
+// Copyright 2012, Milan Oberkirch
+// Author: Milan Oberkirch <oberkirm@informatik.uni-freiburg.de>
+
+#ifndef SEGMENTEDINDEX_H_
+#define SEGMENTEDINDEX_H_
+
+#include <gtest/gtest.h>
+#include <stdint.h>
+#include <boost/utility/string_view.hpp>
+#include <memory>
+#include <string>
+#include <vector>
+#include "./Bm25.h"
+#include "./FlatVector.h"
+#include "./IndexFile.h"
+#include "./InvertedIndex.h"
+#include "./PostingList.h"
+#include "./TermDictionary.h"
+
+using boost::string_view;
+using std::string;
+using std::vector;
+
+// An index made of segments (see InvertedIndex), which do not change once
+// they are built: the documents of each segment follow those of the segment
+// in front of it. New documents are added as a new segment, so adding them
+// takes time proportional to them and not to the whole collection. The
+// segments hold term frequencies, the BM25 scores are computed at query
+// time from the statistics of all segments (with the parameters of the
+// index or of the query). Small segments are merged into
+// larger ones (see mergeCandidates), so there are only logarithmically many.
+// Copies of the index share their segments.
+class SegmentedIndex {
+ public:
+  SegmentedIndex();
+
+  // Build the index of a CSV file as the only segment (see
+  // InvertedIndex::buildFromCsvFile).
+  size_t buildFromCsvFile(string const& fileName,
+      unsigned int numberOfThreads = 1, bool storePositions = false);
+  // Add a segment behind the others.
+  void addSegment(std::shared_ptr<InvertedIndex const> const& segment);
+  // Whether segments should be merged, and which ones ([begin, end)). The
+  // last segments are merged while the segment in front of them has at
+  // most twice as many documents as they have together, so each document
+  // is merged a logarithmic number of times.
+  bool mergeCandidates(size_t* begin, size_t* end) const;
+  // Replace the segments [begin, end) by one segment with their documents.
+  void mergeSegments(size_t begin, size_t end);
+
+  size_t numberOfSegments() const { return _segments.size(); }
+  InvertedIndex const& segment(size_t i) const { return *_segments[i]; }
+  // The id of the first document of segment i (the ids of the documents of
+  // a segment are shifted by it).
+  size_t firstDocumentId(size_t i) const { return _firstDocumentIds[i]; }
+  size_t numberOfDocuments() const { return _firstDocumentIds.back(); }
+
+  // The parameters of BM25 (see Bm25), 1.75 and 0.75 by default.
+  void setBm25Parameters(float k, float b);
+  // Whether segments built or merged by the index get scores precomputed
+  // with these parameters (see InvertedIndex::precomputeScores), false by
+  // default.
+  void precomputeScores(bool precompute);
+  // The parameters of the index, or other ones, with the average length of
+  // the documents of all segments.
+  Bm25::Parameters const& bm25Parameters() const { return _bm25Parameters; }
+  Bm25::Parameters bm25Parameters(float k, float b) const;
+  // The scores of the postings of segment i for a word contained in
+  // documentFrequency documents of all segments.
+  Bm25 bm25(size_t i, size_t documentFrequency) const;
+  Bm25 bm25(size_t i, size_t documentFrequency,
+      Bm25::Parameters const& parameters) const;
+  // The inverted list of the word with the given id in segment i, scored
+  // like by bm25. The precomputed scores of the segment are used instead
+  // if they are the same, which is only the case while it is the only
+  // segment.
+  PostingList postingList(size_t i, size_t wordId, size_t documentFrequency,
+      Bm25::Parameters const& parameters) const;
+
+  // The words of all segments (the id of a word is its position) and the
+  // number of documents containing each of them.
+  TermDictionary const& words() const;
+  size_t documentFrequency(size_t wordId) const;
+  // Whether the segments have the positions of the words.
+  bool hasPositions() const;
+
+  // The URL and the text of a record (see InvertedIndex).
+  string_view url(size_t id) const;
+  string_view record(size_t id) const;
+
+  // Append the segments to a binary index file.
+  void writeToFile(IndexFileWriter* file) const;
+  // Read the segments written by writeToFile.
+  void readFromFile(std::shared_ptr<IndexFileReader> const& file);
+
+ private:
+  // Compute the statistics and the vocabulary of the segments again.
+  FRIEND_TEST(SegmentedIndex, addSegment);
+  void update();
+  // The segment containing the document with the given id.
+  size_t segmentOf(size_t documentId) const;
+
+  vector<std::shared_ptr<InvertedIndex const> > _segments;
+  // The first document id of each segment, followed by the number of
+  // documents.
+  vector<size_t> _firstDocumentIds;
+  float _averageLength;
+  float _bm25k;
+  float _bm25b;
+  Bm25::Parameters _bm25Parameters;
+  bool _precomputeScores;
+  // The words of all segments and their document frequencies, only if
+  // there is more than one segment (otherwise those of the segment are
+  // used).
+  TermDictionary _words;
+  FlatVector<uint32_t> _documentFrequencies;
+};
+
+#endif  // SEGMENTEDINDEX_H_
@@ -0,0 +1,164 @@
+// Copyright 2012, Milan Oberkirch
+// Author: Milan Oberkirch <oberkirm@informatik.uni-freiburg.de>
+
+#include <gtest/gtest.h>
+#include <fstream>  // NOLINT
+#include <memory>
+#include <string>
+#include <vector>
+#include "./Bm25.h"
+#include "./IndexFile.h"
+#include "./InvertedIndex.h"
+#include "./Posting.h"
+#include "./SegmentedIndex.h"
+
+using std::string;
+using std::vector;
+
+const char firstFileName[] = "SegmentedIndexFirst.test.tmp";
+const char secondFileName[] = "SegmentedIndexSecond.test.tmp";
+const char indexFileName[] = "SegmentedIndex.index.test.tmp";
+
+// Write a file with the given lines.
+void writeFile(char const* fileName, string const& lines) {
+  std::ofstream file(fileName);
+  file << lines;
+}
+
+// A segment of the documents in a file with the given lines.
+std::shared_ptr<InvertedIndex> createSegment(char const* fileName,
+    string const& lines) {
+  writeFile(fileName, lines);
+  std::shared_ptr<InvertedIndex> segment(new InvertedIndex());
+  segment->buildFromCsvFile(fileName);
+  return segment;
+}
+
+// ___________________________________________________________________________
+TEST(SegmentedIndex, addSegment) {
+  SegmentedIndex index;
+  writeFile(firstFileName, "a\tthe first document\nb\tthe second one\n");
+  index.buildFromCsvFile(firstFileName);
+  EXPECT_EQ(1, index.numberOfSegments());
+  EXPECT_EQ(2, index.numberOfDocuments());
+  // With one segment, its vocabulary is used.
+  EXPECT_EQ(&index.segment(0).words(), &index.words());
+  EXPECT_TRUE(index._words.empty());
+
+  index.addSegment(createSegment(secondFileName,
+        "c\tanother document\nd\tthe last\ne\tnothing\n"));
+  ASSERT_EQ(2, index.numberOfSegments());
+  EXPECT_EQ(5, index.numberOfDocuments());
+  EXPECT_EQ(2, index.firstDocumentId(1));
+  EXPECT_EQ("a", index.url(0));
+  EXPECT_EQ("d", index.url(3));
+  EXPECT_EQ("the last", index.record(3));
+  EXPECT_THROW(index.url(5), std::out_of_range);
+
+  // The vocabulary of both segments (in order) with the document
+  // frequencies in both.
+  TermDictionary const& words = index.words();
+  ASSERT_EQ(8, words.size());
+  EXPECT_EQ("another", words[0]);
+  EXPECT_EQ("document", words[1]);
+  EXPECT_EQ("the", words[7]);
+  EXPECT_EQ(1, index.documentFrequency(0));
+  EXPECT_EQ(2, index.documentFrequency(1));
+  EXPECT_EQ(3, index.documentFrequency(7));
+  EXPECT_FALSE(index.hasPositions());
+
+  // BM25 with the average length (11 / 5 words) of all documents.
+  index.setBm25Parameters(1.2, 0.5);
+  Bm25 expected(Bm25::Parameters(1.2, 0.5, 2.2), 5, 2,
+      index.segment(1).documentLengths());
+  EXPECT_FLOAT_EQ(expected.score(1, 2), index.bm25(1, 2).score(1, 2));
+  EXPECT_FLOAT_EQ(expected.score(3, 1), index.bm25(1, 2).score(3, 1));
+}
+
+// ___________________________________________________________________________
+TEST(SegmentedIndex, mergeSegments) {
+  SegmentedIndex index;
+  size_t begin;
+  size_t end;
+  EXPECT_FALSE(index.mergeCandidates(&begin, &end));
+  index.addSegment(createSegment(firstFileName,
+        "a\tfirst\nb\tsecond\nc\tthird\nd\tfourth\ne\tfifth\n"));
+  EXPECT_FALSE(index.mergeCandidates(&begin, &end));
+  // A small segment behind a large one is not merged, two small ones are
+  // (and the large one as soon as the small ones have at least half of its
+  // documents).
+  index.addSegment(createSegment(secondFileName, "f\tsixth\n"));
+  EXPECT_FALSE(index.mergeCandidates(&begin, &end));
+  index.addSegment(createSegment(secondFileName, "g\tseventh third\n"));
+  ASSERT_TRUE(index.mergeCandidates(&begin, &end));
+  EXPECT_EQ(1, begin);
+  EXPECT_EQ(3, end);
+  index.mergeSegments(begin, end);
+  ASSERT_EQ(2, index.numberOfSegments());
+  EXPECT_EQ(2, index.segment(1).numberOfDocuments());
+  EXPECT_EQ("g", index.url(6));
+  index.addSegment(createSegment(secondFileName, "h\teighth\n"));
+  ASSERT_TRUE(index.mergeCandidates(&begin, &end));
+  EXPECT_EQ(0, begin);
+  index.mergeSegments(begin, end);
+  EXPECT_EQ(1, index.numberOfSegments());
+  EXPECT_EQ(8, index.numberOfDocuments());
+  size_t wordId;
+  ASSERT_TRUE(index.words().find("third", &wordId));
+  EXPECT_EQ(2, index.documentFrequency(wordId));
+  EXPECT_EQ("h", index.url(7));
+}
+
+// ___________________________________________________________________________
+TEST(SegmentedIndex, postingList) {
+  SegmentedIndex index;
+  index.precomputeScores(true);
+  writeFile(firstFileName,
+      "a\tthe first document\nb\tthe second and longer document\n"
+      "c\tanother\n");
+  index.buildFromCsvFile(firstFileName);
+  size_t wordId;
+  ASSERT_TRUE(index.words().find("document", &wordId));
+  Bm25 bm25 = index.bm25(0, 2);
+  float shorter = bm25.score(1, 3);
+  float longer = bm25.score(1, 5);
+
+  // With the parameters of the index, the precomputed scores are used (the
+  // smaller one is off by the quantization).
+  vector<Posting> postings = index.postingList(0, wordId, 2,
+      index.bm25Parameters()).decode();
+  ASSERT_EQ(2, postings.size());
+  EXPECT_FLOAT_EQ(shorter, postings[0].score);
+  EXPECT_NE(longer, postings[1].score);
+  EXPECT_NEAR(longer, postings[1].score, shorter / 255);
+  // Not with other parameters or other segments.
+  postings = index.postingList(0, wordId, 2,
+      index.bm25Parameters(1.2, 0.75)).decode();
+  EXPECT_FLOAT_EQ(index.bm25(0, 2, index.bm25Parameters(1.2, 0.75))
+      .score(1, 5), postings[1].score);
+  index.addSegment(createSegment(secondFileName, "d\tnothing\n"));
+  bm25 = index.bm25(0, 2);
+  postings = index.postingList(0, wordId, 2,
+      index.bm25Parameters()).decode();
+  EXPECT_FLOAT_EQ(bm25.score(1, 5), postings[1].score);
+}
+
+// ___________________________________________________________________________
+TEST(SegmentedIndex, writeToFileAndReadFromFile) {
+  SegmentedIndex index;
+  index.addSegment(createSegment(firstFileName, "a\tfirst\nb\tsecond\n"));
+  index.addSegment(createSegment(secondFileName, "c\tthird second\n"));
+  IndexFileWriter writer(indexFileName);
+  index.writeToFile(&writer);
+  writer.close();
+
+  SegmentedIndex read;
+  read.readFromFile(std::make_shared<IndexFileReader>(indexFileName));
+  ASSERT_EQ(2, read.numberOfSegments());
+  EXPECT_EQ(3, read.numberOfDocuments());
+  EXPECT_EQ("c", read.url(2));
+  EXPECT_EQ(index.words().size(), read.words().size());
+  size_t wordId;
+  ASSERT_TRUE(read.words().find("second", &wordId));
+  EXPECT_EQ(2, read.documentFrequency(wordId));
+}
@@ -0,0 +1,139 @@
+// Copyright 2012, Milan Oberkirch
+// Author: Milan Oberkirch <oberkirm@informatik.uni-freiburg.de>
+
+#include "./SnippetGenerator.h"
+#include <ctype.h>
+#include <algorithm>
+#include <string>
+#include <utility>
+#include <vector>
+#include "./InvertedIndex.h"
+
+// Whether c continues a multi-byte UTF-8 character (so a snippet must not
+// start or end before it).
+static bool isContinuation(char c) {
+  return (static_cast<unsigned char>(c) & 0xC0) == 0x80;
+}
+
+// ___________________________________________________________________________
+SnippetGenerator::SnippetGenerator(string const& query, size_t maxLength)
+  : _maxLength(maxLength) {
+  size_t pos = 0;
+  while (pos < query.size()) {
+    while (pos < query.size() && !InvertedIndex::isLetter(query[pos]))
+      ++pos;
+    size_t wordStart = pos;
+    while (pos < query.size() && InvertedIndex::isLetter(query[pos]))
+      ++pos;
+    if (pos == wordStart) continue;
+    string word = query.substr(wordStart, pos - wordStart);
+    std::transform(word.begin(), word.end(), word.begin(), ::tolower);
+    if (std::find(_words.begin(), _words.end(), word) == _words.end())
+      _words.push_back(word);
+  }
+}
+
+// ___________________________________________________________________________
+string_view SnippetGenerator::snippet(string_view record,
+    vector<Match>* matches) const {
+  // The occurrences of query words in the record.
+  struct Occurrence {
+    size_t begin;
+    size_t end;
+    int word;
+  };
+  vector<Occurrence> occurrences;
+  size_t pos = 0;
+  while (pos < record.size()) {
+    while (pos < record.size() && !InvertedIndex::isLetter(record[pos]))
+      ++pos;
+    size_t wordStart = pos;
+    while (pos < record.size() && InvertedIndex::isLetter(record[pos]))
+      ++pos;
+    if (pos == wordStart) continue;
+    int word = wordIndex(record.substr(wordStart, pos - wordStart));
+    if (word >= 0) {
+      Occurrence occurrence = {wordStart, pos, word};
+      occurrences.push_back(occurrence);
+    }
+  }
+
+  // The best window of occurrences [bestFirst, bestLast] (sliding the last
+  // occurrence over the record, with the first one as early as possible).
+  size_t bestFirst = 0;
+  size_t bestLast = 0;
+  size_t bestWords = 0;
+  size_t bestCount = 0;
+  vector<size_t> counts(_words.size(), 0);
+  size_t words = 0;
+  size_t first = 0;
+  for (size_t last = 0; last < occurrences.size(); ++last) {
+    if (counts[occurrences[last].word]++ == 0) ++words;
+    while (first < last
+        && occurrences[last].end - occurrences[first].begin > _maxLength) {
+      if (--counts[occurrences[first].word] == 0) --words;
+      ++first;
+    }
+    size_t count = last - first + 1;
+    if (words > bestWords || (words == bestWords && count > bestCount)) {
+      bestFirst = first;
+      bestLast = last;
+      bestWords = words;
+      bestCount = count;
+    }
+  }
+
+  std::pair<size_t, size_t> snippetBounds = occurrences.empty()
+    ? bounds(record, 0, 0)
+    : bounds(record, occurrences[bestFirst].begin,
+        occurrences[bestLast].end);
+  matches->clear();
+  for (size_t i = 0; i < occurrences.size(); ++i) {
+    if (occurrences[i].begin >= snippetBounds.first
+        && occurrences[i].end <= snippetBounds.second)
+      matches->push_back(Match(occurrences[i].begin - snippetBounds.first,
+            occurrences[i].end - occurrences[i].begin));
+  }
+  return record.substr(snippetBounds.first,
+      snippetBounds.second - snippetBounds.first);
+}
+
+// ___________________________________________________________________________
+int SnippetGenerator::wordIndex(string_view word) const {
+  for (size_t i = 0; i < _words.size(); ++i) {
+    if (_words[i].size() != word.size()) continue;
+    size_t j = 0;
+    while (j < word.size() && ::tolower(word[j]) == _words[i][j]) ++j;
+    if (j == word.size()) return i;
+  }
+  return -1;
+}
+
+// ___________________________________________________________________________
+std::pair<size_t, size_t> SnippetGenerator::bounds(string_view record,
+    size_t spanBegin, size_t spanEnd) const {
+  if (record.size() <= _maxLength)
+    return std::pair<size_t, size_t>(0, record.size());
+  // Center the span in a window of _maxLength bytes inside the record.
+  size_t span = spanEnd - spanBegin;
+  size_t slack = _maxLength > span ? _maxLength - span : 0;
+  size_t begin = std::min(spanBegin > slack / 2 ? spanBegin - slack / 2 : 0,
+      record.size() - _maxLength);
+  size_t end = begin + _maxLength;
+
+  // Cut at spaces in front of and behind the span if possible, otherwise
+  // between characters.
+  if (begin > 0 && record[begin - 1] != ' ') {
+    size_t space = record.find(' ', begin);
+    if (space < spanBegin) begin = space + 1;
+  }
+  while (begin < spanBegin && isContinuation(record[begin])) ++begin;
+  if (end < record.size() && record[end] != ' ') {
+    size_t space = record.rfind(' ', end - 1);
+    if (space != string_view::npos && space >= spanEnd && space > begin)
+      end = space;
+  }
+  while (end > begin && end < record.size() && isContinuation(record[end]))
+    --end;
+  return std::make_pair(begin, end);
+}
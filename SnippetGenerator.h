@@ -0,0 +1,49 @@
+// Copyright 2012, Milan Oberkirch
+// Author: Milan Oberkirch <oberkirm@informatik.uni-freiburg.de>
+
+#ifndef SNIPPETGENERATOR_H_
+#define SNIPPETGENERATOR_H_
+
+#include <gtest/gtest.h>
+#include <boost/utility/string_view.hpp>
+#include <string>
+#include <utility>
+#include <vector>
+
+using boost::string_view;
+using std::string;
+using std::vector;
+
+// Cuts the part of a record showing the words of a query best out of the
+// record (for the list of search results). Words are the maximal sequences
+// of letters, compared ignoring case, like in the index. The record is
+// scanned once for the words of the query. The window of at most maxLength
+// bytes containing the most different words of the query (then the most
+// occurrences) is widened to maxLength around them and cut at spaces.
+class SnippetGenerator {
+ public:
+  // An occurrence of a query word in the snippet (offset and length in
+  // bytes).
+  typedef std::pair<size_t, size_t> Match;
+
+  // Snippets for the words of query.
+  explicit SnippetGenerator(string const& query, size_t maxLength = 200);
+
+  // The snippet of record (referring to it) and the query words in it. If
+  // no query word occurs in the record, the snippet is its beginning.
+  string_view snippet(string_view record, vector<Match>* matches) const;
+
+ private:
+  // The index of word in _words (-1 if it is not a query word).
+  int wordIndex(string_view word) const;
+  // The bounds [begin, end) of the snippet containing [spanBegin, spanEnd).
+  FRIEND_TEST(SnippetGenerator, bounds);
+  std::pair<size_t, size_t> bounds(string_view record, size_t spanBegin,
+      size_t spanEnd) const;
+
+  // The lower-case words of the query (without duplicates).
+  vector<string> _words;
+  size_t _maxLength;
+};
+
+#endif  // SNIPPETGENERATOR_H_
@@ -0,0 +1,63 @@
+// Copyright 2012, Milan Oberkirch
+// Author: Milan Oberkirch <oberkirm@informatik.uni-freiburg.de>
+
+#include <gtest/gtest.h>
+#include <string>
+#include <utility>
+#include <vector>
+#include "./SnippetGenerator.h"
+
+using std::string;
+using std::vector;
+
+typedef std::pair<size_t, size_t> Bounds;
+
+// ___________________________________________________________________________
+TEST(SnippetGenerator, snippet) {
+  vector<SnippetGenerator::Match> matches;
+  // Short records are not cut. Words are compared ignoring case.
+  SnippetGenerator generator("curie, PHYSICIST curie", 40);
+  string record = "Marie Curie, a physicist; Pierre Curie.";
+  EXPECT_EQ(record, generator.snippet(record, &matches));
+  ASSERT_EQ(3, matches.size());
+  EXPECT_EQ(SnippetGenerator::Match(6, 5), matches[0]);
+  EXPECT_EQ(SnippetGenerator::Match(15, 9), matches[1]);
+  EXPECT_EQ(SnippetGenerator::Match(33, 5), matches[2]);
+
+  // The window with both words, not the one with the most occurrences.
+  record = "curie curie curie curie curie and a lot of other words until "
+    "the physicist Curie appears at last.";
+  string_view snippet = generator.snippet(record, &matches);
+  EXPECT_EQ("until the physicist Curie appears at", snippet);
+  ASSERT_EQ(2, matches.size());
+  EXPECT_EQ("physicist", snippet.substr(matches[0].first,
+        matches[0].second));
+  EXPECT_EQ("Curie", snippet.substr(matches[1].first, matches[1].second));
+
+  // Words only match whole words of the record.
+  record = "The curies were famous, curiently nobody knows a physicistician.";
+  EXPECT_EQ("The curies were famous, curiently nobody",
+      generator.snippet(record, &matches));
+  EXPECT_TRUE(matches.empty());
+  SnippetGenerator noWords("", 10);
+  EXPECT_EQ("The curies", noWords.snippet(record, &matches));
+  EXPECT_TRUE(matches.empty());
+}
+
+// ___________________________________________________________________________
+TEST(SnippetGenerator, bounds) {
+  SnippetGenerator generator("", 10);
+  string record = "aaaa bbbb cccc dddd eeee";
+  // Centered around the span and cut at spaces.
+  EXPECT_EQ(Bounds(10, 14), generator.bounds(record, 10, 14));
+  EXPECT_EQ(Bounds(0, 9), generator.bounds(record, 0, 4));
+  EXPECT_EQ(Bounds(15, 24), generator.bounds(record, 20, 24));
+  // Spans longer than the snippet are cut.
+  EXPECT_EQ(Bounds(0, 10), generator.bounds(record, 0, 24));
+  // Without spaces, UTF-8 characters are not cut ("ä" is "\xc3\xa4").
+  record = "\xc3\xa4\xc3\xa4\xc3\xa4\xc3\xa4xx\xc3\xa4\xc3\xa4\xc3\xa4"
+    "\xc3\xa4";
+  EXPECT_EQ(Bounds(4, 14), generator.bounds(record, 8, 10));
+  SnippetGenerator shorter("", 9);
+  EXPECT_EQ(Bounds(6, 14), shorter.bounds(record, 8, 10));
+}
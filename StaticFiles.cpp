@@ -0,0 +1,210 @@
+// Copyright 2012, Milan Oberkirch
+// Author: Milan Oberkirch <oberkirm@informatik.uni-freiburg.de>
+
+#include "./StaticFiles.h"
+#include <sys/stat.h>
+#include <time.h>
+#include <boost/algorithm/string.hpp>
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>  // NOLINT
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include "./HttpConnection.h"
+#include "./HttpRequest.h"
+
+// ___________________________________________________________________________
+string StaticFiles::mimeType(string const& filePath) {
+  static std::map<string, string> const mimeTypes = {
+    {"jpg", "image/jpeg"},
+    {"png", "image/png"},
+    {"ico", "image/vnd.microsoft.icon"},
+    {"html", "text/html"},
+    {"css", "text/css"},
+    {"less", "text/x-less"},
+    {"js", "application/javascript"}
+  };
+  size_t dot = filePath.rfind('.');
+  if (dot == string::npos) return "";
+  string suffix = filePath.substr(dot + 1);
+  std::transform(suffix.begin(), suffix.end(), suffix.begin(), ::tolower);
+  std::map<string, string>::const_iterator it = mimeTypes.find(suffix);
+  return it == mimeTypes.end() ? "" : it->second;
+}
+
+// ___________________________________________________________________________
+bool StaticFiles::answer(string const& filePath, HttpRequest const& request,
+    bool keepAlive, HttpConnection::Answer* answer) {
+  string type = mimeType(filePath);
+  if (type.empty()) return false;
+  File file;
+  if (!(acceptsGzip(request.header("accept-encoding"))
+        && this->file(filePath + ".gz", type, true, &file))
+      && !this->file(filePath, type, false, &file))
+    return false;
+
+  string connection = string("Connection: ")
+    + (keepAlive ? "keep-alive" : "close") + "\r\n\r\n";
+  if (notModified(request, file)) {
+    answer->head = "HTTP/1.1 304 Not Modified\r\n"
+      "Server: SearchServer 0.1\r\n"
+      "ETag: " + file.eTag + "\r\n" + connection;
+    answer->body.reset();
+  } else {
+    answer->head = "HTTP/1.1 200 OK\r\n" + file.headers + connection;
+    answer->body = file.content;
+  }
+  return true;
+}
+
+// ___________________________________________________________________________
+bool StaticFiles::file(string const& filePath, string const& mimeType,
+    bool compressed, File* result) {
+  struct stat info;
+  if (stat(filePath.c_str(), &info) != 0 || !S_ISREG(info.st_mode))
+    return false;
+  {
+    std::lock_guard<std::mutex> lock(_mutex);
+    auto position = _positions.find(filePath);
+    if (position != _positions.end()) {
+      File const& cached = position->second->file;
+      if (cached.modificationTime == info.st_mtime
+          && cached.size == static_cast<size_t>(info.st_size)) {
+        _files.splice(_files.begin(), _files, position->second);
+        *result = cached;
+        return true;
+      }
+    }
+  }
+
+  struct stat compressedInfo;
+  bool hasCompressedVariant = !compressed
+    && stat((filePath + ".gz").c_str(), &compressedInfo) == 0;
+  result->modificationTime = info.st_mtime;
+  if (!readFile(filePath, mimeType, compressed, hasCompressedVariant, result))
+    return false;
+
+  std::lock_guard<std::mutex> lock(_mutex);
+  auto position = _positions.find(filePath);
+  if (position != _positions.end()) {
+    // Changed (or read by two threads at the same time).
+    _cachedBytes -= position->second->file.size;
+    _files.erase(position->second);
+    _positions.erase(position);
+  }
+  if (result->size > _maxCachedBytes) return true;
+  while (_cachedBytes + result->size > _maxCachedBytes) {
+    _cachedBytes -= _files.back().file.size;
+    _positions.erase(_files.back().path);
+    _files.pop_back();
+  }
+  Entry entry = {filePath, *result};
+  _files.push_front(entry);
+  _positions[filePath] = _files.begin();
+  _cachedBytes += result->size;
+  return true;
+}
+
+// ___________________________________________________________________________
+bool StaticFiles::readFile(string const& filePath, string const& mimeType,
+    bool compressed, bool hasCompressedVariant, File* result) {
+  std::ifstream file(filePath.c_str(), std::ios::binary);
+  if (!file.is_open()) return false;
+  std::shared_ptr<string> content(new string());
+  file.seekg(0, std::ios::end);
+  content->reserve(file.tellg());
+  file.seekg(0, std::ios::beg);
+  content->assign((std::istreambuf_iterator<char>(file)),
+      std::istreambuf_iterator<char>());
+
+  char eTag[64];
+  snprintf(eTag, sizeof(eTag), "\"%lx-%lx%s\"",
+      static_cast<unsigned long>(content->size()),  // NOLINT
+      static_cast<unsigned long>(result->modificationTime),  // NOLINT
+      compressed ? "-gz" : "");
+  result->size = content->size();
+  result->eTag = eTag;
+  result->headers = "Server: SearchServer 0.1\r\n"
+    "Content-Length: " + std::to_string(content->size()) + "\r\n"
+    "Content-Language: en\r\n"
+    "Content-Type: " + mimeType + "; charset=utf-8\r\n"
+    "ETag: " + result->eTag + "\r\n"
+    "Last-Modified: " + httpDate(result->modificationTime) + "\r\n";
+  if (compressed) result->headers += "Content-Encoding: gzip\r\n";
+  if (compressed || hasCompressedVariant)
+    result->headers += "Vary: Accept-Encoding\r\n";
+  result->content = content;
+  return true;
+}
+
+// The text without leading and trailing spaces and tabs.
+static string_view trim(string_view text) {
+  while (!text.empty() && (text.front() == ' ' || text.front() == '\t'))
+    text.remove_prefix(1);
+  while (!text.empty() && (text.back() == ' ' || text.back() == '\t'))
+    text.remove_suffix(1);
+  return text;
+}
+
+// ___________________________________________________________________________
+bool StaticFiles::acceptsGzip(string_view acceptEncoding) {
+  // A comma-separated list of codings with optional parameters, e.g.
+  // "deflate, gzip;q=0.5, *;q=0".
+  bool gzipListed = false;
+  bool gzip = false;
+  bool any = false;
+  while (!acceptEncoding.empty()) {
+    size_t comma = acceptEncoding.find(',');
+    string_view coding = acceptEncoding.substr(0, comma);
+    acceptEncoding.remove_prefix(comma == string_view::npos
+        ? acceptEncoding.size() : comma + 1);
+    size_t semicolon = coding.find(';');
+    string_view name = trim(coding.substr(0, semicolon));
+    // Only q=0 (in any notation, e.g. 0.000) refuses a coding.
+    bool accepted = true;
+    while (semicolon != string_view::npos) {
+      coding.remove_prefix(semicolon + 1);
+      semicolon = coding.find(';');
+      string_view parameter = trim(coding.substr(0, semicolon));
+      if (parameter.size() > 2 && (parameter[0] == 'q' || parameter[0] == 'Q')
+          && parameter[1] == '=')
+        accepted = atof(parameter.substr(2).to_string().c_str()) > 0;
+    }
+    if (boost::algorithm::iequals(name, "gzip")) {
+      gzipListed = true;
+      gzip = accepted;
+    } else if (name == "*") {
+      any = accepted;
+    }
+  }
+  return gzipListed ? gzip : any;
+}
+
+// ___________________________________________________________________________
+bool StaticFiles::notModified(HttpRequest const& request, File const& file) {
+  string_view ifNoneMatch = request.header("if-none-match");
+  if (!ifNoneMatch.empty())
+    return ifNoneMatch == "*" || ifNoneMatch.find(file.eTag) != string::npos;
+  string_view ifModifiedSince = request.header("if-modified-since");
+  if (ifModifiedSince.empty()) return false;
+  struct tm time;
+  memset(&time, 0, sizeof(time));
+  if (!strptime(ifModifiedSince.to_string().c_str(),
+        "%a, %d %b %Y %H:%M:%S GMT", &time))
+    return false;
+  return timegm(&time) >= file.modificationTime;
+}
+
+// ___________________________________________________________________________
+string StaticFiles::httpDate(time_t time) {
+  struct tm utc;
+  gmtime_r(&time, &utc);
+  char date[64];
+  strftime(date, sizeof(date), "%a, %d %b %Y %H:%M:%S GMT", &utc);
+  return date;
+}
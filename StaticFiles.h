@@ -0,0 +1,84 @@
+// Copyright 2012, Milan Oberkirch
+// Author: Milan Oberkirch <oberkirm@informatik.uni-freiburg.de>
+
+#ifndef STATICFILES_H_
+#define STATICFILES_H_
+
+#include <gtest/gtest.h>
+#include <time.h>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include "./HttpConnection.h"
+#include "./HttpRequest.h"
+
+using std::string;
+
+// Answers requests for the files of the web-root. Files are kept in memory
+// with their headers (the least recently used ones are evicted when the
+// cache is full), and only read again if they changed on disk. Answers
+// share the cached content (see HttpConnection::Answer). Supports
+// conditional requests (ETag / If-None-Match and Last-Modified /
+// If-Modified-Since) and serves a precompressed file "<file>.gz" instead of
+// the file to clients accepting gzip.
+class StaticFiles {
+ public:
+  // Cache files while their sizes add up to at most maxCachedBytes, evicting
+  // the least recently used ones. Larger files are read for each request.
+  explicit StaticFiles(size_t maxCachedBytes = 64 << 20)
+    : _maxCachedBytes(maxCachedBytes), _cachedBytes(0) {}
+
+  // The MIME-type of a file by its suffix (empty if unknown).
+  static string mimeType(string const& filePath);
+
+  // Answer a request for the file (HttpConnection drops the content for
+  // HEAD). Returns false if it cannot be read.
+  bool answer(string const& filePath, HttpRequest const& request,
+      bool keepAlive, HttpConnection::Answer* answer);
+
+ private:
+  // A file (or its compressed variant) as sent to clients.
+  struct File {
+    time_t modificationTime;
+    size_t size;
+    // The headers except for the Connection-header.
+    string headers;
+    string eTag;
+    std::shared_ptr<string const> content;
+  };
+
+  // The current version of the file (from the cache if it did not change).
+  // Returns false if the file does not exist.
+  bool file(string const& filePath, string const& mimeType, bool compressed,
+      File* result);
+  // Read the file into result and compute its headers (the modification
+  // time must be set).
+  static bool readFile(string const& filePath, string const& mimeType,
+      bool compressed, bool hasCompressedVariant, File* result);
+  // Whether a client sending the Accept-Encoding header accepts gzip: it is
+  // listed (or "*" is and gzip is not) without q=0.
+  FRIEND_TEST(StaticFiles, acceptsGzip);
+  static bool acceptsGzip(string_view acceptEncoding);
+  // Whether the client has the file (by the conditional headers).
+  FRIEND_TEST(StaticFiles, notModified);
+  static bool notModified(HttpRequest const& request, File const& file);
+  // Format a time as in HTTP-headers ("Sun, 06 Nov 1994 08:49:37 GMT").
+  static string httpDate(time_t time);
+
+  struct Entry {
+    string path;
+    File file;
+  };
+
+  size_t _maxCachedBytes;
+  size_t _cachedBytes;
+  std::mutex _mutex;
+  // The cached files, the most recently used first, and their positions by
+  // path (compressed variants with ".gz").
+  std::list<Entry> _files;
+  std::unordered_map<string, std::list<Entry>::iterator> _positions;
+};
+
+#endif  // STATICFILES_H_
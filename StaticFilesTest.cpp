@@ -0,0 +1,195 @@
+// Copyright 2012, Milan Oberkirch
+// Author: Milan Oberkirch <oberkirm@informatik.uni-freiburg.de>
+
+#include <gtest/gtest.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <cstdio>
+#include <fstream>  // NOLINT
+#include <string>
+#include "./HttpConnection.h"
+#include "./HttpRequest.h"
+#include "./StaticFiles.h"
+
+using std::string;
+
+const char fileName[] = "StaticFiles.test.tmp.js";
+const char compressedFileName[] = "StaticFiles.test.tmp.js.gz";
+
+// Write content to a file and set its modification time.
+void writeFile(string const& name, string const& content, time_t time) {
+  std::ofstream file(name.c_str(), std::ios::binary);
+  file << content;
+  file.close();
+  struct timeval times[2] = {{time, 0}, {time, 0}};
+  utimes(name.c_str(), times);
+}
+
+// Answer a GET-request for fileName with the given headers.
+bool answer(StaticFiles* files, string const& headers,
+    HttpConnection::Answer* answer) {
+  string buffer = "GET /x.js HTTP/1.1\r\n" + headers + "\r\n";
+  HttpRequest request;
+  EXPECT_EQ(HttpRequest::COMPLETE, request.parse(buffer.c_str(),
+        buffer.size()));
+  return files->answer(fileName, request, true, answer);
+}
+
+// Whether the head of the answer contains the given line.
+bool hasLine(HttpConnection::Answer const& answer, string const& line) {
+  return answer.head.find(line + "\r\n") != string::npos;
+}
+
+// ___________________________________________________________________________
+TEST(StaticFiles, mimeType) {
+  EXPECT_EQ("application/javascript", StaticFiles::mimeType("www/a.JS"));
+  EXPECT_EQ("text/html", StaticFiles::mimeType("index.html"));
+  EXPECT_EQ("", StaticFiles::mimeType("a.exe"));
+  EXPECT_EQ("", StaticFiles::mimeType("Makefile"));
+}
+
+// ___________________________________________________________________________
+TEST(StaticFiles, answer) {
+  remove(compressedFileName);
+  writeFile(fileName, "var a = 1;", 1000000000);
+  StaticFiles files;
+  HttpConnection::Answer first;
+  ASSERT_TRUE(answer(&files, "", &first));
+  EXPECT_EQ(0, first.head.find("HTTP/1.1 200 OK\r\n"));
+  EXPECT_TRUE(hasLine(first, "Content-Length: 10"));
+  EXPECT_TRUE(hasLine(first, "Last-Modified: Sun, 09 Sep 2001 01:46:40 GMT"));
+  EXPECT_TRUE(hasLine(first, "Connection: keep-alive"));
+  ASSERT_TRUE(first.body);
+  EXPECT_EQ("var a = 1;", *first.body);
+
+  // The content is cached and shared.
+  HttpConnection::Answer second;
+  ASSERT_TRUE(answer(&files, "", &second));
+  EXPECT_EQ(first.body, second.body);
+  EXPECT_EQ(first.head, second.head);
+
+  // Changed files are read again.
+  writeFile(fileName, "var a = 2;", 1000000001);
+  ASSERT_TRUE(answer(&files, "", &second));
+  EXPECT_EQ("var a = 2;", *second.body);
+  EXPECT_NE(first.head, second.head);
+
+  // The precompressed file, if the client accepts it.
+  writeFile(compressedFileName, "zipped", 1000000001);
+  ASSERT_TRUE(answer(&files, "Accept-Encoding: gzip, deflate\r\n", &second));
+  EXPECT_EQ("zipped", *second.body);
+  EXPECT_TRUE(hasLine(second, "Content-Encoding: gzip"));
+  ASSERT_TRUE(answer(&files, "", &second));
+  EXPECT_EQ("var a = 2;", *second.body);
+  ASSERT_TRUE(answer(&files, "Accept-Encoding: gzip;q=0\r\n", &second));
+  EXPECT_EQ("var a = 2;", *second.body);
+
+  remove(fileName);
+  remove(compressedFileName);
+  EXPECT_FALSE(answer(&files, "", &second));
+}
+
+// ___________________________________________________________________________
+TEST(StaticFiles, evict) {
+  // Room for two of the files.
+  StaticFiles files(25);
+  string names[] = {"StaticFiles.test.tmp.a.js", "StaticFiles.test.tmp.b.js",
+    "StaticFiles.test.tmp.c.js", "StaticFiles.test.tmp.d.js"};
+  for (size_t i = 0; i < 4; ++i) writeFile(names[i], "var a = 1;", 1000000000);
+  string buffer = "GET /x.js HTTP/1.1\r\n\r\n";
+  HttpRequest request;
+  ASSERT_EQ(HttpRequest::COMPLETE, request.parse(buffer.c_str(),
+        buffer.size()));
+  HttpConnection::Answer answers[4];
+  for (size_t i = 0; i < 3; ++i)
+    ASSERT_TRUE(files.answer(names[i], request, true, &answers[i]));
+  // c evicted a, the least recently used file.
+  HttpConnection::Answer again;
+  ASSERT_TRUE(files.answer(names[1], request, true, &again));
+  EXPECT_EQ(answers[1].body, again.body);
+  ASSERT_TRUE(files.answer(names[2], request, true, &again));
+  EXPECT_EQ(answers[2].body, again.body);
+  ASSERT_TRUE(files.answer(names[0], request, true, &again));
+  EXPECT_NE(answers[0].body, again.body);
+  // Reading a again evicted b (used before c).
+  ASSERT_TRUE(files.answer(names[2], request, true, &again));
+  EXPECT_EQ(answers[2].body, again.body);
+  ASSERT_TRUE(files.answer(names[1], request, true, &again));
+  EXPECT_NE(answers[1].body, again.body);
+
+  // Files larger than the cache are not cached (and evict nothing).
+  writeFile(names[3], string(30, 'x'), 1000000000);
+  ASSERT_TRUE(files.answer(names[3], request, true, &answers[3]));
+  ASSERT_TRUE(files.answer(names[3], request, true, &again));
+  EXPECT_NE(answers[3].body, again.body);
+  EXPECT_EQ(string(30, 'x'), *again.body);
+  ASSERT_TRUE(files.answer(names[2], request, true, &again));
+  EXPECT_EQ(answers[2].body, again.body);
+  for (size_t i = 0; i < 4; ++i) remove(names[i].c_str());
+}
+
+// ___________________________________________________________________________
+TEST(StaticFiles, head) {
+  writeFile(fileName, "var a = 1;", 1000000000);
+  StaticFiles files;
+  HttpConnection::Answer get;
+  ASSERT_TRUE(answer(&files, "", &get));
+  string buffer = "HEAD /x.js HTTP/1.1\r\n\r\n";
+  HttpRequest request;
+  ASSERT_EQ(HttpRequest::COMPLETE, request.parse(buffer.c_str(),
+        buffer.size()));
+  HttpConnection::Answer head;
+  ASSERT_TRUE(files.answer(fileName, request, true, &head));
+  // The answer to GET, including its Content-Length (the connection drops
+  // the content, see HttpConnectionTest).
+  EXPECT_EQ(get.head, head.head);
+  EXPECT_TRUE(hasLine(head, "Content-Length: 10"));
+  EXPECT_EQ(get.body, head.body);
+  remove(fileName);
+}
+
+// ___________________________________________________________________________
+TEST(StaticFiles, acceptsGzip) {
+  EXPECT_TRUE(StaticFiles::acceptsGzip("gzip"));
+  EXPECT_TRUE(StaticFiles::acceptsGzip("deflate, GZIP;q=0.5"));
+  EXPECT_TRUE(StaticFiles::acceptsGzip("br, *"));
+  EXPECT_FALSE(StaticFiles::acceptsGzip(""));
+  EXPECT_FALSE(StaticFiles::acceptsGzip("deflate"));
+  // Refused with q=0.
+  EXPECT_FALSE(StaticFiles::acceptsGzip("gzip;q=0"));
+  EXPECT_FALSE(StaticFiles::acceptsGzip("gzip ; q=0.000, deflate"));
+  EXPECT_FALSE(StaticFiles::acceptsGzip("*;q=0"));
+  EXPECT_FALSE(StaticFiles::acceptsGzip("gzip;q=0, *"));
+  EXPECT_TRUE(StaticFiles::acceptsGzip("gzip, *;q=0"));
+  // Only the whole name.
+  EXPECT_FALSE(StaticFiles::acceptsGzip("x-gzip"));
+  EXPECT_FALSE(StaticFiles::acceptsGzip("gzipped"));
+}
+
+// ___________________________________________________________________________
+TEST(StaticFiles, notModified) {
+  writeFile(fileName, "var a = 1;", 1000000000);
+  StaticFiles files;
+  HttpConnection::Answer answer200;
+  ASSERT_TRUE(answer(&files, "", &answer200));
+  size_t eTagStart = answer200.head.find("ETag: ") + 6;
+  string eTag = answer200.head.substr(eTagStart,
+      answer200.head.find("\r\n", eTagStart) - eTagStart);
+
+  HttpConnection::Answer answer304;
+  ASSERT_TRUE(answer(&files, "If-None-Match: " + eTag + "\r\n", &answer304));
+  EXPECT_EQ(0, answer304.head.find("HTTP/1.1 304 Not Modified\r\n"));
+  EXPECT_FALSE(answer304.body);
+  ASSERT_TRUE(answer(&files, "If-None-Match: \"other\"\r\n", &answer304));
+  EXPECT_EQ(0, answer304.head.find("HTTP/1.1 200 OK\r\n"));
+
+  ASSERT_TRUE(answer(&files,
+        "If-Modified-Since: Sun, 09 Sep 2001 01:46:40 GMT\r\n", &answer304));
+  EXPECT_EQ(0, answer304.head.find("HTTP/1.1 304 Not Modified\r\n"));
+  ASSERT_TRUE(answer(&files,
+        "If-Modified-Since: Sun, 09 Sep 2001 01:46:39 GMT\r\n", &answer304));
+  EXPECT_EQ(0, answer304.head.find("HTTP/1.1 200 OK\r\n"));
+  ASSERT_TRUE(answer(&files, "If-Modified-Since: yesterday\r\n", &answer304));
+  EXPECT_EQ(0, answer304.head.find("HTTP/1.1 200 OK\r\n"));
+  remove(fileName);
+}
@@ -0,0 +1,68 @@
+// Copyright 2012, Milan Oberkirch
+// Author: Milan Oberkirch <oberkirm@informatik.uni-freiburg.de>
+
+#ifndef STRINGTABLE_H_
+#define STRINGTABLE_H_
+
+#include <stdint.h>
+#include <boost/utility/string_view.hpp>
+#include <stdexcept>
+#include <string>
+#include "./FlatVector.h"
+#include "./IndexFile.h"
+
+using boost::string_view;
+using std::string;
+
+// A list of strings stored back to back in one array of chars (plus an array
+// of their offsets), instead of one heap allocation per string. Like a
+// FlatVector it can be mapped from an index file.
+class StringTable {
+ public:
+  StringTable() { clear(); }
+
+  size_t size() const { return _offsets.size() - 1; }
+  bool empty() const { return size() == 0; }
+  string_view operator[](size_t i) const {
+    return string_view(_chars.data() + _offsets[i],
+        _offsets[i + 1] - _offsets[i]);
+  }
+  string_view at(size_t i) const {
+    if (i >= size()) throw std::out_of_range("StringTable::at");
+    return (*this)[i];
+  }
+  string_view back() const { return (*this)[size() - 1]; }
+
+  void push_back(string_view value) {
+    _chars.append(value.begin(), value.end());
+    _offsets.push_back(_chars.size());
+  }
+  // Append value to the last string.
+  void appendToBack(string_view value) {
+    _chars.append(value.begin(), value.end());
+    _offsets[_offsets.size() - 1] = _chars.size();
+  }
+  void clear() {
+    _chars.clear();
+    _offsets.clear();
+    _offsets.push_back(0);
+  }
+
+  void writeToFile(IndexFileWriter* file) const {
+    file->write(_chars);
+    file->write(_offsets);
+  }
+  void readFromFile(IndexFileReader* file) {
+    file->read(&_chars);
+    file->read(&_offsets);
+    if (_offsets.empty() || _offsets.back() != _chars.size())
+      throw IndexFileError("Index file contains a broken string table.");
+  }
+
+ private:
+  FlatVector<char> _chars;
+  // String i is _chars[_offsets[i].._offsets[i + 1]).
+  FlatVector<uint64_t> _offsets;
+};
+
+#endif  // STRINGTABLE_H_
@@ -0,0 +1,178 @@
+// Copyright 2012, Milan Oberkirch
+// Author: Milan Oberkirch <oberkirm@informatik.uni-freiburg.de>
+
+#include "./TermDictionary.h"
+#include <stdint.h>
+#include <boost/utility/string_view.hpp>
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+#include "./FlatVector.h"
+#include "./IndexFile.h"
+
+const size_t TermDictionary::blockSize;
+
+// ___________________________________________________________________________
+string TermDictionary::operator[](size_t id) const {
+  size_t block = id / blockSize;
+  string_view first = firstTerm(block);
+  string term = first.to_string();
+  char const* data = first.end();
+  for (size_t i = block * blockSize; i < id; ++i) {
+    size_t shared;
+    size_t rest;
+    data = readLength(readLength(data, &shared), &rest);
+    term.resize(shared);
+    term.append(data, rest);
+    data += rest;
+  }
+  return term;
+}
+
+// ___________________________________________________________________________
+size_t TermDictionary::lowerBound(string_view term) const {
+  bool found;
+  return lowerBound(term, &found);
+}
+
+// ___________________________________________________________________________
+bool TermDictionary::find(string_view term, size_t* id) const {
+  bool found;
+  *id = lowerBound(term, &found);
+  return found;
+}
+
+// ___________________________________________________________________________
+size_t TermDictionary::lowerBound(string_view term, bool* found) const {
+  *found = false;
+  // The first block starting with a term larger than term.
+  size_t low = 0;
+  size_t high = _blockOffsets.size();
+  while (low < high) {
+    size_t middle = (low + high) / 2;
+    if (firstTerm(middle) <= term)
+      low = middle + 1;
+    else
+      high = middle;
+  }
+  if (low == 0) return 0;
+  return lowerBoundInBlock(low - 1, term, found);
+}
+
+// ___________________________________________________________________________
+size_t TermDictionary::lowerBoundInBlock(size_t block, string_view term,
+    bool* found) const {
+  string_view first = firstTerm(block);
+  size_t id = block * blockSize;
+  if (first == term) {
+    *found = true;
+    return id;
+  }
+  // The terms are scanned while they are smaller than term. common is the
+  // length of the common prefix of the current term and term, so only the
+  // characters behind it have to be compared.
+  size_t common = 0;
+  while (common < first.size() && common < term.size()
+      && first[common] == term[common])
+    ++common;
+  char const* data = first.end();
+  size_t end = std::min(_size, id + blockSize);
+  for (++id; id < end; ++id) {
+    size_t shared;
+    size_t rest;
+    data = readLength(readLength(data, &shared), &rest);
+    char const* suffix = data;
+    data += rest;
+    // The term differs from its predecessor where the predecessor was equal
+    // to term, so it is larger.
+    if (shared < common) return id;
+    // The term is equal to its predecessor where the predecessor was
+    // smaller than term.
+    if (shared > common) continue;
+    size_t i = 0;
+    while (i < rest && common + i < term.size()
+        && suffix[i] == term[common + i])
+      ++i;
+    if (common + i == term.size()) {
+      *found = i == rest;
+      return id;
+    }
+    if (i < rest && static_cast<unsigned char>(suffix[i])
+        > static_cast<unsigned char>(term[common + i]))
+      return id;
+    common += i;
+  }
+  return id;
+}
+
+// ___________________________________________________________________________
+void TermDictionary::push_back(string_view term) {
+  if (_size > 0 && !(string_view(_lastTerm) < term))
+    throw std::invalid_argument("Terms must be added in sorted order.");
+  if (_size % blockSize == 0) {
+    _blockOffsets.push_back(_data.size());
+    appendLength(term.size(), &_data);
+    _data.append(term.begin(), term.end());
+  } else {
+    size_t shared = 0;
+    while (shared < _lastTerm.size() && shared < term.size()
+        && _lastTerm[shared] == term[shared])
+      ++shared;
+    appendLength(shared, &_data);
+    appendLength(term.size() - shared, &_data);
+    _data.append(term.begin() + shared, term.end());
+  }
+  _lastTerm.assign(term.begin(), term.end());
+  ++_size;
+}
+
+// ___________________________________________________________________________
+void TermDictionary::clear() {
+  _size = 0;
+  _data.clear();
+  _blockOffsets.clear();
+  _lastTerm.clear();
+}
+
+// ___________________________________________________________________________
+void TermDictionary::writeToFile(IndexFileWriter* file) const {
+  file->writeValue<uint64_t>(_size);
+  file->write(_data);
+  file->write(_blockOffsets);
+}
+
+// ___________________________________________________________________________
+void TermDictionary::readFromFile(IndexFileReader* file) {
+  clear();
+  _size = file->readValue<uint64_t>();
+  file->read(&_data);
+  file->read(&_blockOffsets);
+  if (_blockOffsets.size() != (_size + blockSize - 1) / blockSize
+      || (!_blockOffsets.empty() && _blockOffsets.back() >= _data.size()))
+    throw IndexFileError("Index file contains a broken term dictionary.");
+}
+
+// ___________________________________________________________________________
+string_view TermDictionary::firstTerm(size_t block) const {
+  size_t length;
+  char const* data = readLength(_data.data() + _blockOffsets[block], &length);
+  return string_view(data, length);
+}
+
+// ___________________________________________________________________________
+void TermDictionary::appendLength(size_t length, FlatVector<char>* data) {
+  while (length >= 0x80) {
+    data->push_back((length & 0x7F) | 0x80);
+    length >>= 7;
+  }
+  data->push_back(length);
+}
+
+// ___________________________________________________________________________
+char const* TermDictionary::readLength(char const* data, size_t* length) {
+  size_t result = *data & 0x7F;
+  for (int shift = 7; *data++ & 0x80; shift += 7)
+    result |= static_cast<size_t>(*data & 0x7F) << shift;
+  *length = result;
+  return data;
+}
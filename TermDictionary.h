@@ -0,0 +1,72 @@
+// Copyright 2012, Milan Oberkirch
+// Author: Milan Oberkirch <oberkirm@informatik.uni-freiburg.de>
+
+#ifndef TERMDICTIONARY_H_
+#define TERMDICTIONARY_H_
+
+#include <gtest/gtest.h>
+#include <stdint.h>
+#include <boost/utility/string_view.hpp>
+#include <string>
+#include "./FlatVector.h"
+#include "./IndexFile.h"
+
+using boost::string_view;
+using std::string;
+
+// Sorted set of terms mapping each term to a dense id (its rank), stored
+// front-coded in two flat arrays instead of one tree node per term. Terms
+// are grouped in blocks of blockSize terms. The first term of a block is
+// stored completely, every other term as the length of the prefix it shares
+// with its predecessor plus the rest. Lookups binary search the first terms
+// of the blocks and then scan one block. Like a FlatVector it can be mapped
+// from an index file.
+class TermDictionary {
+ public:
+  static const size_t blockSize = 16;
+
+  TermDictionary() : _size(0) {}
+
+  size_t size() const { return _size; }
+  bool empty() const { return _size == 0; }
+  // The term with the given id.
+  string operator[](size_t id) const;
+
+  // Id of the first term not smaller than term (size() if there is none).
+  size_t lowerBound(string_view term) const;
+  // Set id to the id of term. Returns false if term is not contained.
+  bool find(string_view term, size_t* id) const;
+
+  // Append a term, which must be larger than all terms so far.
+  void push_back(string_view term);
+  void clear();
+
+  void writeToFile(IndexFileWriter* file) const;
+  void readFromFile(IndexFileReader* file);
+
+ private:
+  // Like the public lowerBound, found is set to whether the term at the
+  // returned id is term.
+  size_t lowerBound(string_view term, bool* found) const;
+  // The first term of a block.
+  string_view firstTerm(size_t block) const;
+  // The id of the first term not smaller than term in block (the id of the
+  // first term of the next block, if there is none).
+  size_t lowerBoundInBlock(size_t block, string_view term, bool* found) const;
+
+  // Lengths are variable-byte encoded.
+  FRIEND_TEST(TermDictionary, variableByte);
+  static void appendLength(size_t length, FlatVector<char>* data);
+  static char const* readLength(char const* data, size_t* length);
+
+  size_t _size;
+  // The blocks back to back. Block: length, first term, then for each other
+  // term the length of the shared prefix, length of the rest, rest.
+  FlatVector<char> _data;
+  // Offset of each block in _data.
+  FlatVector<uint64_t> _blockOffsets;
+  // The last term (only while the dictionary is built).
+  string _lastTerm;
+};
+
+#endif  // TERMDICTIONARY_H_
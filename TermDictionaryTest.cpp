@@ -0,0 +1,92 @@
+// Copyright 2012, Milan Oberkirch
+// Author: Milan Oberkirch <oberkirm@informatik.uni-freiburg.de>
+
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <cstdio>
+#include <set>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "./FlatVector.h"
+#include "./IndexFile.h"
+#include "./TermDictionary.h"
+
+using std::string;
+using std::vector;
+
+const char indexFileName[] = "TermDictionary.index.test.tmp";
+
+// Sorted terms sharing prefixes, including prefixes of each other and
+// characters above 127.
+vector<string> createTerms() {
+  std::set<string> terms;
+  char const* parts[] = {"a", "ab", "abc", "b", "zz", "\xc3\xa4", "xyz"};
+  for (size_t i = 0; i < 7; ++i)
+    for (size_t j = 0; j < 7; ++j)
+      for (size_t k = 0; k < 7; ++k)
+        terms.insert(string(parts[i]) + parts[j] + (k ? parts[k] : ""));
+  return vector<string>(terms.begin(), terms.end());
+}
+
+// ___________________________________________________________________________
+TEST(TermDictionary, lookup) {
+  vector<string> terms = createTerms();
+  TermDictionary dictionary;
+  for (size_t i = 0; i < terms.size(); ++i) dictionary.push_back(terms[i]);
+  ASSERT_EQ(terms.size(), dictionary.size());
+  for (size_t i = 0; i < terms.size(); ++i) {
+    EXPECT_EQ(terms[i], dictionary[i]);
+    size_t id;
+    ASSERT_TRUE(dictionary.find(terms[i], &id));
+    EXPECT_EQ(i, id);
+    // Terms which are not contained, between and around the others.
+    string other[] = {terms[i] + "0", terms[i].substr(0, terms[i].size() - 1),
+      terms[i] + "\xff", "", "\xff"};
+    for (size_t j = 0; j < 5; ++j) {
+      size_t expected = std::lower_bound(terms.begin(), terms.end(),
+          other[j]) - terms.begin();
+      EXPECT_EQ(expected, dictionary.lowerBound(other[j])) << other[j];
+      bool contained = expected < terms.size() && terms[expected] == other[j];
+      EXPECT_EQ(contained, dictionary.find(other[j], &id)) << other[j];
+    }
+  }
+  EXPECT_THROW(dictionary.push_back("a"), std::invalid_argument);
+  EXPECT_EQ(0, TermDictionary().lowerBound("a"));
+}
+
+// ___________________________________________________________________________
+TEST(TermDictionary, writeToFileAndReadFromFile) {
+  vector<string> terms = createTerms();
+  TermDictionary dictionary;
+  for (size_t i = 0; i < terms.size(); ++i) dictionary.push_back(terms[i]);
+  {
+    IndexFileWriter writer(indexFileName);
+    dictionary.writeToFile(&writer);
+    writer.close();
+  }
+  IndexFileReader reader(indexFileName);
+  TermDictionary read;
+  read.readFromFile(&reader);
+  ASSERT_EQ(terms.size(), read.size());
+  for (size_t i = 0; i < terms.size(); ++i) {
+    size_t id;
+    EXPECT_TRUE(read.find(terms[i], &id));
+    EXPECT_EQ(i, id);
+  }
+  std::remove(indexFileName);
+}
+
+// ___________________________________________________________________________
+TEST(TermDictionary, variableByte) {
+  FlatVector<char> data;
+  size_t values[] = {0, 127, 128, 300000};
+  for (size_t i = 0; i < 4; ++i) TermDictionary::appendLength(values[i], &data);
+  EXPECT_EQ(1 + 1 + 2 + 3, data.size());
+  char const* position = data.data();
+  for (size_t i = 0; i < 4; ++i) {
+    size_t value;
+    position = TermDictionary::readLength(position, &value);
+    EXPECT_EQ(values[i], value);
+  }
+}